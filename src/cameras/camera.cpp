@@ -1,8 +1,47 @@
 #include "camera.h"
 
 Camera::Camera(const Matrix4x4 &cameraToWorld_, const Film &film_)
-    : cameraToWorld(cameraToWorld_), film(film_)
+    : cameraToWorld(cameraToWorld_), film(film_),
+      shutterOpen(0.0), shutterClose(0.0), velocity(0.0),
+      apertureRadius(0.0), focusDistance(1.0)
 {
     aspect = (double) (film.getWidth()) / (double) (film.getHeight());
 }
 
+Ray Camera::generateRay(const double u, const double v,
+                        const double lensU, const double lensV,
+                        const double time) const
+{
+    Ray r = generateRay(u, v);
+
+    // Move the ray with the camera
+    r.time = shutterTime(time);
+    r.o += velocity * r.time;
+
+    return r;
+}
+
+bool Camera::cameraSpaceToNDC(const Vector3D &p, double &u, double &v,
+                              double &distance) const
+{
+    return false;
+}
+
+void Camera::setShutter(double shutterOpen_, double shutterClose_, const Vector3D &velocity_)
+{
+    shutterOpen = shutterOpen_;
+    shutterClose = shutterClose_;
+    velocity = velocity_;
+}
+
+void Camera::setThinLens(double apertureRadius_, double focusDistance_)
+{
+    apertureRadius = apertureRadius_;
+    focusDistance = focusDistance_;
+}
+
+double Camera::shutterTime(const double time) const
+{
+    return shutterOpen + time * (shutterClose - shutterOpen);
+}
+
@@ -16,6 +16,30 @@ public:
     virtual Ray generateRay(const double u, const double v) const = 0;
     virtual Vector3D ndcToCameraSpace(const double u, const double v) const = 0;
 
+    // Inverse of generateRay(u, v) in camera space: the image plane
+    // coordinates (u, v) of the ray which passes through the camera space
+    // point p, and the distance along that ray to p. Returns false if p is
+    // not seen by the camera (or the camera does not implement it)
+    virtual bool cameraSpaceToNDC(const Vector3D &p, double &u, double &v,
+                                  double &distance) const;
+
+    // Same as above, for the lens sample (lensU, lensV) and the shutter
+    // sample "time", all of them in [0,1]. The ray starts at the camera
+    // position at that instant and carries it in Ray::time. Cameras without
+    // a lens model ignore the lens sample
+    virtual Ray generateRay(const double u, const double v,
+                            const double lensU, const double lensV,
+                            const double time) const;
+
+    // The shutter stays open during [shutterOpen_, shutterClose_], while the
+    // camera moves with velocity_ (world units per unit of time)
+    void setShutter(double shutterOpen_, double shutterClose_, const Vector3D &velocity_);
+
+    // Thin lens: rays leave a disk of radius apertureRadius_ and converge on
+    // the plane at focusDistance_ (camera space) in front of the camera. An
+    // aperture of 0 gives a pinhole camera
+    void setThinLens(double apertureRadius_, double focusDistance_);
+
     /* ******************* */
     /* General Camera data */
     /* ******************* */
@@ -28,6 +52,19 @@ public:
     // Aspect (based on the film size)
     double aspect;
 
+    // Shutter and camera motion
+    double shutterOpen;
+    double shutterClose;
+    Vector3D velocity;
+
+    // Thin lens
+    double apertureRadius;
+    double focusDistance;
+
+protected:
+    // Instant of the shutter interval for a time sample in [0,1]
+    double shutterTime(const double time) const;
+
 
 
 };
@@ -26,6 +26,18 @@ Vector3D OrtographicCamera::ndcToCameraSpace(const double u, const double v) con
     return Vector3D(x, y, 0);
 }
 
+bool OrtographicCamera::cameraSpaceToNDC(const Vector3D &p, double &u, double &v,
+                                         double &distance) const
+{
+    if (p.z < 0.0)
+        return false;
+
+    u = (p.x / aspect + 1) / 2;
+    v = (p.y + 1) / 2;
+    distance = p.z;
+    return u >= 0.0 && u <= 1.0 && v >= 0.0 && v <= 1.0;
+}
+
 // Input in Image plane
 Ray OrtographicCamera::generateRay(const double u, const double v) const
 {
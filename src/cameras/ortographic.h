@@ -16,7 +16,10 @@ public:
 
     // Member functions
     virtual Ray generateRay(const double u, const double v) const;
+    using Camera::generateRay;
     virtual Vector3D ndcToCameraSpace(const double u, const double v) const;
+    virtual bool cameraSpaceToNDC(const Vector3D &p, double &u, double &v,
+                                  double &distance) const;
 };
 
 #endif // ORTOGRAPHICCAMERA_H
@@ -24,6 +24,20 @@ Vector3D PerspectiveCamera::ndcToCameraSpace(const double u, const double v) con
                       1);
 }
 
+bool PerspectiveCamera::cameraSpaceToNDC(const Vector3D &p, double &u, double &v,
+                                         double &distance) const
+{
+    if (p.z <= 0.0)
+        return false;
+
+    // Point of the image plane (z = 1) on the way to p
+    double size = 2.0 * std::tan(fov/2);
+    u = (p.x / p.z / aspect + size * 0.5) / size;
+    v = (size * 0.5 - p.y / p.z) / size;
+    distance = p.length();
+    return u >= 0.0 && u <= 1.0 && v >= 0.0 && v <= 1.0;
+}
+
 Ray PerspectiveCamera::generateRay(const double u, const double v) const
 {
     // Convert the sample to camera coordinates
@@ -46,3 +60,50 @@ Ray PerspectiveCamera::generateRay(const double u, const double v) const
 
     return r;
 }
+
+Ray PerspectiveCamera::generateRay(const double u, const double v,
+                                   const double lensU, const double lensV,
+                                   const double time) const
+{
+    Vector3D rOrig(0, 0, 0);
+    Vector3D rDir = ndcToCameraSpace(u, v);
+
+    if (apertureRadius > 0.0)
+    {
+        // Point of the focus plane (z = focusDistance) seen through the pixel
+        Vector3D pFocus = rDir * focusDistance;
+
+        // Map the lens sample to the aperture disk (concentric mapping)
+        double sx = 2.0 * lensU - 1.0;
+        double sy = 2.0 * lensV - 1.0;
+        double radius = 0.0, theta = 0.0;
+        if (sx != 0.0 || sy != 0.0)
+        {
+            if (std::abs(sx) > std::abs(sy))
+            {
+                radius = sx;
+                theta = (M_PI / 4.0) * (sy / sx);
+            }
+            else
+            {
+                radius = sy;
+                theta = (M_PI / 2.0) - (M_PI / 4.0) * (sx / sy);
+            }
+        }
+        radius *= apertureRadius;
+
+        rOrig = Vector3D(radius * std::cos(theta), radius * std::sin(theta), 0);
+        rDir = pFocus - rOrig;
+    }
+
+    // Construct the ray and convert it to world coordinates
+    Ray r(rOrig, rDir.normalized(), 0);
+    r = cameraToWorld.transformRay(r);
+    r.d = r.d.normalized();
+
+    // Move the ray with the camera
+    r.time = shutterTime(time);
+    r.o += velocity * r.time;
+
+    return r;
+}
@@ -13,7 +13,12 @@ public:
 
     // Member functions
     virtual Ray generateRay(const double u, const double v) const;
+    virtual Ray generateRay(const double u, const double v,
+                            const double lensU, const double lensV,
+                            const double time) const;
     virtual Vector3D ndcToCameraSpace(const double u, const double v) const;
+    virtual bool cameraSpaceToNDC(const Vector3D &p, double &u, double &v,
+                                  double &distance) const;
 
     /* Perspective Camera Data */
     double fov; // Radians
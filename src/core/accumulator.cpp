@@ -0,0 +1,169 @@
+#include "accumulator.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+// File layout: magic, version, width, height, seed, passes (32 bit each),
+// then the RGB sums (64 bit floats) and the sample counts (32 bit) of every
+// pixel, all in the byte order of the machine
+#define CHECKPOINT_MAGIC "ACGCKPT"
+#define CHECKPOINT_VERSION 1u
+
+Accumulator::Accumulator(size_t width_, size_t height_, uint32_t seed_)
+    : width(width_), height(height_), seed(seed_), passCount(0),
+      sums(3 * width_ * height_, 0.0), counts(width_ * height_, 0)
+{ }
+
+void Accumulator::addPass(const Film &pass, int spp)
+{
+    for (size_t h = 0; h < height; h++)
+    {
+        const Vector3D *row = pass.getRow(h);
+        for (size_t w = 0; w < width; w++)
+        {
+            size_t i = h * width + w;
+            sums[3 * i]     += (double)row[w].x * spp;
+            sums[3 * i + 1] += (double)row[w].y * spp;
+            sums[3 * i + 2] += (double)row[w].z * spp;
+            counts[i] += (uint32_t)spp;
+        }
+    }
+    passCount++;
+}
+
+bool Accumulator::merge(const Accumulator &other)
+{
+    if (other.width != width || other.height != height)
+        return false;
+
+    for (size_t i = 0; i < sums.size(); i++)
+        sums[i] += other.sums[i];
+    for (size_t i = 0; i < counts.size(); i++)
+        counts[i] += other.counts[i];
+    passCount += other.passCount;
+    return true;
+}
+
+void Accumulator::resolve(Film &film) const
+{
+    for (size_t h = 0; h < height; h++)
+    {
+        for (size_t w = 0; w < width; w++)
+        {
+            size_t i = h * width + w;
+            Vector3D mean(0.0);
+            if (counts[i] > 0)
+                mean = Vector3D(sums[3 * i], sums[3 * i + 1], sums[3 * i + 2]) / (double)counts[i];
+            film.setPixelValue(w, h, mean);
+        }
+    }
+}
+
+unsigned int Accumulator::getPassSeed(uint32_t passIndex) const
+{
+    return seed ^ (passIndex * 0x9e3779b9u);
+}
+
+bool Accumulator::save(const std::string &filename) const
+{
+    std::string tempName = filename + ".tmp";
+    {
+        std::ofstream file(tempName, std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+        {
+            std::cout << "Problem at Accumulator::save() : Could not open file \"" << tempName << "\"" << std::endl;
+            return false;
+        }
+
+        std::vector<unsigned char> data = serialize();
+        file.write((const char*)data.data(), data.size());
+        if (!file.good())
+            return false;
+    }
+
+    // rename replaces the old checkpoint atomically on POSIX; on Windows it
+    // fails if the target exists, and MoveFileEx is needed to replace it
+#ifdef _WIN32
+    return MoveFileExA(tempName.c_str(), filename.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    return std::rename(tempName.c_str(), filename.c_str()) == 0;
+#endif
+}
+
+bool Accumulator::load(const std::string &filename)
+{
+    std::ifstream file(filename, std::ios::binary);
+    if (!file.is_open())
+        return false;
+
+    std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)),
+                                    std::istreambuf_iterator<char>());
+    if (!deserialize(data.data(), data.size()))
+    {
+        std::cout << "Accumulator: \"" << filename << "\" is not a checkpoint of a "
+                  << width << "x" << height << " image" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+std::vector<unsigned char> Accumulator::serialize() const
+{
+    uint32_t header[5] = { CHECKPOINT_VERSION, (uint32_t)width, (uint32_t)height, seed, passCount };
+    size_t sumBytes = sums.size() * sizeof(double);
+    size_t countBytes = counts.size() * sizeof(uint32_t);
+
+    std::vector<unsigned char> data(8 + sizeof(header) + sumBytes + countBytes);
+    unsigned char *p = data.data();
+    memcpy(p, CHECKPOINT_MAGIC, 8);
+    memcpy(p + 8, header, sizeof(header));
+    memcpy(p + 8 + sizeof(header), sums.data(), sumBytes);
+    memcpy(p + 8 + sizeof(header) + sumBytes, counts.data(), countBytes);
+    return data;
+}
+
+bool Accumulator::deserialize(const unsigned char *data, size_t size)
+{
+    uint32_t header[5];
+    size_t sumBytes = sums.size() * sizeof(double);
+    size_t countBytes = counts.size() * sizeof(uint32_t);
+    if (size != 8 + sizeof(header) + sumBytes + countBytes || memcmp(data, CHECKPOINT_MAGIC, 8) != 0)
+        return false;
+
+    memcpy(header, data + 8, sizeof(header));
+    if (header[0] != CHECKPOINT_VERSION || header[1] != width || header[2] != height)
+        return false;
+
+    seed = header[3];
+    passCount = header[4];
+    memcpy(sums.data(), data + 8 + sizeof(header), sumBytes);
+    memcpy(counts.data(), data + 8 + sizeof(header) + sumBytes, countBytes);
+    return true;
+}
+
+size_t Accumulator::getWidth() const
+{
+    return width;
+}
+
+size_t Accumulator::getHeight() const
+{
+    return height;
+}
+
+uint32_t Accumulator::getSeed() const
+{
+    return seed;
+}
+
+uint32_t Accumulator::getPassCount() const
+{
+    return passCount;
+}
@@ -0,0 +1,60 @@
+#ifndef ACCUMULATOR_H
+#define ACCUMULATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "film.h"
+
+// Running sums of a progressive render: per pixel, the sum of the radiance
+// samples and their number, plus the seed and the number of passes done,
+// which fix the random numbers of the next pass (see Renderer::renderPasses).
+// It can be saved to a binary checkpoint and loaded back, so that a render
+// which was stopped resumes where its last checkpoint left it.
+class Accumulator
+{
+public:
+    Accumulator() = delete;
+    Accumulator(size_t width_, size_t height_, uint32_t seed_ = 0);
+
+    // Add a pass in which every pixel of the film got spp samples
+    void addPass(const Film &pass, int spp);
+
+    // Add the sums, counts and passes of another accumulator of the same
+    // size, e.g., one filled by a worker process (see RenderCoordinator)
+    bool merge(const Accumulator &other);
+
+    // Write the mean of the samples of each pixel into the film
+    void resolve(Film &film) const;
+
+    // Seed of rand() for the given pass of the render
+    unsigned int getPassSeed(uint32_t passIndex) const;
+
+    // The checkpoint is written to a temporary file which then replaces
+    // "filename", so an interrupted save leaves the previous one intact.
+    // load() fails (and leaves the sums untouched) if the file is missing,
+    // corrupt or for another image size
+    bool save(const std::string &filename) const;
+    bool load(const std::string &filename);
+
+    // The checkpoint in memory, as written by save()
+    std::vector<unsigned char> serialize() const;
+    bool deserialize(const unsigned char *data, size_t size);
+
+    size_t getWidth() const;
+    size_t getHeight() const;
+    uint32_t getSeed() const;
+    uint32_t getPassCount() const;
+
+private:
+    size_t width;
+    size_t height;
+    uint32_t seed;
+    uint32_t passCount;
+
+    std::vector<double> sums;       // RGB, row major
+    std::vector<uint32_t> counts;
+};
+
+#endif // ACCUMULATOR_H
@@ -0,0 +1,108 @@
+#include "animation.h"
+
+#include <algorithm>
+#include <cstdio>
+
+Animation::Animation(Camera &cam_, Scene &scene_)
+    : cam(cam_), scene(scene_)
+{ }
+
+void Animation::insertKeyframe(std::vector<Keyframe> &keyframes, double frame,
+                               const Matrix4x4 &transform)
+{
+    Keyframe key = { frame, transform };
+    auto pos = std::upper_bound(keyframes.begin(), keyframes.end(), key,
+        [](const Keyframe &a, const Keyframe &b) { return a.frame < b.frame; });
+    keyframes.insert(pos, key);
+}
+
+Matrix4x4 Animation::interpolate(const std::vector<Keyframe> &keyframes, double frame)
+{
+    if (frame <= keyframes.front().frame)
+        return keyframes.front().transform;
+    if (frame >= keyframes.back().frame)
+        return keyframes.back().transform;
+
+    size_t k = 1;
+    while (keyframes[k].frame < frame)
+        k++;
+    const Keyframe &k0 = keyframes[k - 1];
+    const Keyframe &k1 = keyframes[k];
+
+    double s = (frame - k0.frame) / (k1.frame - k0.frame);
+    return k0.transform * (1.0 - s) + k1.transform * s;
+}
+
+Animation::Track& Animation::findTrack(Sphere *sphere, TriangleMesh *mesh)
+{
+    for (Track &track : tracks)
+        if (track.sphere == sphere && track.mesh == mesh)
+            return track;
+
+    tracks.push_back({ sphere, mesh, {} });
+    return tracks.back();
+}
+
+void Animation::addCameraKeyframe(double frame, const Matrix4x4 &cameraToWorld)
+{
+    insertKeyframe(cameraKeyframes, frame, cameraToWorld);
+}
+
+void Animation::addKeyframe(Sphere *sphere, double frame, const Matrix4x4 &objectToWorld)
+{
+    insertKeyframe(findTrack(sphere, nullptr).keyframes, frame, objectToWorld);
+}
+
+void Animation::addKeyframe(TriangleMesh *mesh, double frame, const Matrix4x4 &objectToWorld)
+{
+    insertKeyframe(findTrack(nullptr, mesh).keyframes, frame, objectToWorld);
+}
+
+void Animation::setFrame(double frame)
+{
+    if (!cameraKeyframes.empty())
+        cam.cameraToWorld = interpolate(cameraKeyframes, frame);
+
+    for (const Track &track : tracks)
+    {
+        Matrix4x4 transform = interpolate(track.keyframes, frame);
+        if (track.sphere != nullptr)
+            track.sphere->setObjectToWorld(transform);
+        else
+            track.mesh->setObjectToWorld(transform);
+    }
+
+    if (!tracks.empty())
+        scene.refitBVH();
+}
+
+void Animation::render(const Renderer &renderer, Film &film, int spp,
+                       int firstFrame, int lastFrame, const std::string &filenamePattern,
+                       TemporalAccumulator *temporal)
+{
+    if (temporal != nullptr)
+    {
+        if (film.getLayerIndex("depth") < 0)
+            film.addLayer("depth", "Z");
+        if (film.getLayerIndex("normal") < 0)
+            film.addLayer("normal", "XYZ");
+    }
+
+    bool exr = filenamePattern.size() >= 4 &&
+               filenamePattern.compare(filenamePattern.size() - 4, 4, ".exr") == 0;
+
+    for (int frame = firstFrame; frame <= lastFrame; frame++)
+    {
+        setFrame(frame);
+        renderer.render(film, spp);
+        if (temporal != nullptr)
+            temporal->accumulate(film, cam);
+
+        char filename[1024];
+        std::snprintf(filename, sizeof(filename), filenamePattern.c_str(), frame);
+        if (exr)
+            film.saveEXR(filename);
+        else
+            film.save(filename);
+    }
+}
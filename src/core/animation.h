@@ -0,0 +1,75 @@
+#ifndef ANIMATION_H
+#define ANIMATION_H
+
+#include <string>
+#include <vector>
+
+#include "film.h"
+#include "matrix4x4.h"
+#include "renderer.h"
+#include "scene.h"
+#include "temporalaccumulator.h"
+#include "../cameras/camera.h"
+#include "../shapes/sphere.h"
+#include "../shapes/trianglemesh.h"
+
+// Sequence of frames of one scene, with keyframed transforms for the camera
+// and for some of the objects. Going to a frame moves them in place and
+// refits the scene BVH (see Scene::refitBVH), so the scene, the film, the
+// threads of parallelFor and the acceleration structures all stay alive
+// from one frame to the next.
+// Keyframes are placed at (fractional) frame numbers. In between, the
+// transforms are interpolated element by element, as the motion keyframes of
+// Shape are (exact for translations and scales); before the first and after
+// the last keyframe they stay constant.
+class Animation
+{
+public:
+    Animation() = delete;
+    Animation(Camera &cam_, Scene &scene_);
+
+    void addCameraKeyframe(double frame, const Matrix4x4 &cameraToWorld);
+    void addKeyframe(Sphere *sphere, double frame, const Matrix4x4 &objectToWorld);
+    void addKeyframe(TriangleMesh *mesh, double frame, const Matrix4x4 &objectToWorld);
+
+    // Place the camera and the objects at the frame
+    void setFrame(double frame);
+
+    // Render the frames [firstFrame, lastFrame] with spp samples per pixel,
+    // saving each one to the file named by filenamePattern (printf style,
+    // e.g., "frame%04d.png"; ".exr" files are written by Film::saveEXR).
+    // With a temporal accumulator, each frame reuses the samples of the
+    // previous ones (the depth and normal layers it needs are added to the
+    // film), so that far fewer samples per frame are needed
+    void render(const Renderer &renderer, Film &film, int spp,
+                int firstFrame, int lastFrame, const std::string &filenamePattern,
+                TemporalAccumulator *temporal = nullptr);
+
+private:
+    struct Keyframe
+    {
+        double frame;
+        Matrix4x4 transform;
+    };
+
+    // Keyframes of an object, sorted by frame
+    struct Track
+    {
+        Sphere *sphere;
+        TriangleMesh *mesh;
+        std::vector<Keyframe> keyframes;
+    };
+
+    static void insertKeyframe(std::vector<Keyframe> &keyframes, double frame,
+                               const Matrix4x4 &transform);
+    static Matrix4x4 interpolate(const std::vector<Keyframe> &keyframes, double frame);
+
+    Track& findTrack(Sphere *sphere, TriangleMesh *mesh);
+
+    Camera &cam;
+    Scene &scene;
+    std::vector<Keyframe> cameraKeyframes;
+    std::vector<Track> tracks;
+};
+
+#endif // ANIMATION_H
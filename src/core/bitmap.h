@@ -2,8 +2,16 @@
 #define BITMAP_H
 
 #include "vector3d.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
 //#include <iostream>
 
+// The headers are stored field by field in little endian order with fixed
+// width integers: the layout of the file does not depend on the size of
+// "long" (8 bytes on Linux) nor on the padding of the structs.
+
 /**
  * @brief The bmp24_file_header struct
  */
@@ -11,12 +19,14 @@ struct bmp24_file_header
 {
     char      magic1;    // 'B'
     char      magic2;    // 'M'
-    long      size;      // 0
-    short int reserved1; // 0
-    short int reserved2; // 0
-    long      offbits;   // 14 + 40
+    uint32_t  size;      // Size of the file in bytes
+    uint16_t  reserved1; // 0
+    uint16_t  reserved2; // 0
+    uint32_t  offbits;   // 14 + 40
                          // (info header size) + (fileheader size)
 
+    static const size_t BYTES = 14;
+
     /**
      * @brief bmp24_file_header
      */
@@ -25,23 +35,41 @@ struct bmp24_file_header
     { }
 
     /**
-     * @brief toCharBlock
-     * @return
+     * @brief toBytes
+     * @param block BYTES bytes
      */
-    char *toCharBlock()
+    void toBytes(unsigned char *block) const
+    {
+        block[0] = (unsigned char)magic1;
+        block[1] = (unsigned char)magic2;
+        putLE(&block[2], size, 4);
+        putLE(&block[6], reserved1, 2);
+        putLE(&block[8], reserved2, 2);
+        putLE(&block[10], offbits, 4);
+    }
+
+    void fromBytes(const unsigned char *block)
+    {
+        magic1    = (char)block[0];
+        magic2    = (char)block[1];
+        size      = (uint32_t)getLE(&block[2], 4);
+        reserved1 = (uint16_t)getLE(&block[6], 2);
+        reserved2 = (uint16_t)getLE(&block[8], 2);
+        offbits   = (uint32_t)getLE(&block[10], 4);
+    }
+
+    static void putLE(unsigned char *p, uint32_t value, int bytes)
+    {
+        for (int i = 0; i < bytes; i++)
+            p[i] = (unsigned char)(value >> (8 * i));
+    }
+
+    static uint32_t getLE(const unsigned char *p, int bytes)
     {
-        // Allocate 14 bytes of memory
-        char* block = (char*)malloc(14);
-        block[0]  = magic1;
-        block[1]  = magic2;
-        memcpy((void*)&block[2],  &size, sizeof(size));
-        memcpy((void*)&block[6],  &reserved1, sizeof(reserved1));
-        memcpy((void*)&block[8],  &reserved2, sizeof(reserved2));
-        memcpy((void*)&block[10], &offbits, sizeof(offbits));
-        //long test = block[10];
-        //std::cout << "Writing offbits value " << offbits << ": " << test << std::endl;
-
-        return block;
+        uint32_t value = 0;
+        for (int i = 0; i < bytes; i++)
+            value |= (uint32_t)p[i] << (8 * i);
+        return value;
     }
 };
 
@@ -50,52 +78,75 @@ struct bmp24_file_header
  */
 struct bmp24_info_header
 {
-    long	  size;             // 40 (size of the info header block in bytes)
-    long	  width;            // img.width
-    long	  height;           // img.height
-    short int planes;           // 1
-    short int bit_count;        // 24
-    long	  compression;      // 0
-    long      size_image;       // (img.width * 3 + extra_bytes) * img.height
-    long	  x_pels_per_meter; // 2952
-    long	  y_pels_per_meter; // 2952
-    long	  clr_used;         // 0
-    long	  clr_important;    // 0
+    uint32_t  size;             // 40 (size of the info header block in bytes)
+    int32_t   width;            // img.width
+    int32_t   height;           // img.height (negative for top-down rows)
+    uint16_t  planes;           // 1
+    uint16_t  bit_count;        // 24
+    uint32_t  compression;      // 0
+    uint32_t  size_image;       // (img.width * 3 + extra_bytes) * img.height
+    int32_t   x_pels_per_meter; // 2952
+    int32_t   y_pels_per_meter; // 2952
+    uint32_t  clr_used;         // 0
+    uint32_t  clr_important;    // 0
+
+    static const size_t BYTES = 40;
+
+    bmp24_info_header() : bmp24_info_header(0, 0)
+    { }
 
     /**
      * @brief bmp24_info_header
      * @param width_
      * @param height_
+     * @param topDown Store the rows from the top one down
      */
-    bmp24_info_header(size_t width_, size_t height_) : size(40), planes(1), bit_count(24),
-                                   compression(0), x_pels_per_meter(2952),
-                                   y_pels_per_meter(2952), clr_used(0),
-                                   clr_important(0)
+    bmp24_info_header(size_t width_, size_t height_, bool topDown = false)
+        : size(40), planes(1), bit_count(24),
+          compression(0), x_pels_per_meter(2952),
+          y_pels_per_meter(2952), clr_used(0),
+          clr_important(0)
+    {
+        width  = (int32_t) width_;
+        height = topDown ? -(int32_t) height_ : (int32_t) height_;
+
+        size_image = (uint32_t)(rowBytes() * height_);
+    }
+
+    // Bytes per row, padded to a multiple of 4
+    size_t rowBytes() const
     {
-        width  = (long) width_;
-        height = (long) height_;
+        return ((size_t)width * 3 + 3) & ~(size_t)3;
+    }
 
-        int extra_bytes = (4 - (width * 3) % 4) % 4;
-        size_image = (width * 3 + extra_bytes) * height;
+    void toBytes(unsigned char *block) const
+    {
+        bmp24_file_header::putLE(&block[0],  size, 4);
+        bmp24_file_header::putLE(&block[4],  (uint32_t)width, 4);
+        bmp24_file_header::putLE(&block[8],  (uint32_t)height, 4);
+        bmp24_file_header::putLE(&block[12], planes, 2);
+        bmp24_file_header::putLE(&block[14], bit_count, 2);
+        bmp24_file_header::putLE(&block[16], compression, 4);
+        bmp24_file_header::putLE(&block[20], size_image, 4);
+        bmp24_file_header::putLE(&block[24], (uint32_t)x_pels_per_meter, 4);
+        bmp24_file_header::putLE(&block[28], (uint32_t)y_pels_per_meter, 4);
+        bmp24_file_header::putLE(&block[32], clr_used, 4);
+        bmp24_file_header::putLE(&block[36], clr_important, 4);
     }
 
-    char *toCharBlock()
+    void fromBytes(const unsigned char *block)
     {
-        char *block = (char *)malloc(40);
-
-        memcpy((void*)&block[0],  &size,   sizeof(long));
-        memcpy((void*)&block[4],  &width,  sizeof(long));
-        memcpy((void*)&block[8],  &height, sizeof(long));
-        memcpy((void*)&block[12], &planes, sizeof(short int));
-        memcpy((void*)&block[14], &bit_count,   sizeof(short int));
-        memcpy((void*)&block[16], &compression, sizeof(long));
-        memcpy((void*)&block[20], &size_image,  sizeof(long));
-        memcpy((void*)&block[24], &x_pels_per_meter, sizeof(long));
-        memcpy((void*)&block[28], &y_pels_per_meter, sizeof(long));
-        memcpy((void*)&block[32], &clr_used,         sizeof(long));
-        memcpy((void*)&block[36], &clr_important,    sizeof(long));
-
-        return block;
+        size             = bmp24_file_header::getLE(&block[0], 4);
+        width            = (int32_t)bmp24_file_header::getLE(&block[4], 4);
+        height           = (int32_t)bmp24_file_header::getLE(&block[8], 4);
+        planes           = (uint16_t)bmp24_file_header::getLE(&block[12], 2);
+        bit_count        = (uint16_t)bmp24_file_header::getLE(&block[14], 2);
+        compression      = bmp24_file_header::getLE(&block[16], 4);
+        size_image       = bmp24_file_header::getLE(&block[20], 4);
+        x_pels_per_meter = (int32_t)bmp24_file_header::getLE(&block[24], 4);
+        y_pels_per_meter = (int32_t)bmp24_file_header::getLE(&block[28], 4);
+        clr_used         = bmp24_file_header::getLE(&block[32], 4);
+        clr_important    = bmp24_file_header::getLE(&block[36], 4);
     }
 };
 
@@ -105,7 +156,6 @@ class BitMap
 public:
     BitMap();
 
-    static int save(Vector3D** &data, const size_t &width, const size_t &height);
     static int read(Vector3D** &dataOut, size_t &width, size_t &height, std::string &fileName);
 };
 
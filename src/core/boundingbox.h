@@ -0,0 +1,108 @@
+#ifndef BOUNDINGBOX_H
+#define BOUNDINGBOX_H
+
+#include <algorithm>
+#include <cmath>
+
+#include "vector3d.h"
+#include "ray.h"
+
+// Axis-aligned bounding box in world coordinates. A default constructed box
+// is empty; shapes which extend to infinity (e.g., InfinitePlan) report a box
+// which is not bounded.
+struct BoundingBox
+{
+    Vector3D pMin;
+    Vector3D pMax;
+
+    BoundingBox() : pMin(INFINITY), pMax(-INFINITY) { }
+    BoundingBox(const Vector3D &p) : pMin(p), pMax(p) { }
+
+    static BoundingBox unbounded()
+    {
+        BoundingBox b;
+        b.pMin = Vector3D(-INFINITY);
+        b.pMax = Vector3D(INFINITY);
+        return b;
+    }
+
+    void expand(const Vector3D &p)
+    {
+        pMin = Vector3D(std::min(pMin.x, p.x), std::min(pMin.y, p.y), std::min(pMin.z, p.z));
+        pMax = Vector3D(std::max(pMax.x, p.x), std::max(pMax.y, p.y), std::max(pMax.z, p.z));
+    }
+
+    void expand(const BoundingBox &b)
+    {
+        if (b.isEmpty())
+            return;
+        expand(b.pMin);
+        expand(b.pMax);
+    }
+
+    bool isEmpty() const { return pMin.x > pMax.x || pMin.y > pMax.y || pMin.z > pMax.z; }
+
+    bool isBounded() const
+    {
+        return !isEmpty() &&
+               std::isfinite(pMin.x) && std::isfinite(pMin.y) && std::isfinite(pMin.z) &&
+               std::isfinite(pMax.x) && std::isfinite(pMax.y) && std::isfinite(pMax.z);
+    }
+
+    Vector3D centroid() const { return (pMin + pMax) * 0.5; }
+
+    // Index (0, 1 or 2) of the longest axis
+    int maxExtent() const
+    {
+        Vector3D d = pMax - pMin;
+        if (d.x > d.y && d.x > d.z)
+            return 0;
+        return d.y > d.z ? 1 : 2;
+    }
+
+    double surfaceArea() const
+    {
+        if (isEmpty())
+            return 0.0;
+        Vector3D d = pMax - pMin;
+        return 2.0 * (d.x * d.y + d.x * d.z + d.y * d.z);
+    }
+
+    // Linear interpolation between the boxes b0 (s = 0) and b1 (s = 1)
+    static BoundingBox lerp(const BoundingBox &b0, const BoundingBox &b1, double s)
+    {
+        BoundingBox b;
+        b.pMin = b0.pMin * (1.0 - s) + b1.pMin * s;
+        b.pMax = b0.pMax * (1.0 - s) + b1.pMax * s;
+        return b;
+    }
+
+    // Slab test of the ray segment [ray.minT, ray.maxT] against the box.
+    // invDir holds the inverse of the ray direction components
+    bool rayIntersectP(const Ray &ray, const Vector3D &invDir) const
+    {
+        double t0 = ray.minT, t1 = ray.maxT;
+
+        double tNear = (pMin.x - ray.o.x) * invDir.x;
+        double tFar  = (pMax.x - ray.o.x) * invDir.x;
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = std::max(t0, tNear);
+        t1 = std::min(t1, tFar);
+
+        tNear = (pMin.y - ray.o.y) * invDir.y;
+        tFar  = (pMax.y - ray.o.y) * invDir.y;
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = std::max(t0, tNear);
+        t1 = std::min(t1, tFar);
+
+        tNear = (pMin.z - ray.o.z) * invDir.z;
+        tFar  = (pMax.z - ray.o.z) * invDir.z;
+        if (tNear > tFar) std::swap(tNear, tFar);
+        t0 = std::max(t0, tNear);
+        t1 = std::min(t1, tFar);
+
+        return t0 <= t1;
+    }
+};
+
+#endif // BOUNDINGBOX_H
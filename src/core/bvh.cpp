@@ -0,0 +1,351 @@
+#include "bvh.h"
+
+#include <algorithm>
+
+#include "../shapes/shape.h"
+
+// Maximum number of primitives in a leaf, and number of buckets used to
+// evaluate the SAH splits
+#define BVH_MAX_LEAF_PRIMITIVES 4
+#define BVH_NUM_BUCKETS 12
+
+// Depth after which the nodes are split in halves rather than with the SAH:
+// the halves add at most 32 more levels (for less than 2^32 primitives), so
+// the tree is never deeper than the traversal stack
+#define BVH_MAX_SAH_DEPTH 32
+#define BVH_STACK_SIZE 64
+
+BVH::BVH()
+    : store(nullptr), time0(0.0), time1(0.0), animated(false)
+{ }
+
+void BVH::clear()
+{
+    store = nullptr;
+    nodes.clear();
+    orderedPrimitives.clear();
+    unboundedPrimitives.clear();
+    time0 = time1 = 0.0;
+    animated = false;
+}
+
+bool BVH::isBuilt() const
+{
+    return store != nullptr;
+}
+
+size_t BVH::getNodeCount() const
+{
+    return nodes.size();
+}
+
+void BVH::build(const PrimitiveStore &store_)
+{
+    clear();
+    store = &store_;
+
+    const std::vector<PrimitiveRef> &prims = store->getPrimitives();
+
+    // Time interval covered by the keyframes of all the shapes
+    for (const PrimitiveRef &prim : prims)
+    {
+        double start, end;
+        if (!store->getShape(prim)->getMotionInterval(start, end))
+            continue;
+
+        if (!animated)
+        {
+            time0 = start;
+            time1 = end;
+            animated = true;
+        }
+        else
+        {
+            time0 = std::min(time0, start);
+            time1 = std::max(time1, end);
+        }
+    }
+
+    std::vector<BuildPrimitive> buildPrims;
+    buildPrims.reserve(prims.size());
+    for (const PrimitiveRef &prim : prims)
+    {
+        BuildPrimitive bp;
+        bp.ref = prim;
+        store->getShape(prim)->getMotionBounds(time0, time1, bp.bounds0, bp.bounds1);
+
+        if (!bp.bounds0.isBounded() || !bp.bounds1.isBounded())
+        {
+            unboundedPrimitives.push_back(prim);
+            continue;
+        }
+
+        bp.bounds = bp.bounds0;
+        bp.bounds.expand(bp.bounds1);
+        bp.centroid = bp.bounds.centroid();
+        buildPrims.push_back(bp);
+    }
+
+    if (buildPrims.empty())
+        return;
+
+    nodes.reserve(2 * buildPrims.size());
+    orderedPrimitives.reserve(buildPrims.size());
+    buildRecursive(buildPrims, 0, buildPrims.size(), 0);
+}
+
+void BVH::refit()
+{
+    // Children are stored after their parent, so a backwards pass sees
+    // them first
+    for (size_t n = nodes.size(); n > 0; n--)
+    {
+        Node &node = nodes[n - 1];
+        BoundingBox bounds0, bounds1;
+        if (node.numPrimitives > 0)
+        {
+            for (unsigned int i = 0; i < node.numPrimitives; i++)
+            {
+                BoundingBox b0, b1;
+                const PrimitiveRef &prim = orderedPrimitives[node.offset + i];
+                store->getShape(prim)->getMotionBounds(time0, time1, b0, b1);
+                bounds0.expand(b0);
+                bounds1.expand(b1);
+            }
+        }
+        else
+        {
+            const Node &first = nodes[n];
+            const Node &second = nodes[node.offset];
+            bounds0 = first.bounds0;
+            bounds0.expand(second.bounds0);
+            bounds1 = first.bounds1;
+            bounds1.expand(second.bounds1);
+        }
+        node.bounds0 = bounds0;
+        node.bounds1 = bounds1;
+    }
+}
+
+unsigned int BVH::buildRecursive(std::vector<BuildPrimitive> &buildPrims,
+                                 size_t start, size_t end, int depth)
+{
+    unsigned int nodeIndex = (unsigned int)nodes.size();
+    nodes.push_back(Node());
+
+    BoundingBox bounds0, bounds1, bounds, centroidBounds;
+    for (size_t i = start; i < end; i++)
+    {
+        bounds0.expand(buildPrims[i].bounds0);
+        bounds1.expand(buildPrims[i].bounds1);
+        bounds.expand(buildPrims[i].bounds);
+        centroidBounds.expand(buildPrims[i].centroid);
+    }
+    nodes[nodeIndex].bounds0 = bounds0;
+    nodes[nodeIndex].bounds1 = bounds1;
+
+    size_t numPrims = end - start;
+    int axis = centroidBounds.maxExtent();
+    double axisMin = axis == 0 ? centroidBounds.pMin.x : axis == 1 ? centroidBounds.pMin.y : centroidBounds.pMin.z;
+    double axisMax = axis == 0 ? centroidBounds.pMax.x : axis == 1 ? centroidBounds.pMax.y : centroidBounds.pMax.z;
+
+    auto centroidOnAxis = [axis](const BuildPrimitive &bp) {
+        return axis == 0 ? bp.centroid.x : axis == 1 ? bp.centroid.y : bp.centroid.z;
+    };
+
+    // Choose the split with the surface area heuristic
+    size_t mid = start;
+    if (numPrims > 1 && axisMax > axisMin && depth < BVH_MAX_SAH_DEPTH)
+    {
+        BoundingBox bucketBounds[BVH_NUM_BUCKETS];
+        int bucketCount[BVH_NUM_BUCKETS] = { 0 };
+
+        auto bucketOf = [&](const BuildPrimitive &bp) {
+            int b = (int)(BVH_NUM_BUCKETS * (centroidOnAxis(bp) - axisMin) / (axisMax - axisMin));
+            return std::min(b, BVH_NUM_BUCKETS - 1);
+        };
+
+        for (size_t i = start; i < end; i++)
+        {
+            int b = bucketOf(buildPrims[i]);
+            bucketCount[b]++;
+            bucketBounds[b].expand(buildPrims[i].bounds);
+        }
+
+        // Cost of splitting after each bucket (traversal cost 1/8 of an
+        // intersection test)
+        double bestCost = INFINITY;
+        int bestSplit = 0;
+        for (int s = 0; s < BVH_NUM_BUCKETS - 1; s++)
+        {
+            BoundingBox left, right;
+            int countLeft = 0, countRight = 0;
+            for (int b = 0; b <= s; b++)
+            {
+                left.expand(bucketBounds[b]);
+                countLeft += bucketCount[b];
+            }
+            for (int b = s + 1; b < BVH_NUM_BUCKETS; b++)
+            {
+                right.expand(bucketBounds[b]);
+                countRight += bucketCount[b];
+            }
+
+            double cost = 0.125 + (countLeft * left.surfaceArea() +
+                                   countRight * right.surfaceArea()) / bounds.surfaceArea();
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestSplit = s;
+            }
+        }
+
+        if (numPrims > BVH_MAX_LEAF_PRIMITIVES || bestCost < (double)numPrims)
+        {
+            auto split = std::partition(buildPrims.begin() + start, buildPrims.begin() + end,
+                [&](const BuildPrimitive &bp) { return bucketOf(bp) <= bestSplit; });
+            mid = split - buildPrims.begin();
+        }
+    }
+
+    // Leaf when the SAH prefers it, or when there was no split to evaluate
+    // (centroids all at the same place, or tree too deep) but few enough
+    // primitives. Otherwise the halves are taken, in the order of the
+    // centroids or, when they coincide, in any order
+    if (mid == start || mid == end)
+    {
+        if (numPrims <= BVH_MAX_LEAF_PRIMITIVES)
+        {
+            nodes[nodeIndex].offset = (unsigned int)orderedPrimitives.size();
+            nodes[nodeIndex].numPrimitives = (unsigned short)numPrims;
+            for (size_t i = start; i < end; i++)
+                orderedPrimitives.push_back(buildPrims[i].ref);
+            return nodeIndex;
+        }
+
+        mid = (start + end) / 2;
+        std::nth_element(buildPrims.begin() + start, buildPrims.begin() + mid, buildPrims.begin() + end,
+            [&](const BuildPrimitive &a, const BuildPrimitive &b) { return centroidOnAxis(a) < centroidOnAxis(b); });
+    }
+
+    nodes[nodeIndex].numPrimitives = 0;
+    nodes[nodeIndex].axis = (unsigned char)axis;
+    buildRecursive(buildPrims, start, mid, depth + 1);
+    unsigned int secondChild = buildRecursive(buildPrims, mid, end, depth + 1);
+    nodes[nodeIndex].offset = secondChild;
+
+    return nodeIndex;
+}
+
+BoundingBox BVH::nodeBounds(const Node &node, double time) const
+{
+    if (!animated)
+        return node.bounds0;
+
+    double s = time1 > time0 ? (time - time0) / (time1 - time0) : 0.0;
+    s = std::min(1.0, std::max(0.0, s));
+    return BoundingBox::lerp(node.bounds0, node.bounds1, s);
+}
+
+bool BVH::rayIntersect(const Ray &ray, Intersection &its) const
+{
+    bool hasIntersection = false;
+
+    for (const PrimitiveRef &prim : unboundedPrimitives)
+        if (store->rayIntersect(prim, ray, its))
+            hasIntersection = true;
+
+    if (nodes.empty())
+        return hasIntersection;
+
+    Vector3D invDir(1.0 / ray.d.x, 1.0 / ray.d.y, 1.0 / ray.d.z);
+    bool dirIsNeg[3] = { invDir.x < 0, invDir.y < 0, invDir.z < 0 };
+
+    // Visit the nodes front to back, so that ray.maxT shrinks early
+    unsigned int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    unsigned int current = 0;
+
+    while (true)
+    {
+        const Node &node = nodes[current];
+        if (nodeBounds(node, ray.time).rayIntersectP(ray, invDir))
+        {
+            if (node.numPrimitives > 0)
+            {
+                for (unsigned int i = 0; i < node.numPrimitives; i++)
+                    if (store->rayIntersect(orderedPrimitives[node.offset + i], ray, its))
+                        hasIntersection = true;
+
+                if (stackSize == 0)
+                    break;
+                current = stack[--stackSize];
+            }
+            else if (dirIsNeg[node.axis])
+            {
+                stack[stackSize++] = current + 1;
+                current = node.offset;
+            }
+            else
+            {
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        }
+        else
+        {
+            if (stackSize == 0)
+                break;
+            current = stack[--stackSize];
+        }
+    }
+
+    return hasIntersection;
+}
+
+bool BVH::rayIntersectP(const Ray &ray) const
+{
+    for (const PrimitiveRef &prim : unboundedPrimitives)
+        if (store->rayIntersectP(prim, ray))
+            return true;
+
+    if (nodes.empty())
+        return false;
+
+    Vector3D invDir(1.0 / ray.d.x, 1.0 / ray.d.y, 1.0 / ray.d.z);
+
+    unsigned int stack[BVH_STACK_SIZE];
+    int stackSize = 0;
+    unsigned int current = 0;
+
+    while (true)
+    {
+        const Node &node = nodes[current];
+        if (nodeBounds(node, ray.time).rayIntersectP(ray, invDir))
+        {
+            if (node.numPrimitives > 0)
+            {
+                for (unsigned int i = 0; i < node.numPrimitives; i++)
+                    if (store->rayIntersectP(orderedPrimitives[node.offset + i], ray))
+                        return true;
+
+                if (stackSize == 0)
+                    break;
+                current = stack[--stackSize];
+            }
+            else
+            {
+                stack[stackSize++] = node.offset;
+                current = current + 1;
+            }
+        }
+        else
+        {
+            if (stackSize == 0)
+                break;
+            current = stack[--stackSize];
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,78 @@
+#ifndef BVH_H
+#define BVH_H
+
+#include <vector>
+
+#include "boundingbox.h"
+#include "primitivestore.h"
+
+// Bounding volume hierarchy over the primitives of a PrimitiveStore, built
+// with the surface area heuristic. Every node keeps its bounds at the start
+// (bounds0) and at the end (bounds1) of the scene motion, and a ray is tested
+// against the bounds interpolated at ray.time, so moving shapes only enlarge
+// the nodes they belong to by what they travel during the shutter.
+// Unbounded primitives (infinite plans) are tested apart from the tree.
+class BVH
+{
+public:
+    BVH();
+
+    // Build the tree over all the primitives of the store. The store must
+    // not change while the tree is in use
+    void build(const PrimitiveStore &store_);
+    void clear();
+
+    // Recompute the bounds of every node after the primitives moved,
+    // keeping the tree: a bottom-up pass over the nodes, much cheaper than
+    // build(). The tree gets slower to traverse the further the primitives
+    // move from where it was built
+    void refit();
+    bool isBuilt() const;
+
+    size_t getNodeCount() const;
+
+    // Ray/scene intersection methods
+    bool rayIntersect(const Ray &ray, Intersection &its) const;
+    bool rayIntersectP(const Ray &ray) const;
+
+private:
+    // Primitive data used during the construction
+    struct BuildPrimitive
+    {
+        PrimitiveRef ref;
+        BoundingBox bounds0;
+        BoundingBox bounds1;
+        BoundingBox bounds;   // Union of bounds0 and bounds1
+        Vector3D centroid;
+    };
+
+    // Flattened node. The first child of an interior node is the next node
+    // in the array; "offset" holds the second child of an interior node, or
+    // the first entry of orderedPrimitives for a leaf
+    struct Node
+    {
+        BoundingBox bounds0;
+        BoundingBox bounds1;
+        unsigned int offset;
+        unsigned short numPrimitives;   // 0 for interior nodes
+        unsigned char axis;             // Split axis of interior nodes
+    };
+
+    unsigned int buildRecursive(std::vector<BuildPrimitive> &buildPrims,
+                                size_t start, size_t end, int depth);
+
+    // Node bounds at ray.time
+    BoundingBox nodeBounds(const Node &node, double time) const;
+
+    const PrimitiveStore *store;
+    std::vector<Node> nodes;
+    std::vector<PrimitiveRef> orderedPrimitives;
+    std::vector<PrimitiveRef> unboundedPrimitives;
+
+    // Time interval spanned by the motion of the scene
+    double time0;
+    double time1;
+    bool animated;
+};
+
+#endif // BVH_H
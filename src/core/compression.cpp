@@ -0,0 +1,60 @@
+#include "compression.h"
+
+#include <cmath>
+#include <cstring>
+
+#define TINYEXR_IMPLEMENTATION
+#include "tinyexr.h"
+
+std::vector<unsigned char> deflateBlock(const unsigned char *data, size_t size, bool last,
+                                        int level)
+{
+    using namespace tinyexr::miniz;
+
+    mz_stream stream;
+    memset(&stream, 0, sizeof(stream));
+    mz_deflateInit2(&stream, level, MZ_DEFLATED, -MZ_DEFAULT_WINDOW_BITS, 9, MZ_DEFAULT_STRATEGY);
+
+    // Room for incompressible data, the block headers and the flush marker
+    std::vector<unsigned char> out(mz_deflateBound(&stream, (mz_ulong)size) + 16);
+    stream.next_in = data;
+    stream.avail_in = (unsigned int)size;
+    stream.next_out = out.data();
+    stream.avail_out = (unsigned int)out.size();
+    mz_deflate(&stream, last ? MZ_FINISH : MZ_SYNC_FLUSH);
+
+    out.resize(stream.total_out);
+    mz_deflateEnd(&stream);
+    return out;
+}
+
+std::vector<unsigned char> compressEXRZip(const std::vector<unsigned char> &raw)
+{
+    std::vector<unsigned char> block(tinyexr::miniz::mz_compressBound((unsigned long)raw.size()));
+    tinyexr::tinyexr_uint64 compressedSize = block.size();
+    tinyexr::CompressZip(block.data(), compressedSize, raw.data(), (unsigned long)raw.size());
+    block.resize((size_t)compressedSize);
+    return block;
+}
+
+std::vector<unsigned char> compressEXRPiz(const std::vector<unsigned char> &raw, size_t numChannels,
+                                          bool halfFloat, int width, int lines)
+{
+    std::vector<tinyexr::ChannelInfo> channelInfos(numChannels);
+    for (tinyexr::ChannelInfo &info : channelInfos)
+        info.pixel_type = halfFloat ? TINYEXR_PIXELTYPE_HALF : TINYEXR_PIXELTYPE_FLOAT;
+
+    std::vector<unsigned char> block(8192 + 2 * raw.size());
+    unsigned int blockSize = (unsigned int)raw.size();
+    tinyexr::CompressPiz(block.data(), &blockSize, raw.data(), raw.size(),
+                         channelInfos, width, lines);
+    block.resize(blockSize);
+    return block;
+}
+
+unsigned short floatToHalf(float value)
+{
+    tinyexr::FP32 f32;
+    f32.f = value;
+    return tinyexr::float_to_half_full(f32).u;
+}
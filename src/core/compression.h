@@ -0,0 +1,27 @@
+#ifndef COMPRESSION_H
+#define COMPRESSION_H
+
+#include <cstddef>
+#include <vector>
+
+// Compressors of the image writers, built on the miniz and the EXR codecs
+// bundled in tinyexr. The implementation of tinyexr lives in compression.cpp,
+// which is the only place its internals are reachable from.
+
+// Raw deflate compression (no zlib header). Unless "last", the output ends
+// on a byte boundary (sync flush), so that blocks compressed apart can be
+// concatenated into one stream, e.g., for the PNG files of LDRWriter
+std::vector<unsigned char> deflateBlock(const unsigned char *data, size_t size, bool last,
+                                        int level = 6);
+
+// Pixel data of an EXR chunk (for every line, width values of each of the
+// numChannels channels in turn, as half or full floats), compressed as the
+// chunks of the ZIP and PIZ files
+std::vector<unsigned char> compressEXRZip(const std::vector<unsigned char> &raw);
+std::vector<unsigned char> compressEXRPiz(const std::vector<unsigned char> &raw, size_t numChannels,
+                                          bool halfFloat, int width, int lines);
+
+// Bits of the half float closest to value, as stored in the EXR files
+unsigned short floatToHalf(float value);
+
+#endif // COMPRESSION_H
@@ -0,0 +1,300 @@
+#include "coordinator.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <iostream>
+#include <vector>
+
+#ifndef _WIN32
+#include <csignal>
+#include <cerrno>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "parallel.h"
+#include "utils.h"
+
+// Messages to the workers are a pass index or WORKER_FINISH. The workers
+// answer every pass with WORKER_PASS_DONE and WORKER_FINISH with
+// WORKER_RESULT, the byte size of their accumulator and the accumulator
+#define WORKER_FINISH 0xffffffffu
+#define WORKER_PASS_DONE 1u
+#define WORKER_RESULT 2u
+
+RenderCoordinator::RenderCoordinator(const Renderer &renderer_)
+    : numWorkers(0), renderer(renderer_)
+{ }
+
+#ifndef _WIN32
+
+static bool writeAll(int fd, const void *data, size_t size)
+{
+    const char *p = (const char*)data;
+    while (size > 0)
+    {
+        ssize_t n = write(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+static bool readAll(int fd, void *data, size_t size)
+{
+    char *p = (char*)data;
+    while (size > 0)
+    {
+        ssize_t n = read(fd, p, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        p += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// Main loop of a worker process: render the passes it is sent into an
+// accumulator of its own, and send that back when told to finish
+static void runWorker(const Renderer &renderer, const Accumulator &accumulator, int sppPerPass,
+                      int input, int output)
+{
+    Accumulator local(accumulator.getWidth(), accumulator.getHeight(), accumulator.getSeed());
+    Film pass(accumulator.getWidth(), accumulator.getHeight());
+
+    uint32_t message;
+    while (readAll(input, &message, sizeof(message)) && message != WORKER_FINISH)
+    {
+        renderer.renderPass(pass, sppPerPass, accumulator.getPassSeed(message));
+        local.addPass(pass, sppPerPass);
+
+        uint32_t answer = WORKER_PASS_DONE;
+        if (!writeAll(output, &answer, sizeof(answer)))
+            return;
+    }
+    if (message != WORKER_FINISH)
+        return;
+
+    std::vector<unsigned char> data = local.serialize();
+    uint32_t answer = WORKER_RESULT;
+    uint64_t size = data.size();
+    writeAll(output, &answer, sizeof(answer));
+    writeAll(output, &size, sizeof(size));
+    writeAll(output, data.data(), data.size());
+}
+
+namespace
+{
+    struct Worker
+    {
+        pid_t pid;
+        int input, output;              // Pipe ends of the coordinator
+        bool busy;
+        uint32_t pass;                  // Pass being rendered, if busy
+        std::vector<uint32_t> donePasses;
+    };
+}
+
+void RenderCoordinator::renderPasses(Accumulator &accumulator, int numPasses, int sppPerPass) const
+{
+    if (numPasses <= 0)
+        return;
+
+    std::deque<uint32_t> pending;
+    for (int p = 0; p < numPasses; p++)
+        pending.push_back(accumulator.getPassCount() + (uint32_t)p);
+
+    // A worker which died must not kill the coordinator when it is written to
+    void (*previousHandler)(int) = signal(SIGPIPE, SIG_IGN);
+
+    unsigned int count = numWorkers > 0 ? numWorkers : getDefaultThreadCount();
+    count = std::min(count, (unsigned int)numPasses);
+
+    std::vector<Worker> workers;
+    for (unsigned int i = 0; i < count; i++)
+    {
+        int toWorker[2], fromWorker[2];
+        if (pipe(toWorker) != 0)
+            break;
+        if (pipe(fromWorker) != 0)
+        {
+            close(toWorker[0]);
+            close(toWorker[1]);
+            break;
+        }
+
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            for (const Worker &other : workers)
+            {
+                close(other.input);
+                close(other.output);
+            }
+            close(toWorker[1]);
+            close(fromWorker[0]);
+            runWorker(renderer, accumulator, sppPerPass, toWorker[0], fromWorker[1]);
+            _exit(0);
+        }
+
+        close(toWorker[0]);
+        close(fromWorker[1]);
+        if (pid < 0)
+        {
+            close(toWorker[1]);
+            close(fromWorker[0]);
+            break;
+        }
+        workers.push_back({ pid, fromWorker[0], toWorker[1], false, 0, {} });
+    }
+    if (workers.size() < count)
+        std::cout << "RenderCoordinator: only " << workers.size() << " of " << count
+                  << " workers could be started" << std::endl;
+
+    size_t passesDone = 0;
+
+    // Stop a worker, and give its passes (done or not) back to the queue
+    auto lose = [&](Worker &worker) {
+        std::cout << "RenderCoordinator: lost the worker " << worker.pid << std::endl;
+        if (worker.busy)
+            pending.push_back(worker.pass);
+        pending.insert(pending.end(), worker.donePasses.begin(), worker.donePasses.end());
+        passesDone -= worker.donePasses.size();
+        worker.donePasses.clear();
+        worker.busy = false;
+
+        close(worker.input);
+        close(worker.output);
+        kill(worker.pid, SIGKILL);
+        waitpid(worker.pid, nullptr, 0);
+        worker.pid = -1;
+    };
+
+    auto dispatch = [&](Worker &worker) {
+        if (pending.empty())
+            return;
+        uint32_t pass = pending.front();
+        pending.pop_front();
+        worker.busy = true;
+        worker.pass = pass;
+        if (!writeAll(worker.output, &pass, sizeof(pass)))
+            lose(worker);
+    };
+
+    Utils::printProgress(0.0);
+    while (passesDone < (size_t)numPasses)
+    {
+        for (Worker &worker : workers)
+        {
+            if (worker.pid > 0 && !worker.busy)
+                dispatch(worker);
+        }
+
+        std::vector<pollfd> fds;
+        std::vector<Worker*> polled;
+        for (Worker &worker : workers)
+        {
+            if (worker.pid > 0 && worker.busy)
+            {
+                fds.push_back({ worker.input, POLLIN, 0 });
+                polled.push_back(&worker);
+            }
+        }
+        if (fds.empty())
+            break;
+
+        if (poll(fds.data(), fds.size(), -1) < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+
+        for (size_t i = 0; i < fds.size(); i++)
+        {
+            if (fds[i].revents == 0)
+                continue;
+
+            Worker &worker = *polled[i];
+            uint32_t answer;
+            if (!readAll(worker.input, &answer, sizeof(answer)) || answer != WORKER_PASS_DONE)
+            {
+                lose(worker);
+                continue;
+            }
+            worker.donePasses.push_back(worker.pass);
+            worker.busy = false;
+            passesDone++;
+            Utils::printProgress((double)passesDone / (double)numPasses);
+        }
+    }
+
+    // Collect the accumulators of the workers
+    for (Worker &worker : workers)
+    {
+        if (worker.pid <= 0)
+            continue;
+
+        uint32_t message = WORKER_FINISH;
+        uint32_t answer = 0;
+        uint64_t size = 0;
+        std::vector<unsigned char> data;
+        bool received = writeAll(worker.output, &message, sizeof(message)) &&
+                        readAll(worker.input, &answer, sizeof(answer)) && answer == WORKER_RESULT &&
+                        readAll(worker.input, &size, sizeof(size));
+        if (received)
+        {
+            data.resize((size_t)size);
+            received = readAll(worker.input, data.data(), data.size());
+        }
+
+        Accumulator result(accumulator.getWidth(), accumulator.getHeight(), accumulator.getSeed());
+        if (!received || !result.deserialize(data.data(), data.size()) || !accumulator.merge(result))
+        {
+            lose(worker);
+            continue;
+        }
+
+        close(worker.input);
+        close(worker.output);
+        waitpid(worker.pid, nullptr, 0);
+        worker.pid = -1;
+    }
+
+    signal(SIGPIPE, previousHandler);
+
+    // Whatever the workers could not render is rendered here
+    if (!pending.empty())
+    {
+        std::cout << "RenderCoordinator: rendering " << pending.size() << " passes locally" << std::endl;
+        Film pass(accumulator.getWidth(), accumulator.getHeight());
+        for (uint32_t index : pending)
+        {
+            renderer.renderPass(pass, sppPerPass, accumulator.getPassSeed(index));
+            accumulator.addPass(pass, sppPerPass);
+        }
+    }
+    Utils::printProgress(1.0);
+
+    if (!renderer.checkpointFile.empty() && !accumulator.save(renderer.checkpointFile))
+        std::cout << "RenderCoordinator: could not write the checkpoint \"" << renderer.checkpointFile << "\"" << std::endl;
+}
+
+#else
+
+// No fork() here: the passes are rendered by the process itself
+void RenderCoordinator::renderPasses(Accumulator &accumulator, int numPasses, int sppPerPass) const
+{
+    renderer.renderPasses(accumulator, numPasses, sppPerPass);
+}
+
+#endif
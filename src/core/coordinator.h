@@ -0,0 +1,36 @@
+#ifndef COORDINATOR_H
+#define COORDINATOR_H
+
+#include "accumulator.h"
+#include "renderer.h"
+
+// Renders the passes of a progressive render (see Renderer::renderPasses) on
+// several worker processes of the local machine. The workers are forked from
+// the process, so they share its scene, camera and shader without any
+// loading, and each one renders single-threaded like the Renderer does.
+// The coordinator hands out pass indices one at a time over a pipe per
+// worker, so that faster workers get more passes. At the end every worker
+// sends back its sums and sample counts, which are merged into the
+// accumulator. Since each pass is seeded from its index, the image is the
+// same as a single process render of the same passes. The passes of a
+// worker which dies are rendered again by the others, or by the coordinator
+// itself if none is left.
+class RenderCoordinator
+{
+public:
+    RenderCoordinator() = delete;
+    RenderCoordinator(const Renderer &renderer_);
+
+    // Add numPasses passes of sppPerPass samples per pixel to the
+    // accumulator, and save it to the checkpoint file of the renderer (if
+    // any) at the end
+    void renderPasses(Accumulator &accumulator, int numPasses, int sppPerPass) const;
+
+    // Settings
+    unsigned int numWorkers;    // 0 = one per hardware thread
+
+private:
+    const Renderer &renderer;
+};
+
+#endif // COORDINATOR_H
@@ -0,0 +1,199 @@
+#include "denoiser.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#include "parallel.h"
+#include "utils.h"
+
+// Albedos below this are not divided out, to avoid amplifying the noise of
+// almost black surfaces
+#define DENOISER_MIN_ALBEDO 0.01
+
+Denoiser::Denoiser()
+    : numIterations(4), sigmaColor(0.5), sigmaVariance(4.0), sigmaNormal(64.0), sigmaDepth(0.05),
+      sigmaAlbedo(0.1), numThreads(0)
+{ }
+
+bool Denoiser::denoise(Film &film) const
+{
+    int albedoLayer = film.getLayerIndex("albedo");
+    int normalLayer = film.getLayerIndex("normal");
+    int depthLayer = film.getLayerIndex("depth");
+    if (albedoLayer < 0 || normalLayer < 0 || depthLayer < 0)
+    {
+        std::cout << "Denoiser: the film needs the albedo, normal and depth layers" << std::endl;
+        return false;
+    }
+
+    int varianceLayer = film.getLayerIndex("variance");
+    int samplesLayer = film.getLayerIndex("samples");
+
+    const int width = (int)film.getWidth();
+    const int height = (int)film.getHeight();
+    const size_t numPixels = (size_t)width * height;
+
+    // Feature buffers and demodulated illumination, row major
+    std::vector<Vector3D> illumination(numPixels), pixelAlbedo(numPixels), pixelNormal(numPixels);
+    std::vector<double> pixelDepth(numPixels);
+    double meanLuminance = 0.0;
+
+    // Variance of the illumination of each pixel (of its mean over the
+    // samples), summed over the channels
+    std::vector<double> pixelVariance;
+    double totalVariance = 0.0;
+    if (varianceLayer >= 0)
+        pixelVariance.assign(numPixels, 0.0);
+
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            size_t i = (size_t)y * width + x;
+            Vector3D a = film.getLayerValue(albedoLayer, x, y);
+            a = Vector3D(std::max((double)a.x, DENOISER_MIN_ALBEDO),
+                         std::max((double)a.y, DENOISER_MIN_ALBEDO),
+                         std::max((double)a.z, DENOISER_MIN_ALBEDO));
+            Vector3D n = film.getLayerValue(normalLayer, x, y);
+
+            pixelAlbedo[i] = a;
+            pixelNormal[i] = n.lengthSq() > 0.0 ? n.normalized() : Vector3D(0.0);
+            pixelDepth[i] = film.getLayerValue(depthLayer, x, y).x;
+            illumination[i] = film.getPixelValue(x, y) / a;
+            meanLuminance += Utils::luminance(illumination[i]);
+
+            if (varianceLayer >= 0)
+            {
+                Vector3D v = film.getLayerValue(varianceLayer, x, y);
+                double spp = samplesLayer >= 0 ? std::max(1.0, (double)film.getLayerValue(samplesLayer, x, y).x) : 1.0;
+                pixelVariance[i] = (v.x / (a.x * a.x) + v.y / (a.y * a.y) + v.z / (a.z * a.z)) / spp;
+                totalVariance += pixelVariance[i];
+            }
+        }
+    }
+    meanLuminance = std::max(meanLuminance / (double)numPixels, 1e-6);
+
+    // A single sample per pixel gives no variance
+    bool useVariance = totalVariance > 0.0;
+
+    const double kernel[5] = { 1.0 / 16.0, 1.0 / 4.0, 3.0 / 8.0, 1.0 / 4.0, 1.0 / 16.0 };
+    std::vector<Vector3D> filtered(numPixels);
+    std::vector<double> filteredVariance(useVariance ? numPixels : 0);
+
+    for (int iteration = 0; iteration < numIterations; iteration++)
+    {
+        int step = 1 << iteration;
+
+        // The color is less noisy after each pass: tighten its threshold.
+        // The variance of the pixels is filtered along instead
+        double sigmaC = sigmaColor * meanLuminance / (double)step;
+        double invSigmaC2 = 1.0 / (sigmaC * sigmaC);
+
+        parallelFor((size_t)height, [&](size_t rowBegin, size_t rowEnd) {
+            for (int y = (int)rowBegin; y < (int)rowEnd; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    size_t p = (size_t)y * width + x;
+                    const Vector3D &cp = illumination[p];
+                    const Vector3D &np = pixelNormal[p];
+                    const Vector3D &ap = pixelAlbedo[p];
+                    double zp = pixelDepth[p];
+
+                    // The variance of one pixel is itself noisy: it is
+                    // taken from the 3x3 pixels around
+                    double invSigmaP2 = invSigmaC2;
+                    if (useVariance)
+                    {
+                        const double gaussian[3] = { 1.0 / 4.0, 1.0 / 2.0, 1.0 / 4.0 };
+                        double variance = 0.0, weight = 0.0;
+                        for (int dy = -1; dy <= 1; dy++)
+                        {
+                            for (int dx = -1; dx <= 1; dx++)
+                            {
+                                int qx = x + dx, qy = y + dy;
+                                if (qx < 0 || qx >= width || qy < 0 || qy >= height)
+                                    continue;
+                                double g = gaussian[dx + 1] * gaussian[dy + 1];
+                                variance += g * pixelVariance[(size_t)qy * width + qx];
+                                weight += g;
+                            }
+                        }
+                        invSigmaP2 = 1.0 / (sigmaVariance * sigmaVariance * std::max(variance / weight, 1e-12));
+                    }
+
+                    Vector3D sum(0.0);
+                    double weightSum = 0.0;
+                    double varianceSum = 0.0;
+
+                    for (int dy = -2; dy <= 2; dy++)
+                    {
+                        int qy = y + dy * step;
+                        if (qy < 0 || qy >= height)
+                            continue;
+
+                        for (int dx = -2; dx <= 2; dx++)
+                        {
+                            int qx = x + dx * step;
+                            if (qx < 0 || qx >= width)
+                                continue;
+
+                            size_t q = (size_t)qy * width + qx;
+                            double h = kernel[dx + 2] * kernel[dy + 2];
+
+                            Vector3D dc = illumination[q] - cp;
+                            double wColor = std::exp(-dot(dc, dc) * invSigmaP2);
+
+                            // Hits and misses (normal 0) do not mix
+                            double wNormal;
+                            if (np.lengthSq() == 0.0 || pixelNormal[q].lengthSq() == 0.0)
+                                wNormal = (np.lengthSq() == pixelNormal[q].lengthSq()) ? 1.0 : 0.0;
+                            else
+                                wNormal = std::pow(std::max(0.0, dot(np, pixelNormal[q])), sigmaNormal);
+
+                            double wDepth = 1.0;
+                            if (dx != 0 || dy != 0)
+                            {
+                                double distance = step * std::sqrt((double)(dx * dx + dy * dy));
+                                double dz = std::abs(pixelDepth[q] - zp) /
+                                            (sigmaDepth * std::max(zp, 1e-6) * distance);
+                                wDepth = std::exp(-dz);
+                            }
+
+                            Vector3D da = pixelAlbedo[q] - ap;
+                            double wAlbedo = std::exp(-dot(da, da) / (sigmaAlbedo * sigmaAlbedo));
+
+                            double w = h * wColor * wNormal * wDepth * wAlbedo;
+                            sum += illumination[q] * w;
+                            weightSum += w;
+                            if (useVariance)
+                                varianceSum += w * w * pixelVariance[q];
+                        }
+                    }
+
+                    filtered[p] = weightSum > 0.0 ? sum / weightSum : cp;
+                    if (useVariance)
+                        filteredVariance[p] = weightSum > 0.0 ? varianceSum / (weightSum * weightSum) : pixelVariance[p];
+                }
+            }
+        }, numThreads);
+
+        illumination.swap(filtered);
+        if (useVariance)
+            pixelVariance.swap(filteredVariance);
+    }
+
+    // Put the albedo back
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            size_t i = (size_t)y * width + x;
+            Vector3D value = illumination[i] * pixelAlbedo[i];
+            film.setPixelValue(x, y, value);
+        }
+    }
+    return true;
+}
@@ -0,0 +1,40 @@
+#ifndef DENOISER_H
+#define DENOISER_H
+
+#include "film.h"
+
+// Edge-avoiding a-trous wavelet filter (Dammertz et al., "Edge-Avoiding
+// A-Trous Wavelet Transform for fast Global Illumination Filtering").
+// The color is divided by the albedo of the first hit, so that textures and
+// material edges are kept, and the remaining illumination is smoothed with
+// a 5x5 B3-spline kernel whose taps get further apart at every iteration.
+// Each tap is weighted down when its color, normal, depth or albedo differ
+// from those of the filtered pixel. The features are the "albedo", "normal"
+// and "depth" layers of the film, as written by Renderer.
+// When the film also has the "variance" layer (and "samples"), the color
+// weight follows the noise of each pixel, as in SVGF (Schied et al.,
+// "Spatiotemporal Variance-Guided Filtering"): the difference of colors is
+// measured against the standard deviation of the pixel (smoothed over its
+// 3x3 neighbours), which is filtered along with the color at every
+// iteration. Otherwise it is measured against
+// the mean luminance of the image.
+class Denoiser
+{
+public:
+    Denoiser();
+
+    // Filter the image of the film in place. Returns false if the film lacks
+    // one of the feature layers
+    bool denoise(Film &film) const;
+
+    // Settings
+    int numIterations;          // Filter radius is 2^(numIterations+1) pixels
+    double sigmaColor;          // Relative to the mean luminance of the image
+    double sigmaVariance;       // Relative to the standard deviation of the pixel
+    double sigmaNormal;         // Exponent of the cosine between the normals
+    double sigmaDepth;          // Relative depth difference per pixel of distance
+    double sigmaAlbedo;
+    unsigned int numThreads;    // 0 = all the hardware threads
+};
+
+#endif // DENOISER_H
@@ -0,0 +1,95 @@
+#include "distribution.h"
+
+#include <algorithm>
+
+Distribution1D::Distribution1D()
+    : integral(0.0)
+{ }
+
+Distribution1D::Distribution1D(const double *f, int n)
+    : func(f, f + n), cdf(n + 1)
+{
+    cdf[0] = 0.0;
+    for (int i = 1; i <= n; i++)
+        cdf[i] = cdf[i - 1] + func[i - 1] / n;
+
+    // A function which is zero everywhere is sampled uniformly
+    integral = cdf[n];
+    if (integral == 0.0)
+    {
+        for (int i = 1; i <= n; i++)
+            cdf[i] = (double)i / n;
+    }
+    else
+    {
+        for (int i = 1; i <= n; i++)
+            cdf[i] /= integral;
+    }
+}
+
+double Distribution1D::sampleContinuous(double u, double &pdf, int &offset) const
+{
+    // Last cdf entry which is <= u
+    int n = count();
+    offset = (int)(std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin()) - 1;
+    offset = std::min(std::max(offset, 0), n - 1);
+
+    double du = u - cdf[offset];
+    double width = cdf[offset + 1] - cdf[offset];
+    if (width > 0.0)
+        du /= width;
+
+    pdf = integral > 0.0 ? func[offset] / integral : 1.0;
+    return std::min((offset + du) / n, 1.0);
+}
+
+int Distribution1D::count() const
+{
+    return (int)func.size();
+}
+
+double Distribution1D::getIntegral() const
+{
+    return integral;
+}
+
+double Distribution1D::getValue(int i) const
+{
+    return func[i];
+}
+
+Distribution2D::Distribution2D()
+{ }
+
+Distribution2D::Distribution2D(const double *f, int nu, int nv)
+{
+    conditional.reserve(nv);
+    for (int v = 0; v < nv; v++)
+        conditional.emplace_back(&f[v * nu], nu);
+
+    std::vector<double> marginalFunc(nv);
+    for (int v = 0; v < nv; v++)
+        marginalFunc[v] = conditional[v].getIntegral();
+    marginal = Distribution1D(marginalFunc.data(), nv);
+}
+
+void Distribution2D::sampleContinuous(double u1, double u2, double &u, double &v, double &pdf) const
+{
+    double pdfs[2];
+    int row, column;
+    v = marginal.sampleContinuous(u2, pdfs[1], row);
+    u = conditional[row].sampleContinuous(u1, pdfs[0], column);
+    pdf = pdfs[0] * pdfs[1];
+}
+
+double Distribution2D::getPdf(double u, double v) const
+{
+    int nu = conditional[0].count();
+    int nv = marginal.count();
+    int iu = std::min(std::max((int)(u * nu), 0), nu - 1);
+    int iv = std::min(std::max((int)(v * nv), 0), nv - 1);
+
+    if (marginal.getIntegral() <= 0.0)
+        return 1.0;
+    return conditional[iv].getValue(iu) / marginal.getIntegral();
+}
@@ -0,0 +1,48 @@
+#ifndef DISTRIBUTION_H
+#define DISTRIBUTION_H
+
+#include <vector>
+
+// Piecewise-constant 1D distribution over [0,1] with one constant piece per
+// value of the function (Chapter 13 PBRT)
+class Distribution1D
+{
+public:
+    Distribution1D();
+    Distribution1D(const double *f, int n);
+
+    // Point of [0,1] distributed like the function for the random number u,
+    // with its density in pdf and the piece it falls in in offset
+    double sampleContinuous(double u, double &pdf, int &offset) const;
+
+    int count() const;
+    double getIntegral() const;
+    double getValue(int i) const;
+
+private:
+    std::vector<double> func;
+    std::vector<double> cdf;
+    double integral;
+};
+
+// Piecewise-constant 2D distribution over [0,1]^2 for a function given on an
+// nu x nv grid (row major, v rows of nu values). v is sampled first with the
+// marginal of the rows, then u with the conditional of the chosen row
+class Distribution2D
+{
+public:
+    Distribution2D();
+    Distribution2D(const double *f, int nu, int nv);
+
+    // (u, v) point for the random numbers u1, u2, and its density in pdf
+    void sampleContinuous(double u1, double u2, double &u, double &v, double &pdf) const;
+
+    // Density of the point (u, v)
+    double getPdf(double u, double v) const;
+
+private:
+    std::vector<Distribution1D> conditional;
+    Distribution1D marginal;
+};
+
+#endif // DISTRIBUTION_H
@@ -0,0 +1,276 @@
+#include "exrwriter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "compression.h"
+#include "parallel.h"
+#include "tinyexr.h"
+
+// Scanlines per chunk of the scanline files (fixed by the format)
+#define EXR_ZIP_LINES 16
+#define EXR_PIZ_LINES 32
+
+// The values of the file are little endian, like those of the machines this
+// renderer runs on: they are copied without swapping the bytes
+template <typename T>
+static void append(std::vector<unsigned char> &out, T value)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&value);
+    out.insert(out.end(), bytes, bytes + sizeof(T));
+}
+
+// Header attribute: name, type, size and value
+static void appendAttribute(std::vector<unsigned char> &header, const char *name, const char *type,
+                            const void *value, size_t size)
+{
+    header.insert(header.end(), name, name + strlen(name) + 1);
+    header.insert(header.end(), type, type + strlen(type) + 1);
+    append(header, (int)size);
+    const unsigned char *bytes = static_cast<const unsigned char*>(value);
+    header.insert(header.end(), bytes, bytes + size);
+}
+
+EXRWriter::EXRWriter(const std::string &filename_, const Film &film_)
+    : compression(EXR_ZIP_COMPRESSION), tileSize(0), halfFloat(false), numThreads(0),
+      filename(filename_), film(film_), nextChunk(0), chunkLines(1), numTilesX(0)
+{
+    // One channel per component: R, G, B for the image, then the layers
+    const char *rgb[3] = { "R", "G", "B" };
+    for (int c = 0; c < 3; c++)
+        channels.push_back({ rgb[c], -1, c });
+    for (size_t l = 0; l < film.getLayerCount(); l++)
+    {
+        const std::string &components = film.getLayerComponents((int)l);
+        for (size_t c = 0; c < components.size(); c++)
+            channels.push_back({ film.getLayerName((int)l) + "." + components[c], (int)l, (int)c });
+    }
+
+    // EXR readers expect the channels sorted by name
+    std::sort(channels.begin(), channels.end(),
+              [](const Channel &a, const Channel &b) { return a.name < b.name; });
+}
+
+EXRWriter::~EXRWriter()
+{
+    if (file.is_open())
+        close();
+}
+
+bool EXRWriter::open()
+{
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    const size_t width = film.getWidth();
+    const size_t height = film.getHeight();
+
+    // Split the image in chunks, in the order of the offset table
+    chunks.clear();
+    if (tileSize > 0)
+    {
+        numTilesX = (width + tileSize - 1) / tileSize;
+        for (size_t y0 = 0; y0 < height; y0 += tileSize)
+            for (size_t x0 = 0; x0 < width; x0 += tileSize)
+                chunks.push_back({ x0, y0, std::min(x0 + tileSize, width),
+                                   std::min(y0 + tileSize, height), 0, false, {} });
+    }
+    else
+    {
+        chunkLines = compression == EXR_ZIP_COMPRESSION ? EXR_ZIP_LINES :
+                     compression == EXR_PIZ_COMPRESSION ? EXR_PIZ_LINES : 1;
+        for (size_t y0 = 0; y0 < height; y0 += chunkLines)
+            chunks.push_back({ 0, y0, width, std::min(y0 + chunkLines, height), 0, false, {} });
+    }
+    nextChunk = 0;
+    chunkOffsets.assign(chunks.size(), 0);
+
+    std::vector<unsigned char> header = { 0x76, 0x2f, 0x31, 0x01 };
+    header.push_back(2);
+    header.push_back(tileSize > 0 ? 2 : 0);
+    header.push_back(0);
+    header.push_back(0);
+
+    // Name, pixel type, pLinear and 3 reserved bytes, and the sampling in x
+    // and y of every channel, then an empty name
+    std::vector<unsigned char> channelList;
+    for (const Channel &channel : channels)
+    {
+        channelList.insert(channelList.end(), channel.name.begin(), channel.name.end());
+        channelList.push_back(0);
+        append(channelList, (int)(halfFloat ? TINYEXR_PIXELTYPE_HALF : TINYEXR_PIXELTYPE_FLOAT));
+        append(channelList, (unsigned int)0);
+        append(channelList, (int)1);
+        append(channelList, (int)1);
+    }
+    channelList.push_back(0);
+    appendAttribute(header, "channels", "chlist", channelList.data(), channelList.size());
+
+    unsigned char compressionType = compression == EXR_ZIP_COMPRESSION ? TINYEXR_COMPRESSIONTYPE_ZIP :
+                                    compression == EXR_PIZ_COMPRESSION ? TINYEXR_COMPRESSIONTYPE_PIZ :
+                                                                         TINYEXR_COMPRESSIONTYPE_NONE;
+    appendAttribute(header, "compression", "compression", &compressionType, 1);
+
+    int window[4] = { 0, 0, (int)width - 1, (int)height - 1 };
+    appendAttribute(header, "dataWindow", "box2i", window, sizeof(window));
+    appendAttribute(header, "displayWindow", "box2i", window, sizeof(window));
+
+    unsigned char lineOrder = 0;    // Increasing y
+    appendAttribute(header, "lineOrder", "lineOrder", &lineOrder, 1);
+
+    float aspectRatio = 1.0f;
+    appendAttribute(header, "pixelAspectRatio", "float", &aspectRatio, sizeof(float));
+
+    float center[2] = { 0.0f, 0.0f };
+    appendAttribute(header, "screenWindowCenter", "v2f", center, sizeof(center));
+
+    float windowWidth = (float)width;
+    appendAttribute(header, "screenWindowWidth", "float", &windowWidth, sizeof(float));
+
+    if (tileSize > 0)
+    {
+        // Tile size and a single level of detail
+        std::vector<unsigned char> tiles;
+        append(tiles, (unsigned int)tileSize);
+        append(tiles, (unsigned int)tileSize);
+        append(tiles, (unsigned char)0);
+        appendAttribute(header, "tiles", "tiledesc", tiles.data(), tiles.size());
+    }
+
+    header.push_back(0);    // End of the header
+    file.write(reinterpret_cast<const char*>(header.data()), header.size());
+
+    // Room for the offset table, filled by close()
+    offsetTablePosition = file.tellp();
+    std::vector<unsigned long long> zeros(chunks.size(), 0);
+    file.write(reinterpret_cast<const char*>(zeros.data()), zeros.size() * sizeof(unsigned long long));
+
+    return file.good();
+}
+
+void EXRWriter::regionDone(size_t x0, size_t y0, size_t x1, size_t y1)
+{
+    if (!file.is_open())
+        return;
+
+    // Chunks which become complete with this region
+    std::vector<size_t> complete;
+    for (size_t i = nextChunk; i < chunks.size(); i++)
+    {
+        Chunk &chunk = chunks[i];
+        if (chunk.ready || chunk.x0 >= x1 || chunk.x1 <= x0 || chunk.y0 >= y1 || chunk.y1 <= y0)
+            continue;
+
+        size_t overlapX = std::min(chunk.x1, x1) - std::max(chunk.x0, x0);
+        size_t overlapY = std::min(chunk.y1, y1) - std::max(chunk.y0, y0);
+        chunk.donePixels += overlapX * overlapY;
+        if (chunk.donePixels >= (chunk.x1 - chunk.x0) * (chunk.y1 - chunk.y0))
+            complete.push_back(i);
+    }
+
+    parallelFor(complete.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++)
+            compressChunk(chunks[complete[k]], complete[k]);
+    }, numThreads);
+
+    writeReadyChunks();
+}
+
+bool EXRWriter::close()
+{
+    if (!file.is_open())
+        return false;
+
+    // Whatever is left is taken as final
+    std::vector<size_t> remaining;
+    for (size_t i = nextChunk; i < chunks.size(); i++)
+        if (!chunks[i].ready)
+            remaining.push_back(i);
+
+    parallelFor(remaining.size(), [&](size_t begin, size_t end) {
+        for (size_t k = begin; k < end; k++)
+            compressChunk(chunks[remaining[k]], remaining[k]);
+    }, numThreads);
+
+    writeReadyChunks();
+
+    file.seekp(offsetTablePosition);
+    file.write(reinterpret_cast<const char*>(chunkOffsets.data()),
+               chunkOffsets.size() * sizeof(unsigned long long));
+    bool good = file.good();
+    file.close();
+    return good;
+}
+
+void EXRWriter::compressChunk(Chunk &chunk, size_t chunkIndex) const
+{
+    const size_t width = chunk.x1 - chunk.x0;
+    const size_t lines = chunk.y1 - chunk.y0;
+    const size_t pixelSize = halfFloat ? sizeof(unsigned short) : sizeof(float);
+
+    // Pixel data: for every line, the values of each channel in turn
+    std::vector<unsigned char> raw(lines * channels.size() * width * pixelSize);
+    unsigned char *out = raw.data();
+    for (size_t y = chunk.y0; y < chunk.y1; y++)
+    {
+        for (const Channel &channel : channels)
+        {
+            for (size_t x = chunk.x0; x < chunk.x1; x++)
+            {
+                Vector3D v = channel.layer < 0 ? film.getPixelValue(x, y) :
+                                                 film.getLayerValue(channel.layer, x, y);
+                float value = channel.component == 0 ? v.x : channel.component == 1 ? v.y : v.z;
+
+                if (halfFloat)
+                {
+                    unsigned short h16 = floatToHalf(value);
+                    memcpy(out, &h16, sizeof(h16));
+                }
+                else
+                {
+                    memcpy(out, &value, sizeof(value));
+                }
+                out += pixelSize;
+            }
+        }
+    }
+
+    std::vector<unsigned char> block;
+    if (compression == EXR_ZIP_COMPRESSION)
+        block = compressEXRZip(raw);
+    else if (compression == EXR_PIZ_COMPRESSION)
+        block = compressEXRPiz(raw, channels.size(), halfFloat, (int)width, (int)lines);
+    else
+        block.swap(raw);
+
+    // Chunk header: tile coordinates and level, or first scanline
+    chunk.data.clear();
+    if (tileSize > 0)
+    {
+        append(chunk.data, (int)(chunkIndex % numTilesX));
+        append(chunk.data, (int)(chunkIndex / numTilesX));
+        append(chunk.data, (int)0);
+        append(chunk.data, (int)0);
+    }
+    else
+    {
+        append(chunk.data, (int)chunk.y0);
+    }
+    append(chunk.data, (int)block.size());
+    chunk.data.insert(chunk.data.end(), block.begin(), block.end());
+    chunk.ready = true;
+}
+
+void EXRWriter::writeReadyChunks()
+{
+    while (nextChunk < chunks.size() && chunks[nextChunk].ready)
+    {
+        Chunk &chunk = chunks[nextChunk];
+        chunkOffsets[nextChunk] = (unsigned long long)file.tellp();
+        file.write(reinterpret_cast<const char*>(chunk.data.data()), chunk.data.size());
+        std::vector<unsigned char>().swap(chunk.data);
+        nextChunk++;
+    }
+}
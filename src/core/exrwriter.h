@@ -0,0 +1,77 @@
+#ifndef EXRWRITER_H
+#define EXRWRITER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "film.h"
+#include "imagewriter.h"
+
+enum EXRCompression
+{
+    EXR_NO_COMPRESSION,
+    EXR_ZIP_COMPRESSION,
+    EXR_PIZ_COMPRESSION
+};
+
+// OpenEXR writer for the image and the layers of a Film (see Film::addLayer).
+// The file is made of chunks, either blocks of scanlines or square tiles,
+// which are converted and compressed one by one (several at once, on all the
+// threads) and appended to the file, so no full copy of the film is made.
+// The chunks can be streamed while the film is rendered: regionDone()
+// writes every chunk whose pixels are all final.
+class EXRWriter : public ImageWriter
+{
+public:
+    EXRWriter() = delete;
+    EXRWriter(const std::string &filename_, const Film &film_);
+    ~EXRWriter();
+
+    // open() writes the header, regionDone() the chunks covered by the
+    // given pixels (once final) and close() the rest of the chunks and the
+    // table of chunk offsets
+    bool open();
+    void regionDone(size_t x0, size_t y0, size_t x1, size_t y1);
+    bool close();
+
+    // Settings, to be chosen before open()
+    EXRCompression compression;
+    size_t tileSize;            // 0 = blocks of scanlines (16 for ZIP, 32 for PIZ, else 1)
+    bool halfFloat;             // 16 bit floats instead of 32 bit ones
+    unsigned int numThreads;    // 0 = all the hardware threads
+
+private:
+    struct Channel
+    {
+        std::string name;
+        int layer;              // -1 for the image
+        int component;
+    };
+
+    struct Chunk
+    {
+        size_t x0, y0, x1, y1;
+        size_t donePixels;
+        bool ready;
+        std::vector<unsigned char> data;    // Compressed chunk with its header
+    };
+
+    void compressChunk(Chunk &chunk, size_t chunkIndex) const;
+    void writeReadyChunks();
+
+    std::string filename;
+    const Film &film;
+
+    std::vector<Channel> channels;
+    std::vector<Chunk> chunks;
+    size_t nextChunk;           // First chunk not yet in the file
+    size_t chunkLines;
+    size_t numTilesX;
+
+    std::ofstream file;
+    std::streampos offsetTablePosition;
+    std::vector<unsigned long long> chunkOffsets;
+};
+
+#endif // EXRWRITER_H
@@ -1,8 +1,11 @@
 #include "film.h"
 
-#define TINYEXR_IMPLEMENTATION
-#include "tinyexr.h"
+#include <cmath>
 
+#include "exrwriter.h"
+#include "ldrwriter.h"
+
+#include <algorithm>
 #include <iostream>
 #include <vector>
 
@@ -52,11 +55,63 @@ Vector3D Film::getPixelValue(size_t w, size_t h) const
     return data[h][w];
 }
 
+const Vector3D* Film::getRow(size_t h) const
+{
+    return data[h];
+}
+
 void Film::setPixelValue(size_t w, size_t h, Vector3D &value)
 {
     data[h][w] = value;
 }
 
+int Film::addLayer(const std::string &name, const std::string &components)
+{
+    int index = getLayerIndex(name);
+    if (index >= 0)
+        return index;
+
+    Layer layer;
+    layer.name = name;
+    layer.components = components.substr(0, 3);
+    layer.data.assign(width * height, Vector3D(0.0));
+    layers.push_back(layer);
+    return (int)layers.size() - 1;
+}
+
+int Film::getLayerIndex(const std::string &name) const
+{
+    for (size_t i = 0; i < layers.size(); i++)
+        if (layers[i].name == name)
+            return (int)i;
+    return -1;
+}
+
+size_t Film::getLayerCount() const
+{
+    return layers.size();
+}
+
+const std::string& Film::getLayerName(int layer) const
+{
+    return layers[layer].name;
+}
+
+const std::string& Film::getLayerComponents(int layer) const
+{
+    return layers[layer].components;
+}
+
+Vector3D Film::getLayerValue(int layer, size_t w, size_t h) const
+{
+    return layers[layer].data[h * width + w];
+}
+
+void Film::setLayerValue(int layer, size_t w, size_t h, const Vector3D &value)
+{
+    layers[layer].data[h * width + w] = value;
+}
+
 void Film::clearData()
 {
     Vector3D zero;
@@ -68,61 +123,33 @@ void Film::clearData()
             setPixelValue(w, h, zero);
         }
     }
-}
 
-int Film::save()
-{
-    return BitMap::save(data, width, height);
+    for (Layer &layer : layers)
+        std::fill(layer.data.begin(), layer.data.end(), zero);
 }
 
-
-int Film::saveEXR()
+int Film::save(const std::string &filename)
 {
-    const char* fname = "output.exr";
-
-    unsigned int N_COMPONENTS = 3;
+    LDRWriter writer(filename, *this);
 
-    ImageBufferEXR buffer;
-    buffer.data = data;
-    buffer.width = width;
-    buffer.height = height;
+    if (!writer.write()) {
+        std::cout << "Problem at Film::save() : Could not write file \"" << filename << "\"" << std::endl;
+        return 1;
+    }
+    return 0;
+}
 
-    const std::string filename(fname);
 
-    float* myImage = (float*)malloc(sizeof(float) * width* height* N_COMPONENTS);    
-  
-    for (size_t i = 0; i < static_cast<size_t>(width); i++) {
-        for (size_t j = 0; j < static_cast<size_t>(height); j++) {
-            int idx = j * width + i;
-            myImage[idx * 3 + 0] = data[height - j - 1][i].x;
-            myImage[idx * 3 + 1] = data[height - j - 1][i].y;
-            myImage[idx * 3 + 2] = data[height - j - 1][i].z;
-        }
-    }
+int Film::saveEXR(const std::string &filename)
+{
+    EXRWriter writer(filename, *this);
 
-    const char* err = "";
-    int32_t ret = SaveEXR(
-        myImage,
-        buffer.width,
-        buffer.height,
-        N_COMPONENTS, // num components
-        0, // save_as_fp32
-        filename.c_str(),
-        &err);
-
-    free(myImage);
-
-    bool saved_correctly = (err != NULL) && (err[0] == '\0');
-    if (saved_correctly) {
-        printf("EXR Stored Correctly :) \n"); 
+    if (writer.write()) {
+        printf("EXR Stored Correctly :) \n");
         return 1;
     }
     else {
-        std::cout <<"Error storing EXR file :( --> " << err;
+        std::cout << "Error storing EXR file :( --> " << filename << std::endl;
         return 0;
     }
-
-    
-
 }
-
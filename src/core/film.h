@@ -5,6 +5,8 @@
 #include "bitmap.h"
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 
 enum BufferImageFormat
@@ -45,22 +47,45 @@ public:
     size_t getWidth() const;
     size_t getHeight() const;
     Vector3D getPixelValue(size_t w, size_t h) const;
+    const Vector3D* getRow(size_t h) const; // The width pixels of row h, contiguous
 
     // Setters
     void setPixelValue(size_t w, size_t h, Vector3D &value);
 
+    // Named layers (AOVs) stored next to the image, e.g., "albedo" with
+    // components "RGB" or "depth" with component "Z". Each component becomes
+    // the channel <name>.<component> of the EXR file; one-component layers
+    // use the x coordinate of the values. Returns the index of the layer
+    // (the existing one if the name is already taken)
+    int addLayer(const std::string &name, const std::string &components = "RGB");
+    int getLayerIndex(const std::string &name) const; // -1 if there is none
+    size_t getLayerCount() const;
+    const std::string& getLayerName(int layer) const;
+    const std::string& getLayerComponents(int layer) const;
+    Vector3D getLayerValue(int layer, size_t w, size_t h) const;
+    void setLayerValue(int layer, size_t w, size_t h, const Vector3D &value);
+
     // Other functions
-    int save();
-    int saveEXR();
+    int save(const std::string &filename = "output.bmp"); // 8-bit BMP or PNG (see LDRWriter), 0 on success
+    int saveEXR(const std::string &filename = "output.exr"); // Image (R, G, B) and every layer (see EXRWriter)
     void clearData();
 
 private:
+    struct Layer
+    {
+        std::string name;
+        std::string components;
+        std::vector<Vector3D> data; // Row major
+    };
+
     // Image size
     size_t width;
     size_t height;
 
     // Pointer to image data
     Vector3D **data;
+
+    std::vector<Layer> layers;
 };
 
 #endif // FILM_H
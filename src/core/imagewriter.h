@@ -0,0 +1,28 @@
+#ifndef IMAGEWRITER_H
+#define IMAGEWRITER_H
+
+#include <cstddef>
+
+// Image file written from a Film, either at once with write() or while the
+// film is rendered: open() starts the file, regionDone() tells that the
+// pixels [x0, x1) x [y0, y1) of the film are final (see Renderer::render),
+// so that the parts of the file they complete can be written, and close()
+// writes the rest
+class ImageWriter
+{
+public:
+    virtual ~ImageWriter() {}
+
+    virtual bool open() = 0;
+    virtual void regionDone(size_t x0, size_t y0, size_t x1, size_t y1) = 0;
+    virtual bool close() = 0;
+
+    bool write()
+    {
+        if (!open())
+            return false;
+        return close();
+    }
+};
+
+#endif // IMAGEWRITER_H
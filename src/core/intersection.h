@@ -21,6 +21,9 @@ public:
 
     // Pointer to the shape that the intersection point lies on
     const Shape *shape;
+
+    // Index of the shape material in the scene material table
+    unsigned int materialId;
 };
 
 #endif // INTERSECTION_H
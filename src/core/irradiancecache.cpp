@@ -0,0 +1,244 @@
+#include "irradiancecache.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#define PI 3.14159265358979323846
+
+IrradianceCache::IrradianceCache()
+    : errorThreshold(0.2), thetaSamples(8), minSpacing(0.02), maxSpacing(5.0), root(-1)
+{ }
+
+void IrradianceCache::clear()
+{
+    records.clear();
+    nodes.clear();
+    root = -1;
+}
+
+Vector3D IrradianceCache::getIrradiance(const Vector3D &x, const Vector3D &n,
+                                        const RadianceFunction &incomingRadiance)
+{
+    Vector3D E;
+    if (interpolate(x, n, E))
+        return E;
+
+    records.push_back(computeRecord(x, n, incomingRadiance));
+    insert((unsigned int)records.size() - 1);
+    return records.back().E;
+}
+
+bool IrradianceCache::interpolate(const Vector3D &x, const Vector3D &n, Vector3D &E) const
+{
+    if (root < 0)
+        return false;
+
+    Vector3D sum(0.0);
+    double weightSum = 0.0;
+    gather(root, x, n, sum, weightSum);
+
+    if (weightSum <= 0.0)
+        return false;
+
+    E = sum / weightSum;
+    return true;
+}
+
+void IrradianceCache::gather(int nodeIndex, const Vector3D &x, const Vector3D &n,
+                             Vector3D &sum, double &weightSum) const
+{
+    const Node &node = nodes[nodeIndex];
+
+    // The records of a node have their center in it and a validity radius
+    // of at most its half size
+    Vector3D d = (x - node.center).v_abs();
+    if (std::max(d.x, std::max(d.y, d.z)) > 2.0 * node.halfSize)
+        return;
+
+    for (unsigned int index : node.records)
+    {
+        const Record &rec = records[index];
+        Vector3D offset = x - rec.p;
+        double error = offset.length() / rec.R +
+                       std::sqrt(std::max(0.0, 1.0 - dot(n, rec.n)));
+        if (error >= errorThreshold)
+            continue;
+
+        // Records in front of x see a part of the scene which x does not
+        if (dot(offset, (n + rec.n) * 0.5) < -0.01 * rec.R)
+            continue;
+
+        // E extrapolated to x with the gradients
+        Vector3D rotation = cross(rec.n, n);
+        Vector3D Ei = rec.E;
+        Ei += rec.gradT[0] * offset.x + rec.gradT[1] * offset.y + rec.gradT[2] * offset.z;
+        Ei += rec.gradR[0] * rotation.x + rec.gradR[1] * rotation.y + rec.gradR[2] * rotation.z;
+        Ei = Vector3D(std::max(0.0f, Ei.x), std::max(0.0f, Ei.y), std::max(0.0f, Ei.z));
+
+        // Weight which goes to zero at the border of the validity region
+        double w = 1.0 / std::max(error, 1e-6) - 1.0 / errorThreshold;
+        sum += Ei * w;
+        weightSum += w;
+    }
+
+    for (int child : node.children)
+        if (child >= 0)
+            gather(child, x, n, sum, weightSum);
+}
+
+IrradianceCache::Record IrradianceCache::computeRecord(const Vector3D &x, const Vector3D &n,
+                                                       const RadianceFunction &incomingRadiance) const
+{
+    const int M = std::max(thetaSamples, 2);
+    const int N = std::max((int)std::lround(PI * M), 3);
+
+    // Local frame (t, b, n)
+    Vector3D t = cross(n, std::abs(n.x) < 0.9 ? Vector3D(1.0, 0.0, 0.0) : Vector3D(0.0, 1.0, 0.0)).normalized();
+    Vector3D b = cross(n, t);
+
+    // Stratified cosine weighted directions: ring j covers sin^2(theta) in
+    // [j/M, (j+1)/M), sector k covers phi in [2 pi k/N, 2 pi (k+1)/N)
+    std::vector<Vector3D> L(M * N);
+    std::vector<double> r(M * N);
+
+    Record rec;
+    rec.p = x;
+    rec.n = n;
+    rec.E = Vector3D(0.0);
+    for (int a = 0; a < 3; a++)
+        rec.gradT[a] = rec.gradR[a] = Vector3D(0.0);
+
+    Vector3D gradRSum[3] = { Vector3D(0.0), Vector3D(0.0), Vector3D(0.0) };
+    double inverseDistanceSum = 0.0;
+    for (int j = 0; j < M; j++)
+    {
+        for (int k = 0; k < N; k++)
+        {
+            double sinTheta = std::sqrt((j + (double)std::rand() / (RAND_MAX + 1.0)) / M);
+            double cosTheta = std::sqrt(std::max(0.0, 1.0 - sinTheta * sinTheta));
+            double phi = 2.0 * PI * (k + (double)std::rand() / (RAND_MAX + 1.0)) / N;
+            Vector3D wi = (t * (std::cos(phi) * sinTheta) + b * (std::sin(phi) * sinTheta) +
+                           n * cosTheta).normalized();
+
+            double distance = INFINITY;
+            Vector3D Li = incomingRadiance(wi, distance);
+            L[j * N + k] = Li;
+            r[j * N + k] = distance;
+            rec.E += Li;
+            inverseDistanceSum += 1.0 / distance;
+
+            // Rotating n around an axis a changes E by (a x n).wi Li / cos
+            // theta for each sample, i.e., by a.(n x wi) Li / cos(theta)
+            Vector3D axis = cross(n, wi) / std::max(cosTheta, 1e-3);
+            gradRSum[0] += Li * axis.x;
+            gradRSum[1] += Li * axis.y;
+            gradRSum[2] += Li * axis.z;
+        }
+    }
+
+    const double sampleWeight = PI / (M * N);
+    rec.E *= sampleWeight;
+    for (int a = 0; a < 3; a++)
+        rec.gradR[a] = gradRSum[a] * sampleWeight;
+
+    // Harmonic mean distance
+    rec.R = inverseDistanceSum > 0.0 ? (M * N) / inverseDistanceSum : INFINITY;
+    rec.R = std::min(std::max(rec.R, minSpacing), maxSpacing);
+
+    // Translational gradient: moving x makes the boundaries between the
+    // strata sweep over the surfaces seen through them, at a rate inversely
+    // proportional to their distance, so that each stratum takes some of the
+    // radiance of its neighbour (Ward and Heckbert 1992)
+    for (int k = 0; k < N; k++)
+    {
+        double phiMinus = 2.0 * PI * k / N;
+        Vector3D u = t * std::cos(phiMinus) + b * std::sin(phiMinus);
+        Vector3D v = t * -std::sin(phiMinus) + b * std::cos(phiMinus);
+        int kPrevious = (k + N - 1) % N;
+
+        // Boundaries between the rings j - 1 and j, moved along u
+        Vector3D thetaSum(0.0);
+        for (int j = 1; j < M; j++)
+        {
+            double sin2 = (double)j / M;
+            double distance = std::min(r[j * N + k], r[(j - 1) * N + k]);
+            thetaSum += (L[j * N + k] - L[(j - 1) * N + k]) *
+                        (std::sqrt(sin2) * (1.0 - sin2) / distance);
+        }
+
+        // Boundaries between the sectors k - 1 and k, moved along v
+        Vector3D phiSum(0.0);
+        for (int j = 0; j < M; j++)
+        {
+            double sinMinus = std::sqrt((double)j / M);
+            double sinPlus = std::sqrt((double)(j + 1) / M);
+            double distance = std::min(r[j * N + k], r[j * N + kPrevious]);
+            phiSum += (L[j * N + k] - L[j * N + kPrevious]) * ((sinPlus - sinMinus) / distance);
+        }
+
+        thetaSum *= 2.0 * PI / N;
+        rec.gradT[0] += thetaSum * u.x + phiSum * v.x;
+        rec.gradT[1] += thetaSum * u.y + phiSum * v.y;
+        rec.gradT[2] += thetaSum * u.z + phiSum * v.z;
+    }
+
+    return rec;
+}
+
+int IrradianceCache::createNode(const Vector3D &center, double halfSize)
+{
+    Node node;
+    node.center = center;
+    node.halfSize = halfSize;
+    std::fill(node.children, node.children + 8, -1);
+    nodes.push_back(node);
+    return (int)nodes.size() - 1;
+}
+
+void IrradianceCache::insert(unsigned int index)
+{
+    const Vector3D p = records[index].p;
+    const double radius = errorThreshold * records[index].R;
+
+    if (root < 0)
+        root = createNode(p, std::max(radius, errorThreshold * maxSpacing));
+
+    // Grow the tree upwards until it contains p
+    while (true)
+    {
+        Vector3D d = (p - nodes[root].center).v_abs();
+        double halfSize = nodes[root].halfSize;
+        if (std::max(d.x, std::max(d.y, d.z)) <= halfSize)
+            break;
+
+        Vector3D c = nodes[root].center;
+        Vector3D center(p.x > c.x ? c.x + halfSize : c.x - halfSize,
+                        p.y > c.y ? c.y + halfSize : c.y - halfSize,
+                        p.z > c.z ? c.z + halfSize : c.z - halfSize);
+        int newRoot = createNode(center, 2.0 * halfSize);
+        int octant = (c.x > center.x ? 1 : 0) | (c.y > center.y ? 2 : 0) | (c.z > center.z ? 4 : 0);
+        nodes[newRoot].children[octant] = root;
+        root = newRoot;
+    }
+
+    // Go down to the smallest node at least as large as the validity radius
+    int node = root;
+    while (nodes[node].halfSize * 0.5 >= radius)
+    {
+        Vector3D c = nodes[node].center;
+        int octant = (p.x > c.x ? 1 : 0) | (p.y > c.y ? 2 : 0) | (p.z > c.z ? 4 : 0);
+        if (nodes[node].children[octant] < 0)
+        {
+            double h = nodes[node].halfSize * 0.5;
+            Vector3D center(c.x + ((octant & 1) ? h : -h),
+                            c.y + ((octant & 2) ? h : -h),
+                            c.z + ((octant & 4) ? h : -h));
+            int child = createNode(center, h);
+            nodes[node].children[octant] = child;
+        }
+        node = nodes[node].children[octant];
+    }
+
+    nodes[node].records.push_back(index);
+}
@@ -0,0 +1,81 @@
+#ifndef IRRADIANCECACHE_H
+#define IRRADIANCECACHE_H
+
+#include <functional>
+#include <vector>
+
+#include "vector3d.h"
+
+// Irradiance cache (Ward et al. 1988), for the diffuse interreflections.
+// The irradiance at a point is computed once with a stratified hemisphere of
+// rays and stored as a record, with its translational and rotational
+// gradients (Ward and Heckbert 1992), and is then extrapolated with them at
+// the points around, as long as the error estimate
+//     |p - pi| / Ri + sqrt(1 - n.ni)
+// of a record (Ri being the harmonic mean distance to the surfaces seen from
+// it) is below errorThreshold. The records are kept in an octree where each
+// one is stored at the level of its validity radius.
+// The cache only holds what the callback given to getIrradiance returns, so
+// a shader can keep the direct light out of it (and sample it separately) or
+// not. It is filled while rendering: a first pass with few samples per pixel
+// (an "overture" pass) leaves the records in place for the final one.
+// It is not thread safe, as the renderer shades the pixels one at a time.
+class IrradianceCache
+{
+public:
+    IrradianceCache();
+
+    // Radiance arriving from direction wi, and the distance to the surface
+    // it comes from (INFINITY when none)
+    typedef std::function<Vector3D(const Vector3D &wi, double &distance)> RadianceFunction;
+
+    // Irradiance at x (with normal n), interpolated from the records around
+    // or from a new one computed with incomingRadiance
+    Vector3D getIrradiance(const Vector3D &x, const Vector3D &n,
+                           const RadianceFunction &incomingRadiance);
+
+    // Drop all the records (e.g., when the scene changes)
+    void clear();
+
+    size_t getRecordCount() const { return records.size(); }
+
+    // Settings
+    double errorThreshold;      // Largest error of the records which are used
+    int thetaSamples;           // Hemisphere strata in theta (and pi times more in phi)
+    double minSpacing;          // Clamps on the harmonic mean distance of a
+    double maxSpacing;          // record, in scene units
+
+private:
+    struct Record
+    {
+        Vector3D p;
+        Vector3D n;
+        Vector3D E;
+        double R;
+        Vector3D gradT[3];      // Derivatives of E along x, y and z
+        Vector3D gradR[3];      // Derivatives of E for a rotation around x, y and z
+    };
+
+    struct Node
+    {
+        Vector3D center;
+        double halfSize;
+        int children[8];
+        std::vector<unsigned int> records;
+    };
+
+    // Weighted sum of the records valid at x, returns false if there is none
+    bool interpolate(const Vector3D &x, const Vector3D &n, Vector3D &E) const;
+    void gather(int nodeIndex, const Vector3D &x, const Vector3D &n,
+                Vector3D &sum, double &weightSum) const;
+    Record computeRecord(const Vector3D &x, const Vector3D &n,
+                         const RadianceFunction &incomingRadiance) const;
+    void insert(unsigned int index);
+    int createNode(const Vector3D &center, double halfSize);
+
+    std::vector<Record> records;
+    std::vector<Node> nodes;
+    int root;
+};
+
+#endif // IRRADIANCECACHE_H
@@ -0,0 +1,267 @@
+#include "ldrwriter.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstdint>
+
+#include "bitmap.h"
+#include "compression.h"
+#include "parallel.h"
+
+// Rows converted at once, and rows of each piece of a PNG band deflated on
+// its own
+#define LDR_BAND_ROWS 64
+#define PNG_PIECE_ROWS 16
+
+// Adler-32 is computed modulo this prime, which the sums cannot overflow in
+// fewer than ADLER_BLOCK bytes
+#define ADLER_MOD 65521u
+#define ADLER_BLOCK 5552
+
+// The rows of the film are tone mapped as flat arrays of floats
+static_assert(sizeof(Vector3D) == 3 * sizeof(float), "Vector3D must be three packed floats");
+
+static uint32_t crc32(const unsigned char *data, size_t size, uint32_t crc = 0)
+{
+    static const std::vector<uint32_t> table = [] {
+        std::vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; n++)
+        {
+            uint32_t c = n;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void putBE(unsigned char *p, uint32_t value)
+{
+    p[0] = (unsigned char)(value >> 24);
+    p[1] = (unsigned char)(value >> 16);
+    p[2] = (unsigned char)(value >> 8);
+    p[3] = (unsigned char)value;
+}
+
+LDRWriter::LDRWriter(const std::string &filename_, const Film &film_)
+    : format(LDR_BMP), numThreads(0), filename(filename_), film(film_), nextRow(0),
+      adlerA(1), adlerB(0)
+{
+    std::string extension = filename.size() >= 4 ? filename.substr(filename.size() - 4) : "";
+    std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension == ".png")
+        format = LDR_PNG;
+}
+
+LDRWriter::~LDRWriter()
+{
+    if (file.is_open())
+        close();
+}
+
+bool LDRWriter::open()
+{
+    file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open())
+        return false;
+
+    const size_t width = film.getWidth();
+    const size_t height = film.getHeight();
+
+    toneMapper.prepare();
+    donePixels.assign(height, 0);
+    nextRow = 0;
+
+    if (format == LDR_BMP)
+    {
+        bmp24_info_header infoHeader(width, height, true);
+        bmp24_file_header fileHeader;
+        fileHeader.size = (uint32_t)(bmp24_file_header::BYTES + bmp24_info_header::BYTES +
+                                     infoHeader.size_image);
+
+        unsigned char fileBlock[bmp24_file_header::BYTES];
+        unsigned char infoBlock[bmp24_info_header::BYTES];
+        fileHeader.toBytes(fileBlock);
+        infoHeader.toBytes(infoBlock);
+        file.write((const char*)fileBlock, sizeof(fileBlock));
+        file.write((const char*)infoBlock, sizeof(infoBlock));
+    }
+    else
+    {
+        const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+        file.write((const char*)signature, sizeof(signature));
+
+        // 8 bits per channel, RGB, no interlacing
+        unsigned char header[13] = { 0 };
+        putBE(&header[0], (uint32_t)width);
+        putBE(&header[4], (uint32_t)height);
+        header[8] = 8;
+        header[9] = 2;
+        writePNGChunk("IHDR", header, sizeof(header));
+
+        previousRow.assign(3 * width, 0);
+        adlerA = 1;
+        adlerB = 0;
+    }
+
+    return file.good();
+}
+
+void LDRWriter::regionDone(size_t x0, size_t y0, size_t x1, size_t y1)
+{
+    if (!file.is_open())
+        return;
+
+    for (size_t y = y0; y < y1; y++)
+        donePixels[y] += x1 - x0;
+
+    size_t rowEnd = nextRow;
+    while (rowEnd < donePixels.size() && donePixels[rowEnd] >= film.getWidth())
+        rowEnd++;
+    writeRows(nextRow, rowEnd);
+}
+
+bool LDRWriter::close()
+{
+    if (!file.is_open())
+        return false;
+
+    // Whatever is left is taken as final
+    writeRows(nextRow, film.getHeight());
+
+    if (format == LDR_PNG)
+    {
+        // End of the deflate stream and checksum of the zlib stream
+        std::vector<unsigned char> tail = deflateBlock(nullptr, 0, true);
+        unsigned char adler[4];
+        putBE(adler, (adlerB << 16) | adlerA);
+        tail.insert(tail.end(), adler, adler + 4);
+        writePNGChunk("IDAT", tail.data(), tail.size());
+        writePNGChunk("IEND", nullptr, 0);
+    }
+
+    bool good = file.good();
+    file.close();
+    return good;
+}
+
+void LDRWriter::writeRows(size_t rowBegin, size_t rowEnd)
+{
+    const size_t width = film.getWidth();
+    const size_t rowBytes = format == LDR_BMP ? bmp24_info_header(width, 1).rowBytes() :
+                                                3 * width + 1;   // Filter type and RGB
+
+    for (size_t bandBegin = rowBegin; bandBegin < rowEnd; bandBegin += LDR_BAND_ROWS)
+    {
+        size_t bandEnd = std::min(bandBegin + LDR_BAND_ROWS, rowEnd);
+        size_t bandRows = bandEnd - bandBegin;
+        std::vector<unsigned char> band(bandRows * rowBytes, 0);
+
+        // Tone map the rows, in the layout of the file
+        parallelFor(bandRows, [&](size_t begin, size_t end) {
+            std::vector<float> scratch(3 * width);
+            std::vector<unsigned char> rgb(3 * width);
+            for (size_t r = begin; r < end; r++)
+            {
+                size_t y = bandBegin + r;
+                const float *row = reinterpret_cast<const float*>(film.getRow(y));
+                toneMapper.apply(row, width, 0, y, rgb.data(), scratch.data());
+
+                unsigned char *out = &band[r * rowBytes];
+                if (format == LDR_BMP)
+                {
+                    for (size_t i = 0; i < width; i++)
+                    {
+                        out[3 * i]     = rgb[3 * i + 2];
+                        out[3 * i + 1] = rgb[3 * i + 1];
+                        out[3 * i + 2] = rgb[3 * i];
+                    }
+                }
+                else
+                {
+                    std::copy(rgb.begin(), rgb.end(), out + 1);
+                }
+            }
+        }, numThreads);
+
+        if (format == LDR_BMP)
+        {
+            file.write((const char*)band.data(), band.size());
+            continue;
+        }
+
+        // "Up" filter: each byte minus the one above it. Backwards, so that
+        // the rows above are still unfiltered
+        std::vector<unsigned char> lastRow(band.end() - 3 * width, band.end());
+        for (size_t r = bandRows; r > 0; r--)
+        {
+            unsigned char *out = &band[(r - 1) * rowBytes];
+            const unsigned char *above = r > 1 ? &band[(r - 2) * rowBytes + 1] : previousRow.data();
+            out[0] = 2;
+            for (size_t i = 0; i < 3 * width; i++)
+                out[i + 1] = (unsigned char)(out[i + 1] - above[i]);
+        }
+        previousRow.swap(lastRow);
+
+        // Adler-32 of the uncompressed stream
+        for (size_t i = 0; i < band.size(); i += ADLER_BLOCK)
+        {
+            size_t blockEnd = std::min(i + ADLER_BLOCK, band.size());
+            for (size_t k = i; k < blockEnd; k++)
+            {
+                adlerA += band[k];
+                adlerB += adlerA;
+            }
+            adlerA %= ADLER_MOD;
+            adlerB %= ADLER_MOD;
+        }
+
+        // Deflate the pieces of the band in parallel
+        size_t numPieces = (bandRows + PNG_PIECE_ROWS - 1) / PNG_PIECE_ROWS;
+        std::vector<std::vector<unsigned char>> pieces(numPieces);
+        parallelFor(numPieces, [&](size_t begin, size_t end) {
+            for (size_t p = begin; p < end; p++)
+            {
+                size_t first = p * PNG_PIECE_ROWS;
+                size_t last = std::min(first + PNG_PIECE_ROWS, bandRows);
+                pieces[p] = deflateBlock(&band[first * rowBytes], (last - first) * rowBytes, false);
+            }
+        }, numThreads);
+
+        // The first chunk starts with the zlib header (deflate, 32K window)
+        std::vector<unsigned char> data;
+        if (bandBegin == 0)
+        {
+            data.push_back(0x78);
+            data.push_back(0x9c);
+        }
+        for (const std::vector<unsigned char> &piece : pieces)
+            data.insert(data.end(), piece.begin(), piece.end());
+        writePNGChunk("IDAT", data.data(), data.size());
+    }
+
+    nextRow = std::max(nextRow, rowEnd);
+}
+
+void LDRWriter::writePNGChunk(const char *type, const unsigned char *data, size_t size)
+{
+    unsigned char length[4];
+    putBE(length, (uint32_t)size);
+    file.write((const char*)length, 4);
+    file.write(type, 4);
+    if (size > 0)
+        file.write((const char*)data, size);
+
+    uint32_t crc = crc32((const unsigned char*)type, 4);
+    if (size > 0)
+        crc = crc32(data, size, crc);
+    unsigned char crcBytes[4];
+    putBE(crcBytes, crc);
+    file.write((const char*)crcBytes, 4);
+}
@@ -0,0 +1,58 @@
+#ifndef LDRWRITER_H
+#define LDRWRITER_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "film.h"
+#include "imagewriter.h"
+#include "tonemapper.h"
+
+enum LDRFormat
+{
+    LDR_BMP,
+    LDR_PNG
+};
+
+// 8-bit BMP or PNG writer for the image of a Film, converted by a
+// ToneMapper straight from the rows of the film. Rows are written in order
+// as soon as they are final, in bands converted on all the threads; the BMP
+// rows are stored top-down for that. The PNG rows are filtered and each
+// band is deflated in pieces (also in parallel) which are joined into the
+// single zlib stream of the file.
+class LDRWriter : public ImageWriter
+{
+public:
+    LDRWriter() = delete;
+    LDRWriter(const std::string &filename_, const Film &film_); // PNG for ".png" names, BMP otherwise
+    ~LDRWriter();
+
+    bool open();
+    void regionDone(size_t x0, size_t y0, size_t x1, size_t y1);
+    bool close();
+
+    // Settings, to be chosen before open()
+    LDRFormat format;
+    ToneMapper toneMapper;
+    unsigned int numThreads;    // 0 = all the hardware threads
+
+private:
+    void writeRows(size_t rowBegin, size_t rowEnd);
+    void writePNGChunk(const char *type, const unsigned char *data, size_t size);
+
+    std::string filename;
+    const Film &film;
+
+    std::vector<size_t> donePixels;     // Final pixels of each row
+    size_t nextRow;                     // First row not yet in the file
+
+    std::ofstream file;
+
+    // PNG state: last row written (for the "up" filter) and Adler-32 sums of
+    // the zlib stream
+    std::vector<unsigned char> previousRow;
+    unsigned int adlerA, adlerB;
+};
+
+#endif // LDRWRITER_H
@@ -1,5 +1,8 @@
 #include "matrix4x4.h"
 
+#include <cmath>
+#include <cstring>
+
 Matrix4x4::Matrix4x4()
 {
     for(size_t lin=0; lin<4; lin++)
@@ -0,0 +1,144 @@
+#include "parallel.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    // Threads started by the first parallelFor which needs them and kept
+    // waiting for the next ones, so that frequent calls (every band of an
+    // image, every frame of an animation) do not pay for starting threads
+    class ThreadPool
+    {
+    public:
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stop = true;
+            }
+            workAvailable.notify_all();
+            for (std::thread &thread : threads)
+                thread.join();
+        }
+
+        void run(size_t count, const std::function<void(size_t, size_t)> &body,
+                 unsigned int numThreads)
+        {
+            // One parallelFor at a time (they may come from several threads)
+            std::lock_guard<std::mutex> call(callMutex);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                while (threads.size() + 1 < numThreads)
+                    threads.emplace_back(&ThreadPool::workerLoop, this);
+
+                job = &body;
+                jobCount = count;
+                jobChunk = (count + numThreads - 1) / numThreads;
+                numRanges = (count + jobChunk - 1) / jobChunk;
+                nextRange = 0;
+                doneRanges = 0;
+                generation++;
+            }
+            workAvailable.notify_all();
+
+            // The calling thread takes ranges too
+            insidePool = true;
+            runRanges();
+            insidePool = false;
+
+            std::unique_lock<std::mutex> lock(mutex);
+            jobDone.wait(lock, [this] { return doneRanges == numRanges; });
+            job = nullptr;
+        }
+
+        // True on the threads running a body, whose own parallelFor calls
+        // run serially
+        static thread_local bool insidePool;
+
+    private:
+        void workerLoop()
+        {
+            insidePool = true;
+            unsigned long long seen = 0;
+            while (true)
+            {
+                {
+                    std::unique_lock<std::mutex> lock(mutex);
+                    workAvailable.wait(lock, [&] { return stop || generation != seen; });
+                    if (stop)
+                        return;
+                    seen = generation;
+                }
+                runRanges();
+            }
+        }
+
+        // Run ranges of the current job until none is left
+        void runRanges()
+        {
+            while (true)
+            {
+                size_t range;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (job == nullptr || nextRange >= numRanges)
+                        return;
+                    range = nextRange++;
+                }
+
+                size_t begin = range * jobChunk;
+                (*job)(begin, std::min(jobCount, begin + jobChunk));
+
+                std::lock_guard<std::mutex> lock(mutex);
+                if (++doneRanges == numRanges)
+                    jobDone.notify_all();
+            }
+        }
+
+        std::mutex callMutex;
+        std::mutex mutex;
+        std::condition_variable workAvailable;
+        std::condition_variable jobDone;
+        std::vector<std::thread> threads;
+        bool stop = false;
+
+        // Current job, split in numRanges ranges of jobChunk indices
+        const std::function<void(size_t, size_t)> *job = nullptr;
+        size_t jobCount = 0;
+        size_t jobChunk = 1;
+        size_t numRanges = 0;
+        size_t nextRange = 0;
+        size_t doneRanges = 0;
+        unsigned long long generation = 0;
+    };
+
+    thread_local bool ThreadPool::insidePool = false;
+}
+
+unsigned int getDefaultThreadCount()
+{
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void parallelFor(size_t count, const std::function<void(size_t, size_t)> &body,
+                 unsigned int numThreads)
+{
+    if (numThreads == 0)
+        numThreads = getDefaultThreadCount();
+    numThreads = (unsigned int)std::min<size_t>(numThreads, count);
+
+    if (numThreads <= 1 || ThreadPool::insidePool)
+    {
+        if (count > 0)
+            body(0, count);
+        return;
+    }
+
+    static ThreadPool pool;
+    pool.run(count, body, numThreads);
+}
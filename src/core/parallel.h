@@ -0,0 +1,29 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <atomic>
+#include <cstddef>
+#include <functional>
+
+// Number of threads used when a function is given numThreads = 0
+unsigned int getDefaultThreadCount();
+
+// Split [0, count) into one contiguous range per thread and call
+// body(begin, end) for each range in parallel. Returns when all of them are
+// done. body must not use rand() or other state shared between threads.
+// The threads are kept alive between calls; calls made from inside a body
+// run serially on its thread
+void parallelFor(size_t count, const std::function<void(size_t, size_t)> &body,
+                 unsigned int numThreads = 0);
+
+// Add v to a double shared between the threads of a parallelFor (without
+// relying on fetch_add for floats)
+inline void atomicAdd(double &a, double v)
+{
+    std::atomic_ref<double> ref(a);
+    double current = ref.load(std::memory_order_relaxed);
+    while (!ref.compare_exchange_weak(current, current + v, std::memory_order_relaxed))
+        ;
+}
+
+#endif // PARALLEL_H
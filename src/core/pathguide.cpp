@@ -0,0 +1,322 @@
+#include "pathguide.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+
+#include "parallel.h"
+
+#define PI 3.14159265358979323846
+
+// Largest random number used, so that u / p stays below 1 in the quadtree
+#define ONE_MINUS_EPSILON 0.99999999
+
+static void atomicMin(float &a, float v)
+{
+    std::atomic_ref<float> ref(a);
+    float current = ref.load(std::memory_order_relaxed);
+    while (v < current && !ref.compare_exchange_weak(current, v, std::memory_order_relaxed))
+        ;
+}
+
+static void atomicMax(float &a, float v)
+{
+    std::atomic_ref<float> ref(a);
+    float current = ref.load(std::memory_order_relaxed);
+    while (v > current && !ref.compare_exchange_weak(current, v, std::memory_order_relaxed))
+        ;
+}
+
+static double component(const Vector3D &v, int axis)
+{
+    return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+}
+
+// Cylindrical coordinates of a direction: (cos theta + 1) / 2 and phi / 2pi,
+// both in [0, 1], with a constant jacobian of 4pi
+static void directionToSquare(const Vector3D &w, double &u, double &v)
+{
+    u = std::clamp((w.z + 1.0) * 0.5, 0.0, ONE_MINUS_EPSILON);
+    double phi = std::atan2(w.y, w.x);
+    if (phi < 0.0)
+        phi += 2.0 * PI;
+    v = std::clamp(phi / (2.0 * PI), 0.0, ONE_MINUS_EPSILON);
+}
+
+static Vector3D squareToDirection(double u, double v)
+{
+    double cosTheta = 2.0 * u - 1.0;
+    double sinTheta = std::sqrt(std::max(0.0, 1.0 - cosTheta * cosTheta));
+    double phi = 2.0 * PI * v;
+    return Vector3D(sinTheta * std::cos(phi), sinTheta * std::sin(phi), cosTheta);
+}
+
+PathGuide::PathGuide()
+    : learning(true), bsdfFraction(0.5), spatialThreshold(4000.0), fluxThreshold(0.01),
+      maxDirectionalDepth(20), maxSpatialNodes(4096), maxDirectionalNodes(1024)
+{
+    clear();
+}
+
+void PathGuide::clear()
+{
+    nodes.assign(1, SpatialNode{ 0, 0.0, { 0, 0 }, 0 });
+    leaves.assign(1, Leaf{ emptyTree(), emptyTree(), 0.0 });
+    bounds = BoundingBox();
+    iterations = 0;
+}
+
+PathGuide::DirectionalTree PathGuide::emptyTree()
+{
+    DirectionalTree tree;
+    tree.nodes.push_back({ { 0.0, 0.0, 0.0, 0.0 }, { 0, 0, 0, 0 } });
+    return tree;
+}
+
+size_t PathGuide::getMemoryUsage() const
+{
+    size_t bytes = nodes.size() * sizeof(SpatialNode) + leaves.size() * sizeof(Leaf);
+    for (const Leaf &leaf : leaves)
+        bytes += (leaf.sampling.nodes.size() + leaf.training.nodes.size()) * sizeof(QuadNode);
+    return bytes;
+}
+
+const PathGuide::Leaf &PathGuide::findLeaf(const Vector3D &x) const
+{
+    int node = 0;
+    while (nodes[node].leaf < 0)
+        node = nodes[node].children[component(x, nodes[node].axis) < nodes[node].split ? 0 : 1];
+    return leaves[nodes[node].leaf];
+}
+
+PathGuide::Leaf &PathGuide::findLeaf(const Vector3D &x)
+{
+    return const_cast<Leaf &>(static_cast<const PathGuide *>(this)->findLeaf(x));
+}
+
+Vector3D PathGuide::sample(const Vector3D &x, double u1, double u2, double &pdf) const
+{
+    const DirectionalTree &tree = findLeaf(x).sampling;
+    u1 = std::clamp(u1, 0.0, ONE_MINUS_EPSILON);
+    u2 = std::clamp(u2, 0.0, ONE_MINUS_EPSILON);
+
+    // Down the quadtree, choosing the column and then the row of the
+    // quadrant by their radiance, and uniformly inside the last one
+    double squarePdf = 1.0;
+    double originU = 0.0, originV = 0.0, size = 1.0;
+    int node = 0;
+    while (true)
+    {
+        const QuadNode &q = tree.nodes[node];
+        double total = q.sum[0] + q.sum[1] + q.sum[2] + q.sum[3];
+        if (total <= 0.0)
+            break;
+
+        double left = (q.sum[0] + q.sum[2]) / total;
+        int qu = u1 < left ? 0 : 1;
+        u1 = std::min(qu == 0 ? u1 / left : (u1 - left) / (1.0 - left), ONE_MINUS_EPSILON);
+
+        double column = q.sum[qu] + q.sum[qu + 2];
+        double bottom = q.sum[qu] / column;
+        int qv = u2 < bottom ? 0 : 1;
+        u2 = std::min(qv == 0 ? u2 / bottom : (u2 - bottom) / (1.0 - bottom), ONE_MINUS_EPSILON);
+
+        int i = qu + 2 * qv;
+        squarePdf *= 4.0 * q.sum[i] / total;
+        size *= 0.5;
+        originU += qu * size;
+        originV += qv * size;
+
+        if (q.children[i] == 0)
+            break;
+        node = q.children[i];
+    }
+
+    pdf = squarePdf / (4.0 * PI);
+    return squareToDirection(originU + u1 * size, originV + u2 * size);
+}
+
+double PathGuide::getPdf(const Vector3D &x, const Vector3D &wi) const
+{
+    const DirectionalTree &tree = findLeaf(x).sampling;
+    double u, v;
+    directionToSquare(wi, u, v);
+
+    double squarePdf = 1.0;
+    int node = 0;
+    while (true)
+    {
+        const QuadNode &q = tree.nodes[node];
+        double total = q.sum[0] + q.sum[1] + q.sum[2] + q.sum[3];
+        if (total <= 0.0)
+            break;
+
+        int qu = u < 0.5 ? 0 : 1;
+        int qv = v < 0.5 ? 0 : 1;
+        int i = qu + 2 * qv;
+        squarePdf *= 4.0 * q.sum[i] / total;
+
+        if (q.children[i] == 0 || squarePdf <= 0.0)
+            break;
+        node = q.children[i];
+        u = 2.0 * u - qu;
+        v = 2.0 * v - qv;
+    }
+
+    return squarePdf / (4.0 * PI);
+}
+
+void PathGuide::record(const Vector3D &x, const Vector3D &wi, const Vector3D &L, double pdf)
+{
+    if (!learning || !(pdf > 0.0))
+        return;
+    double value = (L.x + L.y + L.z) / (3.0 * pdf);
+    if (!std::isfinite(value))
+        return;
+
+    if (iterations == 0)
+    {
+        atomicMin(bounds.pMin.x, x.x);
+        atomicMin(bounds.pMin.y, x.y);
+        atomicMin(bounds.pMin.z, x.z);
+        atomicMax(bounds.pMax.x, x.x);
+        atomicMax(bounds.pMax.y, x.y);
+        atomicMax(bounds.pMax.z, x.z);
+    }
+
+    // The radiance estimate goes to every level of the quadtree down to the
+    // leaf quadrant of wi
+    Leaf &leaf = findLeaf(x);
+    atomicAdd(leaf.samples, 1.0);
+
+    double u, v;
+    directionToSquare(wi, u, v);
+    int node = 0;
+    while (true)
+    {
+        QuadNode &q = leaf.training.nodes[node];
+        int qu = u < 0.5 ? 0 : 1;
+        int qv = v < 0.5 ? 0 : 1;
+        int i = qu + 2 * qv;
+        atomicAdd(q.sum[i], value);
+
+        if (q.children[i] == 0)
+            break;
+        node = q.children[i];
+        u = 2.0 * u - qu;
+        v = 2.0 * v - qv;
+    }
+}
+
+void PathGuide::update()
+{
+    if (iterations == 0 && bounds.isEmpty())
+        bounds = BoundingBox(Vector3D(0.0));
+
+    // The passes double their samples, and the leaves their count as the
+    // square root of that
+    refineSpatial(0, bounds, spatialThreshold * std::sqrt(std::pow(2.0, iterations)));
+
+    // What was recorded becomes the distribution to sample from. Leaves
+    // which received nothing keep the one they had
+    for (Leaf &leaf : leaves)
+    {
+        if (leaf.samples <= 0.0)
+            continue;
+        leaf.sampling = std::move(leaf.training);
+        leaf.training = refineDirectional(leaf.sampling);
+        leaf.samples = 0.0;
+    }
+
+    iterations++;
+}
+
+void PathGuide::refineSpatial(int node, const BoundingBox &box, double threshold)
+{
+    if (nodes[node].leaf < 0)
+    {
+        int axis = nodes[node].axis;
+        double split = nodes[node].split;
+        BoundingBox lower = box, upper = box;
+        if (axis == 0) { lower.pMax.x = split; upper.pMin.x = split; }
+        else if (axis == 1) { lower.pMax.y = split; upper.pMin.y = split; }
+        else { lower.pMax.z = split; upper.pMin.z = split; }
+        refineSpatial(nodes[node].children[0], lower, threshold);
+        refineSpatial(nodes[node].children[1], upper, threshold);
+        return;
+    }
+
+    int leafIndex = nodes[node].leaf;
+    if (leaves[leafIndex].samples <= threshold || nodes.size() + 2 > maxSpatialNodes)
+        return;
+
+    // Split in the middle of the longest side. Both halves start from the
+    // distributions of the leaf, with half of its samples
+    int axis = box.maxExtent();
+    double split = 0.5 * (component(box.pMin, axis) + component(box.pMax, axis));
+    leaves[leafIndex].samples *= 0.5;
+    leaves.push_back(leaves[leafIndex]);
+
+    int lowerNode = (int)nodes.size();
+    nodes.push_back({ 0, 0.0, { 0, 0 }, leafIndex });
+    nodes.push_back({ 0, 0.0, { 0, 0 }, (int)leaves.size() - 1 });
+    nodes[node] = { axis, split, { lowerNode, lowerNode + 1 }, -1 };
+
+    refineSpatial(node, box, threshold);
+}
+
+PathGuide::DirectionalTree PathGuide::refineDirectional(const DirectionalTree &tree) const
+{
+    DirectionalTree refined = emptyTree();
+
+    const QuadNode &root = tree.nodes[0];
+    double total = root.sum[0] + root.sum[1] + root.sum[2] + root.sum[3];
+    if (total <= 0.0)
+        return refined;
+
+    // Breadth first, so that the coarse levels are kept when the nodes run
+    // out. The quadrants which the old tree did not split share their
+    // radiance equally
+    struct Pending
+    {
+        int node;
+        int oldNode;            // -1 if the old tree did not go this deep
+        double energy[4];
+        int depth;
+    };
+    std::vector<Pending> queue;
+    queue.push_back({ 0, 0, { root.sum[0], root.sum[1], root.sum[2], root.sum[3] }, 1 });
+
+    for (size_t head = 0; head < queue.size(); head++)
+    {
+        Pending item = queue[head];
+        for (int i = 0; i < 4; i++)
+        {
+            if (item.energy[i] <= fluxThreshold * total || item.depth >= maxDirectionalDepth ||
+                refined.nodes.size() >= maxDirectionalNodes)
+                continue;
+
+            Pending child;
+            child.node = (int)refined.nodes.size();
+            child.depth = item.depth + 1;
+            child.oldNode = item.oldNode >= 0 ? tree.nodes[item.oldNode].children[i] : 0;
+            if (child.oldNode > 0)
+            {
+                for (int j = 0; j < 4; j++)
+                    child.energy[j] = tree.nodes[child.oldNode].sum[j];
+            }
+            else
+            {
+                child.oldNode = -1;
+                for (int j = 0; j < 4; j++)
+                    child.energy[j] = item.energy[i] * 0.25;
+            }
+
+            refined.nodes.push_back({ { 0.0, 0.0, 0.0, 0.0 }, { 0, 0, 0, 0 } });
+            refined.nodes[item.node].children[i] = child.node;
+            queue.push_back(child);
+        }
+    }
+
+    return refined;
+}
@@ -0,0 +1,118 @@
+#ifndef PATHGUIDE_H
+#define PATHGUIDE_H
+
+#include <vector>
+
+#include "boundingbox.h"
+#include "vector3d.h"
+
+// Path guiding with a spatial-directional tree (SD-tree, "Practical Path
+// Guiding", Mueller et al. 2017). A binary tree over the scene holds, in
+// every leaf, a quadtree over the sphere of directions (cylindrical
+// coordinates, so that the mapping keeps the areas) which approximates the
+// incident radiance in that region. The shaders sample their bounces from
+// it, mixed with their own sampling, and record the radiance they find
+// along the way.
+// It learns online, over training passes: every call to update() closes a
+// pass, splits the spatial leaves which received more than
+// spatialThreshold * sqrt(2^pass) samples (as the passes double their
+// samples, like in the paper), makes the radiance recorded in each leaf
+// its new sampling distribution, and refines the quadtrees where the next
+// pass records to the directions with more than fluxThreshold of the
+// radiance. The region covered by the spatial tree is the box of the points
+// recorded in the first pass.
+// record() can be called from several threads at once (the sums are added
+// atomically, the trees do not change while recording), and sample() and
+// getPdf() only read. update() and clear() must not run meanwhile. The
+// memory is bounded by maxSpatialNodes and maxDirectionalNodes (two
+// quadtrees per spatial leaf), see getMemoryUsage().
+class PathGuide
+{
+public:
+    PathGuide();
+
+    // True once a training pass has been closed by update(): until then
+    // there is nothing to sample from
+    bool isReady() const { return iterations > 0; }
+
+    // Direction learned at x for the random numbers u1, u2, with its density
+    // (per unit solid angle) in pdf
+    Vector3D sample(const Vector3D &x, double u1, double u2, double &pdf) const;
+
+    // Density of sampling wi at x
+    double getPdf(const Vector3D &x, const Vector3D &wi) const;
+
+    // Add the radiance L arriving at x from wi, sampled with the density pdf
+    // (of the shader's mixture), to the current training pass. Nothing is
+    // recorded unless learning is set
+    void record(const Vector3D &x, const Vector3D &wi, const Vector3D &L, double pdf);
+
+    // Close the current training pass (see above)
+    void update();
+
+    // Forget everything learned (e.g., when the scene changes)
+    void clear();
+
+    int getIterationCount() const { return iterations; }
+    size_t getSpatialLeafCount() const { return leaves.size(); }
+
+    // Bytes used by the trees
+    size_t getMemoryUsage() const;
+
+    // Settings
+    bool learning;              // record() adds to the training pass
+    double bsdfFraction;        // Probability of the shaders' own sampling, in (0, 1]
+    double spatialThreshold;    // Samples of a spatial leaf before it is split
+    double fluxThreshold;       // Fraction of the radiance of a quadtree node before it is split
+    int maxDirectionalDepth;
+    size_t maxSpatialNodes;
+    size_t maxDirectionalNodes; // Per quadtree
+
+private:
+    // Quadtree node: the radiance recorded in each of its four quadrants
+    // (with all of their subtree) and their child nodes (0 = none)
+    struct QuadNode
+    {
+        double sum[4];
+        int children[4];
+    };
+
+    struct DirectionalTree
+    {
+        std::vector<QuadNode> nodes;    // nodes[0] is the root
+    };
+
+    struct Leaf
+    {
+        DirectionalTree sampling;       // Learned in the passes before
+        DirectionalTree training;       // Recorded in the current pass
+        double samples;                 // Recorded in the current pass
+    };
+
+    // Spatial tree node: split in two at split along axis, or a leaf
+    struct SpatialNode
+    {
+        int axis;
+        double split;
+        int children[2];
+        int leaf;               // Index in leaves, -1 for inner nodes
+    };
+
+    const Leaf &findLeaf(const Vector3D &x) const;
+    Leaf &findLeaf(const Vector3D &x);
+
+    // Split the leaves of the subtree of node (over box) with too many samples
+    void refineSpatial(int node, const BoundingBox &box, double threshold);
+
+    // Quadtree for the next pass, refined from the radiance in tree
+    DirectionalTree refineDirectional(const DirectionalTree &tree) const;
+
+    static DirectionalTree emptyTree();
+
+    std::vector<SpatialNode> nodes;     // nodes[0] is the root
+    std::vector<Leaf> leaves;
+    BoundingBox bounds;                 // Of the points of the first pass
+    int iterations;
+};
+
+#endif // PATHGUIDE_H
@@ -0,0 +1,141 @@
+#include "photonmap.h"
+
+#include <algorithm>
+#include <utility>
+
+static inline double axisValue(const Vector3D &v, int axis)
+{
+    return axis == 0 ? v.x : (axis == 1 ? v.y : v.z);
+}
+
+// Max-heap of the photons found so far, by their squared distance
+struct PhotonMap::Search
+{
+    Vector3D x;
+    size_t k;
+    double radius2;
+    std::vector<std::pair<double, const Photon*>> heap;
+};
+
+PhotonMap::PhotonMap()
+{ }
+
+void PhotonMap::clear()
+{
+    photons.clear();
+    axes.clear();
+}
+
+void PhotonMap::add(const Photon &photon)
+{
+    photons.push_back(photon);
+}
+
+void PhotonMap::add(const std::vector<Photon> &newPhotons)
+{
+    photons.insert(photons.end(), newPhotons.begin(), newPhotons.end());
+}
+
+void PhotonMap::build()
+{
+    axes.assign(photons.size(), 0);
+    buildRange(0, photons.size());
+}
+
+void PhotonMap::buildRange(size_t begin, size_t end)
+{
+    if (end - begin <= 1)
+        return;
+
+    // Split along the largest extent of the photons of the range
+    Vector3D pMin = photons[begin].position;
+    Vector3D pMax = pMin;
+    for (size_t i = begin + 1; i < end; i++)
+    {
+        const Vector3D &p = photons[i].position;
+        pMin = Vector3D(std::min(pMin.x, p.x), std::min(pMin.y, p.y), std::min(pMin.z, p.z));
+        pMax = Vector3D(std::max(pMax.x, p.x), std::max(pMax.y, p.y), std::max(pMax.z, p.z));
+    }
+    Vector3D extent = pMax - pMin;
+    int axis = 0;
+    if (extent.y > extent.x)
+        axis = 1;
+    if (extent.z > axisValue(extent, axis))
+        axis = 2;
+
+    size_t median = begin + (end - begin) / 2;
+    std::nth_element(photons.begin() + begin, photons.begin() + median, photons.begin() + end,
+        [axis](const Photon &a, const Photon &b) {
+            return axisValue(a.position, axis) < axisValue(b.position, axis);
+        });
+    axes[median] = (unsigned char)axis;
+
+    buildRange(begin, median);
+    buildRange(median + 1, end);
+}
+
+void PhotonMap::findNearest(const Vector3D &x, size_t k, double maxDistance,
+                            std::vector<const Photon*> &result, double &radius2) const
+{
+    Search search;
+    search.x = x;
+    search.k = k;
+    search.radius2 = maxDistance * maxDistance;
+    search.heap.reserve(k);
+
+    if (k > 0)
+        searchRange(0, photons.size(), search);
+
+    result.clear();
+    for (const auto &found : search.heap)
+        result.push_back(found.second);
+
+    // With fewer than k photons the whole search disk was covered
+    radius2 = search.heap.size() < k || search.heap.empty() ? maxDistance * maxDistance
+                                                            : search.heap.front().first;
+}
+
+void PhotonMap::searchRange(size_t begin, size_t end, Search &search) const
+{
+    if (begin >= end)
+        return;
+
+    size_t median = begin + (end - begin) / 2;
+    const Photon &photon = photons[median];
+    int axis = axes[median];
+    double delta = axisValue(search.x, axis) - axisValue(photon.position, axis);
+
+    // The side of the splitting plane where x is first
+    if (delta < 0.0)
+        searchRange(begin, median, search);
+    else
+        searchRange(median + 1, end, search);
+
+    double distance2 = (photon.position - search.x).lengthSq();
+    if (distance2 < search.radius2)
+    {
+        auto closer = [](const std::pair<double, const Photon*> &a,
+                         const std::pair<double, const Photon*> &b) { return a.first < b.first; };
+        if (search.heap.size() == search.k)
+        {
+            std::pop_heap(search.heap.begin(), search.heap.end(), closer);
+            search.heap.pop_back();
+        }
+        search.heap.push_back(std::make_pair(distance2, &photon));
+        std::push_heap(search.heap.begin(), search.heap.end(), closer);
+
+        // Once k photons are kept, only closer ones matter
+        if (search.heap.size() == search.k)
+            search.radius2 = search.heap.front().first;
+    }
+
+    // Then the other side, if it is still closer than the farthest photon
+    // kept
+    if (delta * delta < search.radius2)
+    {
+        if (delta < 0.0)
+            searchRange(median + 1, end, search);
+        else
+            searchRange(begin, median, search);
+    }
+}
@@ -0,0 +1,49 @@
+#ifndef PHOTONMAP_H
+#define PHOTONMAP_H
+
+#include <cstddef>
+#include <vector>
+
+#include "vector3d.h"
+
+struct Photon
+{
+    Vector3D position;
+    Vector3D direction;     // Direction of travel when it arrived
+    Vector3D power;
+};
+
+// Photons stored in a balanced kd-tree (Jensen, "Realistic Image Synthesis
+// Using Photon Mapping"). The tree is implicit: the photons of a range are
+// split at their median, which is kept in the middle of the range, so the
+// array itself is the tree and needs no extra memory but the split axes.
+class PhotonMap
+{
+public:
+    PhotonMap();
+
+    void clear();
+    void add(const Photon &photon);
+    void add(const std::vector<Photon> &newPhotons);
+
+    // Build the tree once all the photons are added
+    void build();
+
+    size_t size() const { return photons.size(); }
+
+    // The (at most) k photons closest to x, within maxDistance. Returns them
+    // in result, and in radius2 the squared distance to the farthest one
+    void findNearest(const Vector3D &x, size_t k, double maxDistance,
+                     std::vector<const Photon*> &result, double &radius2) const;
+
+private:
+    void buildRange(size_t begin, size_t end);
+
+    struct Search;
+    void searchRange(size_t begin, size_t end, Search &search) const;
+
+    std::vector<Photon> photons;
+    std::vector<unsigned char> axes;
+};
+
+#endif // PHOTONMAP_H
@@ -0,0 +1,78 @@
+#include "photontracer.h"
+
+#include <algorithm>
+#include <random>
+
+#include "parallel.h"
+#include "utils.h"
+
+// Photons traced with the same random sequence
+#define PHOTON_BLOCK 4096
+
+size_t photonBlockCount(size_t count)
+{
+    return (count + PHOTON_BLOCK - 1) / PHOTON_BLOCK;
+}
+
+void tracePhotons(const Scene &scene, size_t count, unsigned int seed, int maxDepth,
+                  unsigned int numThreads, const PhotonHitCallback &hit)
+{
+    parallelFor(photonBlockCount(count), [&](size_t begin, size_t end) {
+        for (size_t block = begin; block < end; block++)
+        {
+            std::mt19937 rng((unsigned int)(seed + block * 2));
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+            size_t blockEnd = std::min(count, (block + 1) * PHOTON_BLOCK);
+
+            for (size_t i = block * PHOTON_BLOCK; i < blockEnd; i++)
+            {
+                // Light chosen by its power, then a point and a direction
+                double pmf;
+                const LightSource *light = scene.lightSampler.sample(uniform(rng), pmf);
+                if (light == nullptr || pmf <= 0.0)
+                    continue;
+                Vector3D y, normal, w, power;
+                double u1 = uniform(rng), u2 = uniform(rng), u3 = uniform(rng), u4 = uniform(rng);
+                if (!light->samplePhoton(u1, u2, u3, u4, y, normal, w, power))
+                    continue;
+                power = power / pmf;
+
+                Ray ray(y, w);
+                bool throughSpecular = false;
+                for (int bounce = 0; bounce < maxDepth; bounce++)
+                {
+                    Intersection its;
+                    if (!Utils::getClosestIntersection(ray, scene, its))
+                        break;
+
+                    const MaterialRecord &material = scene.getMaterial(its);
+                    Vector3D n = its.normal.normalized();
+                    Vector3D d = ray.d.normalized();
+
+                    if (!material.hasDiffuseOrGlossy())
+                    {
+                        if (!Utils::scatterSpecular(material, its.itsPoint, n, d, ray.depth + 1, ray.time, ray))
+                            break;
+                        throughSpecular = true;
+                        continue;
+                    }
+
+                    if (!hit(block, bounce, { its.itsPoint, d, power }, throughSpecular))
+                        break;
+
+                    // Russian roulette with the diffuse reflectance, then a
+                    // cosine weighted direction on the side it came from
+                    Vector3D rho = material.getDiffuseReflectance();
+                    double p = (rho.x + rho.y + rho.z) / 3.0;
+                    if (uniform(rng) >= p)
+                        break;
+                    power = power * rho / p;
+
+                    Vector3D nf = dot(n, d) < 0 ? n : -n;
+                    double v1 = uniform(rng), v2 = uniform(rng);
+                    ray = Ray(its.itsPoint, Utils::sampleCosineHemisphere(nf, v1, v2));
+                }
+            }
+        }
+    }, numThreads);
+}
@@ -0,0 +1,30 @@
+#ifndef PHOTONTRACER_H
+#define PHOTONTRACER_H
+
+#include <cstddef>
+#include <functional>
+
+#include "photonmap.h"
+#include "scene.h"
+
+// Called by tracePhotons at every diffuse or glossy surface a photon lands
+// on, with the block of photons it belongs to, the bounces before the hit,
+// the photon (its power is the emitted one over the pmf of its light) and
+// whether it went through a mirror or glass on the way. Returns whether the
+// photon goes on (Russian roulette permitting)
+using PhotonHitCallback = std::function<bool(size_t block, int bounce, const Photon &photon,
+                                             bool throughSpecular)>;
+
+// Number of blocks the count photons of tracePhotons are split into
+size_t photonBlockCount(size_t count);
+
+// Emit count photons from the lights of the scene, chosen by their power,
+// on numThreads threads. Photons bounce at most maxDepth times: through
+// mirrors and glass, and off the diffuse surfaces with Russian roulette on
+// the diffuse reflectance. Each block of photons has its own random
+// sequence, from seed and the block, so that the result does not depend on
+// the number of threads. hit is called from several threads at once
+void tracePhotons(const Scene &scene, size_t count, unsigned int seed, int maxDepth,
+                  unsigned int numThreads, const PhotonHitCallback &hit);
+
+#endif // PHOTONTRACER_H
@@ -0,0 +1,454 @@
+#include "previewserver.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include "bitmap.h"
+#include "renderer.h"
+#include "utils.h"
+#include "../cameras/perspective.h"
+
+// Largest request header read
+#define MAX_REQUEST_BYTES 8192
+
+static const char *PREVIEW_PAGE =
+    "<!DOCTYPE html><html><head><title>Preview</title></head>"
+    "<body style=\"background:#333;color:#ccc;font-family:sans-serif\">"
+    "<img id=\"image\" src=\"/image.bmp\"><pre id=\"status\"></pre><script>"
+    "function update(){var i=new Image();i.onload=function(){"
+    "document.getElementById('image').src=i.src;setTimeout(update,500);};"
+    "i.onerror=function(){setTimeout(update,2000);};i.src='/image.bmp?'+Date.now();"
+    "fetch('/status').then(function(r){return r.text();}).then(function(t){"
+    "document.getElementById('status').textContent=t;});}update();"
+    "</script></body></html>";
+
+// Value of "key" in a query string "a=1&b=2", false if missing
+static bool queryValue(const std::string &query, const std::string &key, std::string &value)
+{
+    std::stringstream ss(query);
+    std::string item;
+    while (std::getline(ss, item, '&'))
+    {
+        size_t eq = item.find('=');
+        if (eq != std::string::npos && item.substr(0, eq) == key)
+        {
+            value = item.substr(eq + 1);
+            for (size_t i = 0; i < value.size(); i++)
+            {
+                if (value[i] == '+')
+                    value[i] = ' ';
+                else if (value[i] == '%' && i + 2 < value.size())
+                {
+                    value[i] = (char)std::strtol(value.substr(i + 1, 2).c_str(), nullptr, 16);
+                    value.erase(i + 1, 2);
+                }
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool parseVector(const std::string &text, Vector3D &v)
+{
+    double x, y, z;
+    if (std::sscanf(text.c_str(), "%lf,%lf,%lf", &x, &y, &z) != 3)
+        return false;
+    v = Vector3D(x, y, z);
+    return true;
+}
+
+static bool parseNumber(const std::string &text, double &d)
+{
+    char *end = nullptr;
+    d = std::strtod(text.c_str(), &end);
+    return end != text.c_str() && *end == '\0';
+}
+
+// Camera at "position" looking at "target" (the camera looks down its +z
+// axis, with +y up)
+static Matrix4x4 lookAt(const Vector3D &position, const Vector3D &target, const Vector3D &up)
+{
+    Vector3D forward = (target - position).normalized();
+    Vector3D right = cross(up, forward).normalized();
+    Vector3D trueUp = cross(forward, right);
+    return Matrix4x4(right.x, trueUp.x, forward.x, position.x,
+                     right.y, trueUp.y, forward.y, position.y,
+                     right.z, trueUp.z, forward.z, position.z,
+                     0, 0, 0, 1);
+}
+
+// Top-down 24-bit BMP of the film
+static std::vector<unsigned char> encodeBMP(const Film &film, const ToneMapper &toneMapper)
+{
+    const size_t width = film.getWidth();
+    const size_t height = film.getHeight();
+
+    bmp24_info_header infoHeader(width, height, true);
+    bmp24_file_header fileHeader;
+    const size_t headerBytes = bmp24_file_header::BYTES + bmp24_info_header::BYTES;
+    fileHeader.size = (uint32_t)(headerBytes + infoHeader.size_image);
+
+    std::vector<unsigned char> data(headerBytes + infoHeader.size_image, 0);
+    fileHeader.toBytes(&data[0]);
+    infoHeader.toBytes(&data[bmp24_file_header::BYTES]);
+
+    std::vector<float> scratch(3 * width);
+    std::vector<unsigned char> rgb(3 * width);
+    for (size_t y = 0; y < height; y++)
+    {
+        const float *row = reinterpret_cast<const float*>(film.getRow(y));
+        toneMapper.apply(row, width, 0, y, rgb.data(), scratch.data());
+
+        unsigned char *out = &data[headerBytes + y * infoHeader.rowBytes()];
+        for (size_t i = 0; i < width; i++)
+        {
+            out[3 * i]     = rgb[3 * i + 2];
+            out[3 * i + 1] = rgb[3 * i + 1];
+            out[3 * i + 2] = rgb[3 * i];
+        }
+    }
+    return data;
+}
+
+PreviewServer::PreviewServer(Camera &cam_, Shader &shader_, const Scene &scene_, Film &film_)
+    : port(8080), sppPerPass(1), maxPasses(0), cam(cam_), shader(&shader_), scene(scene_),
+      film(film_), accumulator(film_.getWidth(), film_.getHeight()), quit(false)
+{
+    shaders["default"] = &shader_;
+}
+
+void PreviewServer::addShader(const std::string &name, Shader &shader_)
+{
+    shaders[name] = &shader_;
+}
+
+void PreviewServer::change(const std::function<void()> &apply)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pendingChanges.push_back(apply);
+    wakeUp.notify_one();
+}
+
+void PreviewServer::renderLoop()
+{
+    Film pass(film.getWidth(), film.getHeight());
+
+    while (true)
+    {
+        int spp;
+        unsigned int passSeed;
+        const Shader *passShader;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [&] {
+                return quit || !pendingChanges.empty() || maxPasses <= 0 ||
+                       accumulator.getPassCount() < (uint32_t)maxPasses;
+            });
+            if (quit)
+                return;
+
+            if (!pendingChanges.empty())
+            {
+                for (const std::function<void()> &apply : pendingChanges)
+                    apply();
+                pendingChanges.clear();
+                accumulator = Accumulator(film.getWidth(), film.getHeight());
+            }
+
+            spp = sppPerPass;
+            passSeed = accumulator.getPassSeed(accumulator.getPassCount());
+            passShader = shader;
+        }
+
+        // The camera and the shader only change inside the lock above
+        Renderer renderer(cam, *passShader, scene);
+        renderer.renderPass(pass, spp, passSeed);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        accumulator.addPass(pass, spp);
+        accumulator.resolve(film);
+    }
+}
+
+std::string PreviewServer::handle(const std::string &path, const std::string &query,
+                                  std::vector<unsigned char> &body, std::string &contentType)
+{
+    contentType = "text/plain";
+    std::string text, value;
+    std::string status = "200 OK";
+
+    if (path == "/")
+    {
+        contentType = "text/html";
+        text = PREVIEW_PAGE;
+    }
+    else if (path == "/image.bmp")
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        contentType = "image/bmp";
+        body = encodeBMP(film, toneMapper);
+        return status;
+    }
+    else if (path == "/status")
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::ostringstream ss;
+        ss << "passes " << accumulator.getPassCount() << "\n"
+           << "spp " << accumulator.getPassCount() * sppPerPass << "\n"
+           << "pending changes " << pendingChanges.size() << "\n";
+        text = ss.str();
+    }
+    else if (path == "/camera")
+    {
+        // Current pose, which the render thread might be changing
+        Matrix4x4 cameraToWorld;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            cameraToWorld = cam.cameraToWorld;
+        }
+        Vector3D position = cameraToWorld.transformPoint(Vector3D(0, 0, 0));
+        Vector3D target = position + cameraToWorld.transformVector(Vector3D(0, 0, 1));
+        Vector3D up(0, 1, 0);
+        double fov = -1, aperture = -1, focus = -1;
+        bool ok = true;
+
+        bool moved = false;
+        if (queryValue(query, "position", value))
+        {
+            moved = true;
+            ok = ok && parseVector(value, position);
+        }
+        if (queryValue(query, "target", value))
+        {
+            moved = true;
+            ok = ok && parseVector(value, target);
+        }
+        if (queryValue(query, "up", value))
+        {
+            moved = true;
+            ok = ok && parseVector(value, up);
+        }
+        if (queryValue(query, "fov", value))
+            ok = ok && parseNumber(value, fov) && fov > 0 && fov < 180;
+        if (queryValue(query, "aperture", value))
+            ok = ok && parseNumber(value, aperture) && aperture >= 0;
+        if (queryValue(query, "focus", value))
+            ok = ok && parseNumber(value, focus) && focus > 0;
+
+        PerspectiveCamera *perspective = dynamic_cast<PerspectiveCamera*>(&cam);
+        if (fov > 0 && perspective == nullptr)
+            ok = false;
+
+        if (!ok)
+        {
+            status = "400 Bad Request";
+            text = "Bad camera parameters\n";
+        }
+        else
+        {
+            change([=, this] {
+                if (moved)
+                    cam.cameraToWorld = lookAt(position, target, up);
+                if (fov > 0)
+                    perspective->fov = Utils::degreesToRadians(fov);
+                if (aperture >= 0 || focus > 0)
+                    cam.setThinLens(aperture >= 0 ? aperture : cam.apertureRadius,
+                                    focus > 0 ? focus : cam.focusDistance);
+            });
+            text = "ok\n";
+        }
+    }
+    else if (path == "/shader")
+    {
+        Shader *newShader = nullptr;
+        Vector3D background;
+        bool hasBackground = queryValue(query, "background", value);
+        bool ok = !hasBackground || parseVector(value, background);
+
+        if (queryValue(query, "name", value))
+        {
+            auto found = shaders.find(value);
+            if (found == shaders.end())
+                ok = false;
+            else
+                newShader = found->second;
+        }
+
+        if (!ok)
+        {
+            status = "400 Bad Request";
+            text = "Bad shader parameters\n";
+        }
+        else
+        {
+            change([=, this] {
+                if (newShader != nullptr)
+                    shader = newShader;
+                if (hasBackground)
+                    shader->bgColor = background;
+            });
+            text = "ok\n";
+        }
+    }
+    else if (path == "/settings")
+    {
+        double spp = -1, passes = -1, exposure = -1, gamma = -1;
+        bool ok = true;
+        if (queryValue(query, "spp", value))
+            ok = ok && parseNumber(value, spp) && spp >= 1;
+        if (queryValue(query, "passes", value))
+            ok = ok && parseNumber(value, passes) && passes >= 0;
+        if (queryValue(query, "exposure", value))
+            ok = ok && parseNumber(value, exposure) && exposure > 0;
+        if (queryValue(query, "gamma", value))
+            ok = ok && parseNumber(value, gamma) && gamma > 0;
+
+        if (!ok)
+        {
+            status = "400 Bad Request";
+            text = "Bad settings\n";
+        }
+        else
+        {
+            // The tone mapping is only used here, by the image requests
+            if (exposure > 0)
+                toneMapper.exposure = exposure;
+            if (gamma > 0)
+            {
+                toneMapper.gamma = gamma;
+                toneMapper.prepare();
+            }
+            if (spp >= 1 || passes >= 0)
+            {
+                change([=, this] {
+                    if (spp >= 1)
+                        sppPerPass = (int)spp;
+                    if (passes >= 0)
+                        maxPasses = (int)passes;
+                });
+            }
+            text = "ok\n";
+        }
+    }
+    else if (path == "/quit")
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        quit = true;
+        wakeUp.notify_one();
+        text = "bye\n";
+    }
+    else
+    {
+        status = "404 Not Found";
+        text = "Unknown request\n";
+    }
+
+    body.assign(text.begin(), text.end());
+    return status;
+}
+
+#ifndef _WIN32
+
+bool PreviewServer::run()
+{
+    int server = socket(AF_INET, SOCK_STREAM, 0);
+    if (server < 0)
+    {
+        std::cout << "PreviewServer: could not create a socket" << std::endl;
+        return false;
+    }
+
+    int reuse = 1;
+    setsockopt(server, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address = {};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(server, (sockaddr*)&address, sizeof(address)) != 0 || listen(server, 8) != 0)
+    {
+        std::cout << "PreviewServer: could not listen on port " << port << std::endl;
+        close(server);
+        return false;
+    }
+
+    toneMapper.prepare();
+    quit = false;
+    std::thread renderThread(&PreviewServer::renderLoop, this);
+    std::cout << "Preview at http://localhost:" << port << "/" << std::endl;
+
+    bool done = false;
+    while (!done)
+    {
+        int client = accept(server, nullptr, nullptr);
+        if (client < 0)
+            continue;
+
+        // Read the header of the request; the body, if any, is ignored
+        std::string request;
+        char buffer[1024];
+        while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_BYTES)
+        {
+            ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+            if (n <= 0)
+                break;
+            request.append(buffer, (size_t)n);
+        }
+
+        // "GET /path?query HTTP/1.1"
+        std::string method, target;
+        std::istringstream line(request);
+        line >> method >> target;
+        size_t questionMark = target.find('?');
+        std::string path = target.substr(0, questionMark);
+        std::string query = questionMark == std::string::npos ? "" : target.substr(questionMark + 1);
+
+        std::vector<unsigned char> body;
+        std::string contentType;
+        std::string status = handle(path, query, body, contentType);
+        done = path == "/quit";
+
+        std::ostringstream header;
+        header << "HTTP/1.1 " << status << "\r\n"
+               << "Content-Type: " << contentType << "\r\n"
+               << "Content-Length: " << body.size() << "\r\n"
+               << "Cache-Control: no-store\r\n"
+               << "Connection: close\r\n\r\n";
+        std::string headerText = header.str();
+        send(client, headerText.data(), headerText.size(), MSG_NOSIGNAL);
+        size_t sent = 0;
+        while (sent < body.size())
+        {
+            ssize_t n = send(client, body.data() + sent, body.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0)
+                break;
+            sent += (size_t)n;
+        }
+        close(client);
+    }
+
+    renderThread.join();
+    close(server);
+    return true;
+}
+
+#else
+
+bool PreviewServer::run()
+{
+    std::cout << "PreviewServer: not available on this platform" << std::endl;
+    return false;
+}
+
+#endif
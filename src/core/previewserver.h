@@ -0,0 +1,77 @@
+#ifndef PREVIEWSERVER_H
+#define PREVIEWSERVER_H
+
+#include <condition_variable>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "accumulator.h"
+#include "film.h"
+#include "scene.h"
+#include "tonemapper.h"
+#include "../cameras/camera.h"
+#include "../shaders/shader.h"
+
+// Interactive preview: keeps the scene (and its BVH) loaded, renders it
+// progressively on a thread of its own and serves the latest image over
+// HTTP on localhost, so that the camera and the shader can be tweaked from
+// a browser or curl without restarting the program. Every change restarts
+// the accumulation; it is applied between two passes, so the renderer never
+// sees a half-updated camera. Requests (all GET):
+//   /                   Page which reloads the image
+//   /image.bmp          Current image, tone mapped
+//   /status             Passes and samples per pixel accumulated so far
+//   /camera?position=x,y,z&target=x,y,z&up=x,y,z&fov=deg&aperture=r&focus=d
+//   /shader?name=n&background=r,g,b
+//   /settings?spp=n&passes=n&exposure=e&gamma=g
+//   /quit               Stop the server (run() returns)
+// Every parameter is optional; "name" is one given to addShader().
+class PreviewServer
+{
+public:
+    PreviewServer() = delete;
+    PreviewServer(Camera &cam_, Shader &shader_, const Scene &scene_, Film &film_);
+
+    // Make a shader selectable by name (the one of the constructor is "default")
+    void addShader(const std::string &name, Shader &shader);
+
+    // Serve until /quit is requested. Returns false if the port could not
+    // be opened
+    bool run();
+
+    // Settings
+    unsigned short port;
+    int sppPerPass;
+    int maxPasses;              // The render pauses after these; 0 = never
+    ToneMapper toneMapper;
+
+private:
+    // Render thread: apply the pending changes, render a pass, add it
+    void renderLoop();
+
+    // Answer a request; body and content type of the answer, and its
+    // status line (e.g., "200 OK")
+    std::string handle(const std::string &path, const std::string &query,
+                       std::vector<unsigned char> &body, std::string &contentType);
+
+    // Queue a change for the render thread, which restarts the accumulation
+    void change(const std::function<void()> &apply);
+
+    Camera &cam;
+    Shader *shader;
+    const Scene &scene;
+    Film &film;
+    std::map<std::string, Shader*> shaders;
+
+    // Shared with the render thread
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::vector<std::function<void()>> pendingChanges;
+    Accumulator accumulator;
+    bool quit;
+};
+
+#endif // PREVIEWSERVER_H
@@ -0,0 +1,434 @@
+#include "primitivestore.h"
+
+#include <cmath>
+
+#include "../shapes/sphere.h"
+#include "../shapes/square.h"
+#include "../shapes/infiniteplan.h"
+#include "../shapes/triangle.h"
+
+PrimitiveStore::PrimitiveStore()
+{ }
+
+void PrimitiveStore::add(const Shape *shape, unsigned int materialId)
+{
+    PrimitiveRef prim;
+
+    const Sphere* sphere = dynamic_cast<const Sphere*>(shape);
+    const Square* square = dynamic_cast<const Square*>(shape);
+    const InfinitePlan* plan = dynamic_cast<const InfinitePlan*>(shape);
+    const Triangle* triangle = dynamic_cast<const Triangle*>(shape);
+
+    if (shape->isAnimated())
+    {
+        prim.type = PRIM_MOVING;
+        prim.index = (unsigned int)movingShapes.size();
+        movingShapes.push_back(shape);
+        movingMaterial.push_back(materialId);
+    }
+    else if (sphere != nullptr && sphere->hasUniformScale())
+    {
+        prim.type = PRIM_SPHERE;
+        prim.index = (unsigned int)sphereShape.size();
+        sphereCenter.push_back(sphere->getCenterWorld());
+        sphereRadius.push_back((float)sphere->getRadiusWorld());
+        sphereShape.push_back(shape);
+        sphereMaterial.push_back(materialId);
+    }
+    else if (square != nullptr)
+    {
+        prim.type = PRIM_SQUARE;
+        prim.index = (unsigned int)squareShape.size();
+        squareCorner.push_back(square->corner);
+        squareV1.push_back(square->v1);
+        squareV2.push_back(square->v2);
+        squareNormal.push_back(square->normal);
+        squareW.push_back(square->w);
+        squareShape.push_back(shape);
+        squareMaterial.push_back(materialId);
+    }
+    else if (plan != nullptr)
+    {
+        prim.type = PRIM_PLAN;
+        prim.index = (unsigned int)planShape.size();
+        planP0.push_back(plan->getPointWorld());
+        planNormal.push_back(plan->getNormalWorld());
+        planShape.push_back(shape);
+        planMaterial.push_back(materialId);
+    }
+    else if (triangle != nullptr)
+    {
+        prim.type = PRIM_TRIANGLE;
+        prim.index = (unsigned int)triangleShape.size();
+        triangleP0.push_back(triangle->p0);
+        triangleE1.push_back(triangle->p1 - triangle->p0);
+        triangleE2.push_back(triangle->p2 - triangle->p0);
+        triangleNormal.push_back(triangle->normal);
+        triangleShape.push_back(shape);
+        triangleMaterial.push_back(materialId);
+    }
+    else
+    {
+        prim.type = PRIM_SHAPE;
+        prim.index = (unsigned int)otherShapes.size();
+        otherShapes.push_back(shape);
+        otherMaterial.push_back(materialId);
+    }
+
+    primitives.push_back(prim);
+}
+
+void PrimitiveStore::update()
+{
+    for (size_t i = 0; i < sphereShape.size(); i++)
+    {
+        const Sphere* sphere = static_cast<const Sphere*>(sphereShape[i]);
+        sphereCenter.set(i, sphere->getCenterWorld());
+        sphereRadius[i] = (float)sphere->getRadiusWorld();
+    }
+
+    for (size_t i = 0; i < triangleShape.size(); i++)
+    {
+        const Triangle* triangle = static_cast<const Triangle*>(triangleShape[i]);
+        triangleP0.set(i, triangle->p0);
+        triangleE1.set(i, triangle->p1 - triangle->p0);
+        triangleE2.set(i, triangle->p2 - triangle->p0);
+        triangleNormal.set(i, triangle->normal);
+    }
+
+    // Squares and infinite plans cannot be moved, and the other shapes are
+    // intersected through their own data
+}
+
+size_t PrimitiveStore::size() const
+{
+    return primitives.size();
+}
+
+const std::vector<PrimitiveRef>& PrimitiveStore::getPrimitives() const
+{
+    return primitives;
+}
+
+const Shape* PrimitiveStore::getShape(const PrimitiveRef &prim) const
+{
+    switch (prim.type)
+    {
+    case PRIM_SPHERE: return sphereShape[prim.index];
+    case PRIM_SQUARE: return squareShape[prim.index];
+    case PRIM_PLAN:   return planShape[prim.index];
+    case PRIM_TRIANGLE: return triangleShape[prim.index];
+    case PRIM_MOVING: return movingShapes[prim.index];
+    default:          return otherShapes[prim.index];
+    }
+}
+
+// Same root selection as Sphere::rayIntersect, but directly in world
+// coordinates
+bool PrimitiveStore::hitSphere(unsigned int i, const Ray &ray, double &tHit) const
+{
+    double ocX = ray.o.x - sphereCenter.x[i];
+    double ocY = ray.o.y - sphereCenter.y[i];
+    double ocZ = ray.o.z - sphereCenter.z[i];
+    double r = sphereRadius[i];
+
+    // A*t^2 + B*t + C = 0
+    double A = ray.d.x*ray.d.x + ray.d.y*ray.d.y + ray.d.z*ray.d.z;
+    double B = 2*(ocX*ray.d.x + ocY*ray.d.y + ocZ*ray.d.z);
+    double C = ocX*ocX + ocY*ocY + ocZ*ocZ - r*r;
+
+    double disc = B*B - 4*A*C;
+    if (disc < 0 || A == 0)
+        return false;
+
+    double sqrtDisc = std::sqrt(disc);
+    double t0 = (-B - sqrtDisc) / (2*A);
+    double t1 = (-B + sqrtDisc) / (2*A);
+
+    if (t0 > ray.maxT || t1 < ray.minT)
+        return false;
+
+    tHit = t0;
+    if (t0 < ray.minT)
+    {
+        tHit = t1;
+        if (tHit > ray.maxT)
+            return false;
+    }
+    return true;
+}
+
+// Same test as Square::rayIntersect
+bool PrimitiveStore::hitSquare(unsigned int i, const Ray &ray, double &tHit) const
+{
+    double nX = squareNormal.x[i], nY = squareNormal.y[i], nZ = squareNormal.z[i];
+
+    double denominator = ray.d.x*nX + ray.d.y*nY + ray.d.z*nZ;
+    if (std::abs(denominator) < Epsilon)
+        return false;
+
+    double cX = squareCorner.x[i], cY = squareCorner.y[i], cZ = squareCorner.z[i];
+    double t = ((cX - ray.o.x)*nX + (cY - ray.o.y)*nY + (cZ - ray.o.z)*nZ) / denominator;
+    if (t < ray.minT || t > ray.maxT)
+        return false;
+
+    // Vector from the corner to the hit point on the plane
+    double pX = ray.o.x + ray.d.x*t - cX;
+    double pY = ray.o.y + ray.d.y*t - cY;
+    double pZ = ray.o.z + ray.d.z*t - cZ;
+
+    double v1X = squareV1.x[i], v1Y = squareV1.y[i], v1Z = squareV1.z[i];
+    double v2X = squareV2.x[i], v2Y = squareV2.y[i], v2Z = squareV2.z[i];
+    double wX = squareW.x[i], wY = squareW.y[i], wZ = squareW.z[i];
+
+    // alpha = w . (p x v2), beta = w . (v1 x p)
+    double alpha = wX*(pY*v2Z - pZ*v2Y) + wY*(pZ*v2X - pX*v2Z) + wZ*(pX*v2Y - pY*v2X);
+    if (!(alpha > 0.0 && alpha < 1.0))
+        return false;
+    double beta = wX*(v1Y*pZ - v1Z*pY) + wY*(v1Z*pX - v1X*pZ) + wZ*(v1X*pY - v1Y*pX);
+    if (!(beta > 0.0 && beta < 1.0))
+        return false;
+
+    tHit = t;
+    return true;
+}
+
+// Same test as InfinitePlan::rayIntersect
+bool PrimitiveStore::hitPlan(unsigned int i, const Ray &ray, double &tHit) const
+{
+    double nX = planNormal.x[i], nY = planNormal.y[i], nZ = planNormal.z[i];
+
+    double denominator = ray.d.x*nX + ray.d.y*nY + ray.d.z*nZ;
+    if (std::abs(denominator) < Epsilon)
+        return false;
+
+    double t = ((planP0.x[i] - ray.o.x)*nX + (planP0.y[i] - ray.o.y)*nY +
+                (planP0.z[i] - ray.o.z)*nZ) / denominator;
+    if (t < ray.minT || t > ray.maxT)
+        return false;
+
+    tHit = t;
+    return true;
+}
+
+// Same test as Triangle::rayIntersect
+bool PrimitiveStore::hitTriangle(unsigned int i, const Ray &ray, double &tHit) const
+{
+    double e1X = triangleE1.x[i], e1Y = triangleE1.y[i], e1Z = triangleE1.z[i];
+    double e2X = triangleE2.x[i], e2Y = triangleE2.y[i], e2Z = triangleE2.z[i];
+
+    // pvec = d x e2
+    double pX = ray.d.y*e2Z - ray.d.z*e2Y;
+    double pY = ray.d.z*e2X - ray.d.x*e2Z;
+    double pZ = ray.d.x*e2Y - ray.d.y*e2X;
+    double det = e1X*pX + e1Y*pY + e1Z*pZ;
+    if (std::abs(det) < 1e-12)
+        return false;
+    double invDet = 1.0 / det;
+
+    double tX = ray.o.x - triangleP0.x[i];
+    double tY = ray.o.y - triangleP0.y[i];
+    double tZ = ray.o.z - triangleP0.z[i];
+    double b1 = (tX*pX + tY*pY + tZ*pZ) * invDet;
+    if (b1 < 0.0 || b1 > 1.0)
+        return false;
+
+    // qvec = tvec x e1
+    double qX = tY*e1Z - tZ*e1Y;
+    double qY = tZ*e1X - tX*e1Z;
+    double qZ = tX*e1Y - tY*e1X;
+    double b2 = (ray.d.x*qX + ray.d.y*qY + ray.d.z*qZ) * invDet;
+    if (b2 < 0.0 || b1 + b2 > 1.0)
+        return false;
+
+    double t = (e2X*qX + e2Y*qY + e2Z*qZ) * invDet;
+    if (t < ray.minT || t > ray.maxT)
+        return false;
+
+    tHit = t;
+    return true;
+}
+
+void PrimitiveStore::fillIntersection(const PrimitiveRef &prim, const Ray &ray,
+                                      double tHit, Intersection &its) const
+{
+    its.itsPoint = ray.o + ray.d * tHit;
+
+    switch (prim.type)
+    {
+    case PRIM_SPHERE:
+        its.normal = (its.itsPoint - sphereCenter[prim.index]).normalized();
+        its.shape = sphereShape[prim.index];
+        its.materialId = sphereMaterial[prim.index];
+        break;
+    case PRIM_SQUARE:
+        its.normal = squareNormal[prim.index];
+        its.shape = squareShape[prim.index];
+        its.materialId = squareMaterial[prim.index];
+        break;
+    case PRIM_PLAN:
+        its.normal = planNormal[prim.index];
+        its.shape = planShape[prim.index];
+        its.materialId = planMaterial[prim.index];
+        break;
+    case PRIM_TRIANGLE:
+        its.normal = triangleNormal[prim.index];
+        its.shape = triangleShape[prim.index];
+        its.materialId = triangleMaterial[prim.index];
+        break;
+    default:
+        break;
+    }
+}
+
+bool PrimitiveStore::rayIntersect(const Ray &ray, Intersection &its) const
+{
+    PrimitiveRef closest = { PRIM_SHAPE, 0 };
+    double tClosest = ray.maxT;
+    bool hasIntersection = false;
+    double tHit;
+
+    for (unsigned int i = 0; i < sphereShape.size(); i++)
+    {
+        if (hitSphere(i, ray, tHit))
+        {
+            ray.maxT = tClosest = tHit;
+            closest = { PRIM_SPHERE, i };
+            hasIntersection = true;
+        }
+    }
+
+    for (unsigned int i = 0; i < squareShape.size(); i++)
+    {
+        if (hitSquare(i, ray, tHit))
+        {
+            ray.maxT = tClosest = tHit;
+            closest = { PRIM_SQUARE, i };
+            hasIntersection = true;
+        }
+    }
+
+    for (unsigned int i = 0; i < planShape.size(); i++)
+    {
+        if (hitPlan(i, ray, tHit))
+        {
+            ray.maxT = tClosest = tHit;
+            closest = { PRIM_PLAN, i };
+            hasIntersection = true;
+        }
+    }
+
+    for (unsigned int i = 0; i < triangleShape.size(); i++)
+    {
+        if (hitTriangle(i, ray, tHit))
+        {
+            ray.maxT = tClosest = tHit;
+            closest = { PRIM_TRIANGLE, i };
+            hasIntersection = true;
+        }
+    }
+
+    // The virtual path fills "its" by itself and shrinks ray.maxT, so any
+    // hit here is closer than the typed one found so far
+    for (size_t i = 0; i < otherShapes.size(); i++)
+    {
+        if (otherShapes[i]->rayIntersect(ray, its))
+        {
+            its.materialId = otherMaterial[i];
+            closest = { PRIM_SHAPE, (unsigned int)i };
+            hasIntersection = true;
+        }
+    }
+
+    for (size_t i = 0; i < movingShapes.size(); i++)
+    {
+        if (movingShapes[i]->rayIntersectMoving(ray, its))
+        {
+            its.materialId = movingMaterial[i];
+            closest = { PRIM_MOVING, (unsigned int)i };
+            hasIntersection = true;
+        }
+    }
+
+    if (hasIntersection && closest.type != PRIM_SHAPE && closest.type != PRIM_MOVING)
+        fillIntersection(closest, ray, tClosest, its);
+
+    return hasIntersection;
+}
+
+bool PrimitiveStore::rayIntersectP(const Ray &ray) const
+{
+    double tHit;
+
+    for (unsigned int i = 0; i < squareShape.size(); i++)
+        if (hitSquare(i, ray, tHit))
+            return true;
+
+    for (unsigned int i = 0; i < sphereShape.size(); i++)
+        if (hitSphere(i, ray, tHit))
+            return true;
+
+    for (unsigned int i = 0; i < planShape.size(); i++)
+        if (hitPlan(i, ray, tHit))
+            return true;
+
+    for (unsigned int i = 0; i < triangleShape.size(); i++)
+        if (hitTriangle(i, ray, tHit))
+            return true;
+
+    for (size_t i = 0; i < otherShapes.size(); i++)
+        if (otherShapes[i]->rayIntersectP(ray))
+            return true;
+
+    for (size_t i = 0; i < movingShapes.size(); i++)
+        if (movingShapes[i]->rayIntersectPMoving(ray))
+            return true;
+
+    return false;
+}
+
+bool PrimitiveStore::rayIntersect(const PrimitiveRef &prim, const Ray &ray, Intersection &its) const
+{
+    double tHit;
+    bool hit;
+
+    switch (prim.type)
+    {
+    case PRIM_SPHERE: hit = hitSphere(prim.index, ray, tHit); break;
+    case PRIM_SQUARE: hit = hitSquare(prim.index, ray, tHit); break;
+    case PRIM_PLAN:   hit = hitPlan(prim.index, ray, tHit); break;
+    case PRIM_TRIANGLE: hit = hitTriangle(prim.index, ray, tHit); break;
+    case PRIM_MOVING:
+        if (!movingShapes[prim.index]->rayIntersectMoving(ray, its))
+            return false;
+        its.materialId = movingMaterial[prim.index];
+        return true;
+    default:
+        if (!otherShapes[prim.index]->rayIntersect(ray, its))
+            return false;
+        its.materialId = otherMaterial[prim.index];
+        return true;
+    }
+
+    if (!hit)
+        return false;
+
+    ray.maxT = tHit;
+    fillIntersection(prim, ray, tHit, its);
+    return true;
+}
+
+bool PrimitiveStore::rayIntersectP(const PrimitiveRef &prim, const Ray &ray) const
+{
+    double tHit;
+
+    switch (prim.type)
+    {
+    case PRIM_SPHERE: return hitSphere(prim.index, ray, tHit);
+    case PRIM_SQUARE: return hitSquare(prim.index, ray, tHit);
+    case PRIM_PLAN:   return hitPlan(prim.index, ray, tHit);
+    case PRIM_TRIANGLE: return hitTriangle(prim.index, ray, tHit);
+    case PRIM_MOVING: return movingShapes[prim.index]->rayIntersectPMoving(ray);
+    default:          return otherShapes[prim.index]->rayIntersectP(ray);
+    }
+}
@@ -0,0 +1,135 @@
+#ifndef PRIMITIVESTORE_H
+#define PRIMITIVESTORE_H
+
+#include <vector>
+
+#include "vector3d.h"
+#include "ray.h"
+#include "intersection.h"
+
+class Shape;
+
+// Kind of primitive referenced by a PrimitiveRef. Shapes which cannot be
+// flattened into one of the typed arrays (e.g., spheres with a non-uniform
+// scale) are kept as PRIM_SHAPE and intersected through the Shape interface.
+// Animated shapes are kept as PRIM_MOVING and intersected at the ray time.
+enum PrimitiveType : unsigned char
+{
+    PRIM_SPHERE,
+    PRIM_SQUARE,
+    PRIM_PLAN,
+    PRIM_TRIANGLE,
+    PRIM_SHAPE,
+    PRIM_MOVING
+};
+
+// Type-tagged index of a primitive inside a PrimitiveStore. This is the
+// handle acceleration structures work with.
+struct PrimitiveRef
+{
+    PrimitiveType type;
+    unsigned int  index;
+};
+
+// Structure-of-arrays storage for a list of Vector3D
+struct Vector3DArray
+{
+    std::vector<float> x, y, z;
+
+    void push_back(const Vector3D &v)
+    {
+        x.push_back(v.x);
+        y.push_back(v.y);
+        z.push_back(v.z);
+    }
+    void set(size_t i, const Vector3D &v)
+    {
+        x[i] = v.x;
+        y[i] = v.y;
+        z[i] = v.z;
+    }
+    Vector3D operator[](size_t i) const { return Vector3D(x[i], y[i], z[i]); }
+    size_t size() const { return x.size(); }
+};
+
+// Scene primitives stored by type in structure-of-arrays form, so that the
+// intersection loops run over contiguous data without virtual calls.
+// All values are in world coordinates.
+class PrimitiveStore
+{
+public:
+    PrimitiveStore();
+
+    // Flatten the shape into the arrays of its type. materialId is the
+    // index of the shape material in the scene material table
+    void add(const Shape *shape, unsigned int materialId);
+
+    // Copy the world data of every shape again after some of them moved
+    // (see Scene::refitBVH). Each shape keeps the type it was added with
+    void update();
+
+    size_t size() const;
+    const std::vector<PrimitiveRef>& getPrimitives() const;
+    const Shape* getShape(const PrimitiveRef &prim) const;
+
+    // Ray/scene intersection methods (linear scan over all primitives)
+    bool rayIntersect(const Ray &ray, Intersection &its) const;
+    bool rayIntersectP(const Ray &ray) const;
+
+    // Ray/primitive intersection methods, used by acceleration structures
+    bool rayIntersect(const PrimitiveRef &prim, const Ray &ray, Intersection &its) const;
+    bool rayIntersectP(const PrimitiveRef &prim, const Ray &ray) const;
+
+private:
+    // Return the hit distance in tHit if the ray segment hits the primitive
+    bool hitSphere(unsigned int i, const Ray &ray, double &tHit) const;
+    bool hitSquare(unsigned int i, const Ray &ray, double &tHit) const;
+    bool hitPlan(unsigned int i, const Ray &ray, double &tHit) const;
+    bool hitTriangle(unsigned int i, const Ray &ray, double &tHit) const;
+
+    // Fill the intersection details of a primitive hit at distance tHit
+    void fillIntersection(const PrimitiveRef &prim, const Ray &ray,
+                          double tHit, Intersection &its) const;
+
+    // Spheres
+    Vector3DArray sphereCenter;
+    std::vector<float> sphereRadius;
+    std::vector<const Shape*> sphereShape;
+    std::vector<unsigned int> sphereMaterial;
+
+    // Squares (see Square for the meaning of each vector)
+    Vector3DArray squareCorner;
+    Vector3DArray squareV1;
+    Vector3DArray squareV2;
+    Vector3DArray squareNormal;
+    Vector3DArray squareW;
+    std::vector<const Shape*> squareShape;
+    std::vector<unsigned int> squareMaterial;
+
+    // Infinite plans
+    Vector3DArray planP0;
+    Vector3DArray planNormal;
+    std::vector<const Shape*> planShape;
+    std::vector<unsigned int> planMaterial;
+
+    // Triangles, as a vertex and the two edges leaving it
+    Vector3DArray triangleP0;
+    Vector3DArray triangleE1;
+    Vector3DArray triangleE2;
+    Vector3DArray triangleNormal;
+    std::vector<const Shape*> triangleShape;
+    std::vector<unsigned int> triangleMaterial;
+
+    // Shapes intersected through their virtual methods
+    std::vector<const Shape*> otherShapes;
+    std::vector<unsigned int> otherMaterial;
+
+    // Animated shapes
+    std::vector<const Shape*> movingShapes;
+    std::vector<unsigned int> movingMaterial;
+
+    // One entry per primitive, in insertion order
+    std::vector<PrimitiveRef> primitives;
+};
+
+#endif // PRIMITIVESTORE_H
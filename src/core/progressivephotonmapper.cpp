@@ -0,0 +1,300 @@
+#include "progressivephotonmapper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <random>
+
+#include "parallel.h"
+#include "photontracer.h"
+#include "utils.h"
+
+#define PI 3.14159265358979323846
+
+// Farthest grid cell from the origin, to keep the cell coordinates of
+// stray photons in the range of an int
+#define MAX_GRID_COORDINATE 1e9
+
+ProgressivePhotonMapper::ProgressivePhotonMapper(const Camera &cam_, const Scene &scene_)
+    : photonsPerIteration(100000), initialRadius(0.1), alpha(0.7), maxDepth(8),
+      maxPhotonDepth(8), bgColor(0.0), seed(0), numThreads(0),
+      cam(cam_), scene(scene_), width(0), height(0), iterations(0), cellSize(1.0)
+{ }
+
+void ProgressivePhotonMapper::reset()
+{
+    std::vector<Pixel> fresh(width * height);
+    pixels.swap(fresh);
+    for (Pixel &pixel : pixels)
+    {
+        pixel.vp.valid = false;
+        pixel.radius = initialRadius;
+        pixel.N = 0.0;
+        pixel.tau = Vector3D(0.0);
+        pixel.Ld = Vector3D(0.0);
+        for (int c = 0; c < 3; c++)
+            pixel.phi[c] = 0.0;
+        pixel.M = 0;
+    }
+    iterations = 0;
+}
+
+void ProgressivePhotonMapper::render(Film &film, int numIterations)
+{
+    if (film.getWidth() != width || film.getHeight() != height || pixels.empty())
+    {
+        width = film.getWidth();
+        height = film.getHeight();
+        reset();
+    }
+
+    for (int i = 0; i < numIterations; i++)
+    {
+        cameraPass();
+        buildGrid();
+        photonPass();
+        updatePixels();
+        iterations++;
+        Utils::printProgress((double)(i + 1) / numIterations);
+    }
+    std::cout << std::endl;
+
+    // Direct light averaged over the iterations, plus the flux of all the
+    // photons emitted over the disk of the pixel
+    double totalPhotons = (double)iterations * photonsPerIteration;
+    for (size_t y = 0; y < height; y++)
+    {
+        for (size_t x = 0; x < width; x++)
+        {
+            const Pixel &pixel = pixels[y * width + x];
+            Vector3D L = pixel.Ld / std::max(iterations, 1);
+            if (totalPhotons > 0.0)
+                L += pixel.tau / (totalPhotons * PI * pixel.radius * pixel.radius);
+            film.setPixelValue(x, y, L);
+        }
+    }
+}
+
+void ProgressivePhotonMapper::cameraPass()
+{
+    parallelFor(height, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++)
+        {
+            std::mt19937 rng((unsigned int)(seed * 0x9e3779b9u + iterations * 0x85ebca6bu + y * 2));
+            std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+            for (size_t x = 0; x < width; x++)
+            {
+                Pixel &pixel = pixels[y * width + x];
+                pixel.vp.valid = false;
+
+                double u = (x + uniform(rng)) / width;
+                double v = (y + uniform(rng)) / height;
+                Ray r = cam.generateRay(u, v);
+                Vector3D beta(1.0);
+
+                // Through mirrors and glass up to the first diffuse or
+                // glossy hit
+                for (int depth = 0; depth <= maxDepth; depth++)
+                {
+                    Intersection its;
+                    if (!Utils::getClosestIntersection(r, scene, its))
+                    {
+                        Vector3D background = scene.environmentLight != nullptr
+                                              ? scene.environmentLight->getRadiance(r.d)
+                                              : bgColor;
+                        pixel.Ld += beta * background;
+                        break;
+                    }
+
+                    const MaterialRecord &material = scene.getMaterial(its);
+                    Vector3D n = its.normal.normalized();
+                    Vector3D wo = (-r.d).normalized();
+
+                    if (material.isEmissive())
+                        pixel.Ld += beta * material.getEmissiveRadiance();
+
+                    if (material.hasDiffuseOrGlossy())
+                    {
+                        Vector3D nf = dot(n, wo) < 0 ? -n : n;
+
+                        // Direct light, with one light sample
+                        double lightPmf;
+                        const LightSource *light = scene.sampleLight(its.itsPoint, nf, uniform(rng), lightPmf);
+                        double u1 = uniform(rng), u2 = uniform(rng);
+                        if (light != nullptr && lightPmf > 0.0)
+                        {
+                            Vector3D lightNormal;
+                            double areaPdf;
+                            Vector3D yl = light->sampleLightPosition(its.itsPoint, u1, u2, lightNormal, areaPdf);
+                            Vector3D L = yl - its.itsPoint;
+                            double distance = L.length();
+                            if (areaPdf > 0.0 && distance > 0.0)
+                            {
+                                Vector3D wi = L / distance;
+
+                                // Point lights have no normal
+                                double cosY = lightNormal.lengthSq() > 0.0 ? dot(lightNormal, -wi) : 1.0;
+                                double G = dot(nf, wi) * cosY / (distance * distance);
+                                Ray shadowRay(its.itsPoint, wi, 0, Epsilon, distance - Epsilon);
+                                if (G > 0.0 && !Utils::hasIntersection(shadowRay, scene))
+                                    pixel.Ld += beta * light->getRadiance(yl, its.itsPoint - yl) *
+                                                material.getReflectance(nf, wo, wi) *
+                                                (G / (lightPmf * areaPdf));
+                            }
+                        }
+
+                        pixel.vp.p = its.itsPoint;
+                        pixel.vp.n = nf;
+                        pixel.vp.wo = wo;
+                        pixel.vp.beta = beta;
+                        pixel.vp.material = &material;
+                        pixel.vp.valid = true;
+                        break;
+                    }
+
+                    Ray next;
+                    if (!Utils::scatterSpecular(material, its.itsPoint, n, r.d, r.depth + 1, r.time, next))
+                        break;
+                    r = next;
+                }
+            }
+        }
+    }, numThreads);
+}
+
+bool ProgressivePhotonMapper::gridCell(const Vector3D &p, int cell[3]) const
+{
+    double coordinates[3] = { (p.x - gridOrigin.x) / cellSize,
+                              (p.y - gridOrigin.y) / cellSize,
+                              (p.z - gridOrigin.z) / cellSize };
+    for (int a = 0; a < 3; a++)
+    {
+        if (!(std::abs(coordinates[a]) < MAX_GRID_COORDINATE))
+            return false;
+        cell[a] = (int)std::floor(coordinates[a]);
+    }
+    return true;
+}
+
+size_t ProgressivePhotonMapper::hashCell(int x, int y, int z) const
+{
+    unsigned int h = ((unsigned int)x * 73856093u) ^ ((unsigned int)y * 19349663u) ^
+                     ((unsigned int)z * 83492791u);
+    return h % (gridStart.size() - 1);
+}
+
+void ProgressivePhotonMapper::buildGrid()
+{
+    // Cells twice as large as the largest radius: each point overlaps at
+    // most 2 x 2 x 2 of them, and a photon only looks into its own cell
+    double maxRadius = 0.0;
+    bool any = false;
+    for (const Pixel &pixel : pixels)
+    {
+        if (!pixel.vp.valid)
+            continue;
+        if (!any)
+            gridOrigin = pixel.vp.p;
+        gridOrigin = Vector3D(std::min(gridOrigin.x, pixel.vp.p.x),
+                              std::min(gridOrigin.y, pixel.vp.p.y),
+                              std::min(gridOrigin.z, pixel.vp.p.z));
+        maxRadius = std::max(maxRadius, pixel.radius);
+        any = true;
+    }
+    cellSize = std::max(2.0 * maxRadius, 1e-6);
+    gridOrigin -= Vector3D(maxRadius);
+
+    // The buckets overlapped by each point, once each
+    std::vector<size_t> pointBuckets(pixels.size() * 8);
+    std::vector<unsigned char> pointBucketCount(pixels.size(), 0);
+    gridStart.assign(pixels.size() + 1, 0);
+    for (size_t i = 0; i < pixels.size(); i++)
+    {
+        const Pixel &pixel = pixels[i];
+        int c0[3], c1[3];
+        if (!pixel.vp.valid ||
+            !gridCell(pixel.vp.p - Vector3D(pixel.radius), c0) ||
+            !gridCell(pixel.vp.p + Vector3D(pixel.radius), c1))
+            continue;
+
+        size_t *buckets = &pointBuckets[i * 8];
+        size_t count = 0;
+        for (int z = c0[2]; z <= c1[2]; z++)
+            for (int y = c0[1]; y <= c1[1]; y++)
+                for (int x = c0[0]; x <= c1[0]; x++)
+                    if (count < 8)
+                        buckets[count++] = hashCell(x, y, z);
+        std::sort(buckets, buckets + count);
+        count = std::unique(buckets, buckets + count) - buckets;
+        pointBucketCount[i] = (unsigned char)count;
+
+        for (size_t k = 0; k < count; k++)
+            gridStart[buckets[k] + 1]++;
+    }
+
+    // Counting sort of the points by bucket
+    for (size_t b = 1; b < gridStart.size(); b++)
+        gridStart[b] += gridStart[b - 1];
+    gridPoints.resize(gridStart.back());
+    std::vector<unsigned int> fill(gridStart.begin(), gridStart.end() - 1);
+    for (size_t i = 0; i < pixels.size(); i++)
+        for (size_t k = 0; k < pointBucketCount[i]; k++)
+            gridPoints[fill[pointBuckets[i * 8 + k]]++] = (unsigned int)i;
+}
+
+void ProgressivePhotonMapper::photonPass()
+{
+    unsigned int passSeed = seed * 0x9e3779b9u + iterations * 0x85ebca6bu + 1;
+
+    tracePhotons(scene, photonsPerIteration, passSeed, maxPhotonDepth, numThreads,
+        [&](size_t, int bounce, const Photon &photon, bool) {
+            // Splat into the visible points around, except on the first
+            // hit: the direct light is sampled by the camera pass
+            int cell[3];
+            if (bounce == 0 || !gridCell(photon.position, cell))
+                return true;
+
+            size_t bucket = hashCell(cell[0], cell[1], cell[2]);
+            for (unsigned int k = gridStart[bucket]; k < gridStart[bucket + 1]; k++)
+            {
+                Pixel &pixel = pixels[gridPoints[k]];
+                Vector3D wi = -photon.direction;
+                if ((pixel.vp.p - photon.position).lengthSq() > pixel.radius * pixel.radius ||
+                    dot(pixel.vp.n, wi) <= 0.0)
+                    continue;
+
+                Vector3D phi = photon.power * pixel.vp.material->getReflectance(pixel.vp.n, pixel.vp.wo, wi);
+                atomicAdd(pixel.phi[0], phi.x);
+                atomicAdd(pixel.phi[1], phi.y);
+                atomicAdd(pixel.phi[2], phi.z);
+                pixel.M.fetch_add(1, std::memory_order_relaxed);
+            }
+            return true;
+        });
+}
+
+void ProgressivePhotonMapper::updatePixels()
+{
+    for (Pixel &pixel : pixels)
+    {
+        int M = pixel.M.load();
+        if (M > 0)
+        {
+            // Keep a fraction alpha of the new photons, in a smaller disk
+            // whose flux is scaled by its area
+            double N = pixel.N + alpha * M;
+            double radius = pixel.radius * std::sqrt(N / (pixel.N + M));
+            Vector3D phi(pixel.phi[0], pixel.phi[1], pixel.phi[2]);
+            pixel.tau = (pixel.tau + pixel.vp.beta * phi) *
+                        ((radius * radius) / (pixel.radius * pixel.radius));
+            pixel.N = N;
+            pixel.radius = radius;
+
+            for (int c = 0; c < 3; c++)
+                pixel.phi[c] = 0.0;
+            pixel.M = 0;
+        }
+        pixel.vp.valid = false;
+    }
+}
@@ -0,0 +1,96 @@
+#ifndef PROGRESSIVEPHOTONMAPPER_H
+#define PROGRESSIVEPHOTONMAPPER_H
+
+#include <atomic>
+#include <vector>
+
+#include "film.h"
+#include "scene.h"
+#include "../cameras/camera.h"
+
+// Stochastic progressive photon mapping (Hachisuka and Jensen 2009). Each
+// iteration traces one camera path per pixel, through mirrors and glass up
+// to its first diffuse or glossy hit (the visible point, where the direct
+// light is sampled), and then a pass of photons. The photons are not
+// stored: each one adds its power to the visible points within their
+// radius as soon as it lands, found through a hashed grid of the visible
+// points. After the pass, every pixel shrinks its radius (by alpha) and
+// keeps the flux gathered so far, so that the image converges to the right
+// one, caustics included, as iterations are added. The memory only depends
+// on the number of pixels, whatever the total number of photons.
+// The camera and photon passes run on numThreads threads, each row of
+// pixels and block of photons with its own random sequence.
+class ProgressivePhotonMapper
+{
+public:
+    ProgressivePhotonMapper() = delete;
+    ProgressivePhotonMapper(const Camera &cam_, const Scene &scene_);
+
+    // Run numIterations more iterations and write the image of all the
+    // iterations so far to the film. The pixels keep their statistics from
+    // one call to the next, until reset or a film of another size
+    void render(Film &film, int numIterations);
+
+    // Start again from the first iteration
+    void reset();
+
+    int getIterationCount() const { return iterations; }
+
+    // Settings
+    size_t photonsPerIteration;
+    double initialRadius;       // In scene units
+    double alpha;               // Fraction of the new photons kept (0, 1)
+    int maxDepth;               // Specular bounces of the camera paths
+    int maxPhotonDepth;         // Bounces of a photon at most
+    Vector3D bgColor;           // Without an environment light
+    unsigned int seed;
+    unsigned int numThreads;    // 0 = all the hardware threads
+
+private:
+    // Where the camera path of a pixel reached a diffuse surface in the
+    // current iteration (valid = false if it did not)
+    struct VisiblePoint
+    {
+        Vector3D p;
+        Vector3D n;
+        Vector3D wo;
+        Vector3D beta;          // Throughput of the camera path
+        const MaterialRecord *material;
+        bool valid;
+    };
+
+    struct Pixel
+    {
+        VisiblePoint vp;
+        double radius;
+        double N;               // Photons kept so far
+        Vector3D tau;           // Flux kept so far (over the current radius)
+        Vector3D Ld;            // Sum of the emitted and direct light seen
+        double phi[3];                  // Flux of the current photon pass (atomicAdd)
+        std::atomic<int> M;             // Photons of the current pass
+    };
+
+    void cameraPass();
+    void buildGrid();
+    void photonPass();
+    void updatePixels();
+
+    bool gridCell(const Vector3D &p, int cell[3]) const;
+    size_t hashCell(int x, int y, int z) const;
+
+    const Camera &cam;
+    const Scene &scene;
+
+    size_t width, height;
+    std::vector<Pixel> pixels;
+    int iterations;
+
+    // Hashed grid of the visible points: the points overlapping the cells
+    // of bucket b are gridPoints[gridStart[b]] .. gridPoints[gridStart[b + 1] - 1]
+    Vector3D gridOrigin;
+    double cellSize;
+    std::vector<unsigned int> gridStart;
+    std::vector<unsigned int> gridPoints;
+};
+
+#endif // PROGRESSIVEPHOTONMAPPER_H
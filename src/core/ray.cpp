@@ -1,11 +1,11 @@
 #include "ray.h"
 
-Ray::Ray() : minT(0.001), maxT(INFINITY), depth(0)
+Ray::Ray() : minT(0.001), maxT(INFINITY), depth(0), time(0.0)
 {}
 
 Ray::Ray(const Vector3D &ori, const Vector3D &dir, size_t dep, double start,
-         double end)
-         : o(ori), d(dir), minT(start), maxT(end), depth(dep)
+         double end, double t)
+         : o(ori), d(dir), minT(start), maxT(end), depth(dep), time(t)
 {}
 
 std::string Ray::toString() const
@@ -14,6 +14,7 @@ std::string Ray::toString() const
     out << "origin: " << o << std::endl;
     out << "direction: " << d << std::endl;
     out << "minT = " << minT << ", maxT = " << maxT << std::endl;
+    out << "time = " << time << std::endl;
     return out.str();
 }
 
@@ -4,6 +4,9 @@
 #include <string>
 #include <sstream>
 
+#define _USE_MATH_DEFINES
+#include <cmath>
+
 #include "vector3d.h"
 
 #define Epsilon (double)1e-4
@@ -19,7 +22,7 @@ public:
     Ray();
     Ray(const Vector3D &ori, const Vector3D &dir,
         size_t dep = 0, double start = Epsilon,
-        double end = INFINITY);
+        double end = INFINITY, double t = 0.0);
     // Member functions
     std::string toString() const;
 
@@ -29,6 +32,7 @@ public:
     mutable double minT; //
     mutable double maxT; //
     size_t depth;        // Ray depth (or number of bounces)
+    double time;         // Instant of the shutter interval the ray travels at
 
     //FILL(..) Extra data for Path Tracing
 
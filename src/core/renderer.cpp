@@ -0,0 +1,297 @@
+#include "renderer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include "utils.h"
+
+Renderer::Renderer(const Camera &cam_, const Shader &shader_, const Scene &scene_)
+    : tileSize(32), sortByMaterial(false), checkpointInterval(300.0),
+      cam(cam_), shader(shader_), scene(scene_)
+{ }
+
+void Renderer::addLayers(Film &film)
+{
+    film.addLayer("albedo", "RGB");
+    film.addLayer("normal", "XYZ");
+    film.addLayer("depth", "Z");
+    film.addLayer("direct", "RGB");
+    film.addLayer("indirect", "RGB");
+    film.addLayer("samples", "Y");
+    film.addLayer("variance", "RGB");
+}
+
+void Renderer::render(Film &film, int spp, ImageWriter *writer) const
+{
+    size_t resX = film.getWidth();
+    size_t resY = film.getHeight();
+
+    for (size_t y0 = 0; y0 < resY; y0 += tileSize)
+    {
+        Utils::printProgress((double)y0 / (double)resY);
+
+        for (size_t x0 = 0; x0 < resX; x0 += tileSize)
+        {
+            size_t x1 = std::min(x0 + tileSize, resX);
+            size_t y1 = std::min(y0 + tileSize, resY);
+            renderTile(film, x0, y0, x1, y1, spp);
+            if (writer != nullptr)
+                writer->regionDone(x0, y0, x1, y1);
+        }
+    }
+    Utils::printProgress(1.0);
+}
+
+void Renderer::renderPasses(Accumulator &accumulator, int numPasses, int sppPerPass) const
+{
+    Film pass(accumulator.getWidth(), accumulator.getHeight());
+
+    auto lastCheckpoint = std::chrono::steady_clock::now();
+    for (int p = 0; p < numPasses; p++)
+    {
+        Utils::printProgress((double)p / (double)numPasses);
+
+        renderPass(pass, sppPerPass, accumulator.getPassSeed(accumulator.getPassCount()));
+        accumulator.addPass(pass, sppPerPass);
+
+        auto now = std::chrono::steady_clock::now();
+        bool last = p == numPasses - 1;
+        if (!checkpointFile.empty() &&
+            (last || std::chrono::duration<double>(now - lastCheckpoint).count() >= checkpointInterval))
+        {
+            if (!accumulator.save(checkpointFile))
+                std::cout << "Renderer: could not write the checkpoint \"" << checkpointFile << "\"" << std::endl;
+            lastCheckpoint = now;
+        }
+    }
+    Utils::printProgress(1.0);
+}
+
+void Renderer::renderPass(Film &film, int spp, unsigned int passSeed) const
+{
+    size_t resX = film.getWidth();
+    size_t resY = film.getHeight();
+
+    srand(passSeed);
+    for (size_t y0 = 0; y0 < resY; y0 += tileSize)
+    {
+        for (size_t x0 = 0; x0 < resX; x0 += tileSize)
+        {
+            size_t x1 = std::min(x0 + tileSize, resX);
+            size_t y1 = std::min(y0 + tileSize, resY);
+            renderTile(film, x0, y0, x1, y1, spp);
+        }
+    }
+}
+
+void Renderer::renderTile(Film &film, size_t x0, size_t y0, size_t x1, size_t y1,
+                          int spp) const
+{
+    size_t resX = film.getWidth();
+    size_t resY = film.getHeight();
+    size_t tileWidth = x1 - x0;
+    size_t tilePixels = tileWidth * (y1 - y0);
+
+    LayerIndices layer;
+    layer.albedo = film.getLayerIndex("albedo");
+    layer.normal = film.getLayerIndex("normal");
+    layer.depth = film.getLayerIndex("depth");
+    layer.direct = film.getLayerIndex("direct");
+    layer.indirect = film.getLayerIndex("indirect");
+    layer.samples = film.getLayerIndex("samples");
+    layer.variance = film.getLayerIndex("variance");
+
+    bool writeFeatures = layer.albedo >= 0 || layer.normal >= 0 || layer.depth >= 0;
+    bool writeSplit = layer.direct >= 0 || layer.indirect >= 0;
+    bool writeVariance = layer.variance >= 0;
+
+    // Sums over the samples of each pixel. The colors of one pass are kept
+    // apart to accumulate their squares for the variance
+    std::vector<Vector3D> tileColor(tilePixels, Vector3D(0.0));
+    std::vector<Vector3D> passColor(tilePixels, Vector3D(0.0));
+    std::vector<Vector3D> tileColorSq, tileAlbedo, tileNormal, tileDepth, tileDirect, tileIndirect;
+    if (writeVariance)
+        tileColorSq.assign(tilePixels, Vector3D(0.0));
+    if (writeFeatures)
+    {
+        tileAlbedo.assign(tilePixels, Vector3D(0.0));
+        tileNormal.assign(tilePixels, Vector3D(0.0));
+        tileDepth.assign(tilePixels, Vector3D(0.0));
+    }
+    if (writeSplit)
+    {
+        tileDirect.assign(tilePixels, Vector3D(0.0));
+        tileIndirect.assign(tilePixels, Vector3D(0.0));
+    }
+
+    std::vector<HitRecord> hits;
+    hits.reserve(tilePixels);
+
+    for (int s = 0; s < spp; s++)
+    {
+        // Trace the wavefront: one camera ray per pixel of the tile
+        hits.clear();
+        std::fill(passColor.begin(), passColor.end(), Vector3D(0.0));
+        for (size_t lin = y0; lin < y1; lin++)
+        {
+            for (size_t col = x0; col < x1; col++)
+            {
+                double x = (double)(col + 0.5) / resX;
+                double y = (double)(lin + 0.5) / resY;
+                unsigned int pixel = (unsigned int)((lin - y0) * tileWidth + (col - x0));
+
+                // Random lens and shutter samples (ignored by a pinhole,
+                // static camera)
+                double lensU = (double)std::rand() / RAND_MAX;
+                double lensV = (double)std::rand() / RAND_MAX;
+                double time = (double)std::rand() / RAND_MAX;
+
+                HitRecord hit;
+                hit.ray = cam.generateRay(x, y, lensU, lensV, time);
+                hit.pixel = pixel;
+
+                // Intersect a copy so that the stored ray keeps its maxT
+                Ray query = hit.ray;
+                bool hasHit = Utils::getClosestIntersection(query, scene, hit.its);
+                if (hasHit)
+                {
+                    hits.push_back(hit);
+                }
+                else
+                {
+                    Vector3D background = shader.getBackground(hit.ray, scene);
+                    passColor[pixel] += background;
+                    if (writeSplit)
+                        tileDirect[pixel] += background;
+                }
+
+                if (writeFeatures)
+                {
+                    if (hasHit)
+                    {
+                        const MaterialRecord &material = scene.getMaterial(hit.its);
+                        tileAlbedo[pixel] += material.hasDiffuseOrGlossy() ?
+                                             material.getDiffuseReflectance() : Vector3D(1.0);
+                        tileNormal[pixel] += hit.its.normal.normalized();
+                        tileDepth[pixel] += Vector3D((hit.its.itsPoint - hit.ray.o).length());
+                    }
+                    else
+                    {
+                        tileAlbedo[pixel] += Vector3D(1.0);
+                    }
+                }
+            }
+        }
+
+        if (sortByMaterial)
+            shadeSorted(hits, passColor, tileDirect, tileIndirect);
+        else
+            shadeInOrder(hits, passColor, tileDirect, tileIndirect);
+
+        for (size_t pixel = 0; pixel < tilePixels; pixel++)
+        {
+            tileColor[pixel] += passColor[pixel];
+            if (writeVariance)
+                tileColorSq[pixel] += passColor[pixel] * passColor[pixel];
+        }
+    }
+
+    // Store the averaged pixel values
+    for (size_t lin = y0; lin < y1; lin++)
+    {
+        for (size_t col = x0; col < x1; col++)
+        {
+            size_t pixel = (lin - y0) * tileWidth + (col - x0);
+            Vector3D pixelColor = tileColor[pixel] / (double)spp;
+            film.setPixelValue(col, lin, pixelColor);
+
+            if (layer.albedo >= 0)
+                film.setLayerValue(layer.albedo, col, lin, tileAlbedo[pixel] / (double)spp);
+            if (layer.normal >= 0)
+                film.setLayerValue(layer.normal, col, lin, tileNormal[pixel] / (double)spp);
+            if (layer.depth >= 0)
+                film.setLayerValue(layer.depth, col, lin, tileDepth[pixel] / (double)spp);
+            if (layer.direct >= 0)
+                film.setLayerValue(layer.direct, col, lin, tileDirect[pixel] / (double)spp);
+            if (layer.indirect >= 0)
+                film.setLayerValue(layer.indirect, col, lin, tileIndirect[pixel] / (double)spp);
+            if (layer.samples >= 0)
+                film.setLayerValue(layer.samples, col, lin, Vector3D((double)spp));
+            if (writeVariance)
+            {
+                // Unbiased sample variance of the spp values
+                Vector3D variance(0.0);
+                if (spp > 1)
+                {
+                    variance = (tileColorSq[pixel] - pixelColor * pixelColor * (double)spp) /
+                               (double)(spp - 1);
+                    variance = Vector3D(std::max(0.0, (double)variance.x),
+                                        std::max(0.0, (double)variance.y),
+                                        std::max(0.0, (double)variance.z));
+                }
+                film.setLayerValue(layer.variance, col, lin, variance);
+            }
+        }
+    }
+}
+
+void Renderer::shadeOne(const HitRecord &hit, const MaterialRecord &material,
+                        std::vector<Vector3D> &tileColor,
+                        std::vector<Vector3D> &tileDirect,
+                        std::vector<Vector3D> &tileIndirect) const
+{
+    if (tileDirect.empty())
+    {
+        tileColor[hit.pixel] += shader.shadeHit(hit.ray, hit.its, material, scene);
+        return;
+    }
+
+    Vector3D direct, indirect;
+    tileColor[hit.pixel] += shader.shadeHitSplit(hit.ray, hit.its, material, scene,
+                                                 direct, indirect);
+    tileDirect[hit.pixel] += direct;
+    tileIndirect[hit.pixel] += indirect;
+}
+
+void Renderer::shadeInOrder(const std::vector<HitRecord> &hits,
+                            std::vector<Vector3D> &tileColor,
+                            std::vector<Vector3D> &tileDirect,
+                            std::vector<Vector3D> &tileIndirect) const
+{
+    for (const HitRecord &hit : hits)
+        shadeOne(hit, scene.getMaterial(hit.its), tileColor, tileDirect, tileIndirect);
+}
+
+void Renderer::shadeSorted(const std::vector<HitRecord> &hits,
+                           std::vector<Vector3D> &tileColor,
+                           std::vector<Vector3D> &tileDirect,
+                           std::vector<Vector3D> &tileIndirect) const
+{
+    // Counting sort of the hits by material id
+    size_t numMaterials = scene.materials.size();
+    std::vector<unsigned int> batchStart(numMaterials + 1, 0);
+    for (const HitRecord &hit : hits)
+        batchStart[hit.its.materialId + 1]++;
+    for (size_t m = 0; m < numMaterials; m++)
+        batchStart[m + 1] += batchStart[m];
+
+    std::vector<unsigned int> order(hits.size());
+    std::vector<unsigned int> next(batchStart.begin(), batchStart.end() - 1);
+    for (unsigned int i = 0; i < hits.size(); i++)
+        order[next[hits[i].its.materialId]++] = i;
+
+    // Shade every batch with a local copy of its material
+    for (size_t m = 0; m < numMaterials; m++)
+    {
+        if (batchStart[m] == batchStart[m + 1])
+            continue;
+
+        const MaterialRecord material = scene.materials[m];
+        for (unsigned int k = batchStart[m]; k < batchStart[m + 1]; k++)
+        {
+            shadeOne(hits[order[k]], material, tileColor, tileDirect, tileIndirect);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <string>
+#include <vector>
+
+#include "accumulator.h"
+#include "film.h"
+#include "imagewriter.h"
+#include "scene.h"
+#include "intersection.h"
+#include "../cameras/camera.h"
+#include "../shaders/shader.h"
+
+// Tile based render loop. Every tile is traced as a wavefront of camera rays
+// (one ray per pixel and sample pass). With sortByMaterial enabled, the hits
+// of each wavefront are grouped by material id and every group is shaded in
+// a single loop over the same MaterialRecord.
+//
+// The layers (AOVs) which the film has among the ones below are filled in
+// the same pass as the image, and written with it by Film::saveEXR:
+//   "albedo"    Diffuse reflectance of the first hit (1 for mirrors, glass
+//               and misses), e.g., for the Denoiser
+//   "normal"    World space normal of the first hit (0 for misses)
+//   "depth"     Distance along the camera ray to the first hit (0 for misses)
+//   "direct"    Emission and direct lighting of the first hit
+//   "indirect"  The rest of the image (see Shader::shadeHitSplit)
+//   "samples"   Number of samples of the pixel
+//   "variance"  Sample variance of the radiance samples of the pixel, per
+//               color channel (divided by "samples", that of the pixel value)
+class Renderer
+{
+public:
+    Renderer() = delete;
+    Renderer(const Camera &cam_, const Shader &shader_, const Scene &scene_);
+
+    // Render spp samples per pixel over the whole film. With an open
+    // writer, every tile is handed to it as soon as it is done
+    void render(Film &film, int spp, ImageWriter *writer = nullptr) const;
+
+    // Add numPasses passes of sppPerPass samples per pixel to the
+    // accumulator. Each pass seeds rand() from the seed of the accumulator
+    // and its own index, so that a render resumed from a checkpoint gives
+    // the same image as one which never stopped. With a checkpointFile, the
+    // accumulator is saved to it every checkpointInterval seconds and at
+    // the end
+    void renderPasses(Accumulator &accumulator, int numPasses, int sppPerPass) const;
+
+    // Render spp samples per pixel over the whole film, quietly, after
+    // seeding rand() with passSeed (see Accumulator::getPassSeed)
+    void renderPass(Film &film, int spp, unsigned int passSeed) const;
+
+    // Render the pixels [x0, x1) x [y0, y1) of the film
+    void renderTile(Film &film, size_t x0, size_t y0, size_t x1, size_t y1,
+                    int spp) const;
+
+    // Add all the layers above to the film
+    static void addLayers(Film &film);
+
+    // Settings
+    size_t tileSize;
+    bool sortByMaterial;
+    std::string checkpointFile;     // Empty = no checkpoints
+    double checkpointInterval;      // In seconds
+
+private:
+    // Camera ray which hit the scene, waiting to be shaded
+    struct HitRecord
+    {
+        Ray ray;
+        Intersection its;
+        unsigned int pixel; // Index inside the tile
+    };
+
+    // Layer indices of the film, -1 for the missing ones
+    struct LayerIndices
+    {
+        int albedo, normal, depth, direct, indirect, samples, variance;
+    };
+
+    // Add the color of every hit to its pixel; the direct and indirect
+    // parts are only computed if those vectors are not empty
+    void shadeInOrder(const std::vector<HitRecord> &hits,
+                      std::vector<Vector3D> &tileColor,
+                      std::vector<Vector3D> &tileDirect,
+                      std::vector<Vector3D> &tileIndirect) const;
+    void shadeSorted(const std::vector<HitRecord> &hits,
+                     std::vector<Vector3D> &tileColor,
+                     std::vector<Vector3D> &tileDirect,
+                     std::vector<Vector3D> &tileIndirect) const;
+    void shadeOne(const HitRecord &hit, const MaterialRecord &material,
+                  std::vector<Vector3D> &tileColor,
+                  std::vector<Vector3D> &tileDirect,
+                  std::vector<Vector3D> &tileIndirect) const;
+
+    const Camera &cam;
+    const Shader &shader;
+    const Scene &scene;
+};
+
+#endif // RENDERER_H
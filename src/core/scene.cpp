@@ -1,23 +1,163 @@
 #include "scene.h"
 #include "../lightsources/arealightsource.h"
+#include "../lightsources/spherelightsource.h"
+#include "../lightsources/meshlightsource.h"
+#include "../shapes/square.h"
+#include "../shapes/sphere.h"
+#include <iostream>
 
 Scene::Scene()
 {
 	objectsList = new std::vector<Shape*>;
 	LightSourceList = new std::vector<LightSource*>;
+	environmentLight = nullptr;
+	lightSelection = LIGHT_SELECTION_POWER;
 
 }
 
 void Scene::AddObject(Shape* new_object)
+{
+	addShape(new_object);
+	if (!new_object->getMaterial().isEmissive())
+		return;
+
+	// Each emitter shape gets the light with the best sampling for it
+	Square* square = dynamic_cast<Square*>(new_object);
+	Sphere* sphere = dynamic_cast<Sphere*>(new_object);
+	Triangle* triangle = dynamic_cast<Triangle*>(new_object);
+
+	if (square != nullptr)
+		addLight(new AreaLightSource(square));
+	else if (sphere != nullptr && sphere->hasUniformScale())
+		addLight(new SphereLightSource(sphere));
+	else if (triangle != nullptr)
+		addLight(new MeshLightSource(std::vector<Triangle*>(1, triangle)));
+	else
+	{
+		std::cerr << "Scene::AddObject: this emissive shape cannot be sampled as a light, "
+		          << "it will only be seen by the rays which hit it" << std::endl;
+		return;
+	}
+	lightIds[new_object] = (int)LightSourceList->size() - 1;
+}
+
+void Scene::AddMesh(TriangleMesh* new_mesh)
+{
+	for (Triangle* triangle : new_mesh->getTriangles())
+		addShape(triangle);
+
+	if (new_mesh->getMaterial().isEmissive() && !new_mesh->getTriangles().empty())
+	{
+		addLight(new MeshLightSource(new_mesh->getTriangles()));
+		for (Triangle* triangle : new_mesh->getTriangles())
+			lightIds[triangle] = (int)LightSourceList->size() - 1;
+	}
+}
+
+void Scene::addShape(Shape* new_object)
 {
 	objectsList->push_back(new_object);
-	if (new_object->getMaterial().isEmissive())
-		LightSourceList->push_back(new AreaLightSource(dynamic_cast<Square*>(new_object)));
+	primitives.add(new_object, registerMaterial(&new_object->getMaterial()));
+	bvh.clear();
+}
+
+void Scene::addLight(LightSource* new_light)
+{
+	LightSourceList->push_back(new_light);
+	lightSampler.invalidate(*LightSourceList);
+	lightBVH.clear();
+}
+
+int Scene::getLightIndex(const Shape* shape) const
+{
+	auto found = lightIds.find(shape);
+	return found != lightIds.end() ? found->second : -1;
+}
+
+unsigned int Scene::registerMaterial(const Material* material)
+{
+	auto found = materialIds.find(material);
+	if (found != materialIds.end())
+		return found->second;
+
+	unsigned int id = (unsigned int)materials.size();
+	materials.push_back(material->getRecord());
+	materialIds[material] = id;
+	return id;
+}
+
+void Scene::buildBVH()
+{
+	bvh.build(primitives);
+	buildLightStructures();
+}
+
+void Scene::refitBVH()
+{
+	primitives.update();
+	if (bvh.isBuilt())
+		bvh.refit();
+	else
+		bvh.build(primitives);
 
-}	
+	for (LightSource* light : *LightSourceList)
+		light->update();
+	buildLightStructures();
+}
+
+void Scene::buildLightStructures()
+{
+	// The environment surrounds the bounded geometry, and its power
+	// depends on the size of the scene
+	if (environmentLight != nullptr)
+	{
+		BoundingBox bounds;
+		for (const PrimitiveRef& prim : primitives.getPrimitives())
+		{
+			BoundingBox b = primitives.getShape(prim)->getBounds();
+			if (b.isBounded())
+				bounds.expand(b);
+		}
+		if (bounds.isEmpty())
+			environmentLight->setSceneBounds(Vector3D(0.0), 1.0);
+		else
+			environmentLight->setSceneBounds(bounds.centroid(), (bounds.pMax - bounds.pMin).length() / 2.0);
+	}
+
+	lightSampler.build(*LightSourceList);
+	lightBVH.build(*LightSourceList);
+}
+
+const LightSource* Scene::sampleLight(const Vector3D& x, const Vector3D& n,
+	double u, double& pmf) const
+{
+	if (lightSelection == LIGHT_SELECTION_BVH && lightBVH.isBuilt())
+		return lightBVH.sample(x, n, u, pmf);
+	return lightSampler.sample(u, pmf);
+}
+
+bool Scene::rayIntersect(const Ray& ray, Intersection& its) const
+{
+	if (bvh.isBuilt())
+		return bvh.rayIntersect(ray, its);
+	return primitives.rayIntersect(ray, its);
+}
+
+bool Scene::rayIntersectP(const Ray& ray) const
+{
+	if (bvh.isBuilt())
+		return bvh.rayIntersectP(ray);
+	return primitives.rayIntersectP(ray);
+}
 
 void Scene::AddPointLight(PointLightSource* new_pointLight)
 {
-	LightSourceList->push_back(new_pointLight);
+	addLight(new_pointLight);
+}
+
+void Scene::AddEnvironmentLight(EnvironmentLight* new_environmentLight)
+{
+	environmentLight = new_environmentLight;
+	addLight(new_environmentLight);
 }
 
@@ -4,10 +4,25 @@
 #include "vector3d.h"
 #include <stdlib.h> /* srand, rand */
 #include <vector>
+#include <map>
 #include "../lightsources/pointlightsource.h"
 #include "../shapes/shape.h"
+#include "../shapes/trianglemesh.h"
+#include "primitivestore.h"
+#include "bvh.h"
+#include "../materials/materialrecord.h"
+#include "../lightsources/lightsampler.h"
+#include "../lightsources/lightbvh.h"
+#include "../lightsources/environmentlight.h"
 
 
+// How the shaders choose the light to sample at a shading point
+enum LightSelection
+{
+    LIGHT_SELECTION_POWER,  // Proportionally to the light power (alias table)
+    LIGHT_SELECTION_BVH     // By estimated contribution, with the light BVH
+};
+
 // Class used to store information regarding the
 // intersection point.
 // Based on PBRT (Chapter 2)
@@ -16,13 +31,85 @@ class Scene
 public:
     Scene();
 
+    // Emissive squares, spheres and triangles are also added as lights
     void AddObject(Shape* new_object);
+
+    // Add every triangle of the mesh, and the mesh as a single light if its
+    // material is emissive
+    void AddMesh(TriangleMesh* new_mesh);
     
     void AddPointLight(PointLightSource* new_pointLight);
+
+    // Light seen by the rays which leave the scene (only one). It is also
+    // sampled like the other lights
+    void AddEnvironmentLight(EnvironmentLight* new_environmentLight);
                                  
     // Declare pointers to all the variables which describe the scene
     std::vector<Shape*>* objectsList;
     std::vector<LightSource*>* LightSourceList;
+    EnvironmentLight* environmentLight;
+
+    // Chooses lights of LightSourceList proportionally to their power. It
+    // follows the lights added, at any time
+    LightSampler lightSampler;
+
+    // Light selection used by sampleLight. The light BVH is built by
+    // buildBVH; until then (and after a light is added) the power based
+    // selection is used
+    LightSelection lightSelection;
+
+    // Choose a light to sample from the point x with normal n, with the
+    // random number u in [0,1]. Returns its probability in pmf, or nullptr
+    // if there is no light to sample
+    const LightSource* sampleLight(const Vector3D &x, const Vector3D &n,
+                                   double u, double &pmf) const;
+
+    // Flattened copy of objectsList used for the intersection queries
+    PrimitiveStore primitives;
+
+    // Build the acceleration structures (objects and lights) once all the
+    // objects are added. Adding an object afterwards discards them (the
+    // queries go back to a linear scan until they are built again)
+    void buildBVH();
+
+    // Update the acceleration structures after shapes were moved in place
+    // (Sphere::setObjectToWorld, TriangleMesh::setObjectToWorld), e.g.,
+    // between the frames of an Animation: the primitives are copied again
+    // and the BVH is refitted rather than rebuilt. Builds it if needed
+    void refitBVH();
+
+    // Closest hit / any hit along the ray segment, at ray.time
+    bool rayIntersect(const Ray &ray, Intersection &its) const;
+    bool rayIntersectP(const Ray &ray) const;
+
+    // Flat copies of the materials of objectsList, indexed by
+    // Intersection::materialId
+    std::vector<MaterialRecord> materials;
+
+    const MaterialRecord& getMaterial(const Intersection &its) const
+    {
+        return materials[its.materialId];
+    }
+
+    // Index in LightSourceList of the light made from an emissive shape
+    // (-1 if the shape is not part of a light)
+    int getLightIndex(const Shape *shape) const;
+
+private:
+    void addShape(Shape *new_object);
+    void addLight(LightSource *new_light);
+
+    // Light sampler, light BVH and the scene bounds of the environment
+    void buildLightStructures();
+
+    // Add the material to the material table (once) and return its index
+    unsigned int registerMaterial(const Material *material);
+
+    std::map<const Material*, unsigned int> materialIds;
+    std::map<const Shape*, int> lightIds;
+
+    BVH bvh;
+    LightBVH lightBVH;
 };
 
 #endif 
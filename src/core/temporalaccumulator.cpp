@@ -0,0 +1,124 @@
+#include "temporalaccumulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+#include "parallel.h"
+
+TemporalAccumulator::TemporalAccumulator()
+    : maxHistory(16), depthTolerance(0.05), normalTolerance(0.9), numThreads(0),
+      width(0), height(0), corner0(0.0), corner1(0.0)
+{ }
+
+void TemporalAccumulator::reset()
+{
+    color.clear();
+    depth.clear();
+    normal.clear();
+    history.clear();
+    width = height = 0;
+}
+
+void TemporalAccumulator::accumulate(Film &film, const Camera &cam)
+{
+    int depthLayer = film.getLayerIndex("depth");
+    int normalLayer = film.getLayerIndex("normal");
+    if (depthLayer < 0 || normalLayer < 0)
+    {
+        std::cout << "TemporalAccumulator: the film has no \"depth\" and \"normal\" layers" << std::endl;
+        return;
+    }
+
+    const size_t W = film.getWidth();
+    const size_t H = film.getHeight();
+    Vector3D newCorner0 = cam.ndcToCameraSpace(0.0, 0.0);
+    Vector3D newCorner1 = cam.ndcToCameraSpace(1.0, 1.0);
+    bool hasHistory = !color.empty() && W == width && H == height &&
+                      (newCorner0 - corner0).lengthSq() < 1e-12 &&
+                      (newCorner1 - corner1).lengthSq() < 1e-12;
+
+    std::vector<Vector3D> newColor(W * H);
+    std::vector<float> newDepth(W * H);
+    std::vector<Vector3D> newNormal(W * H);
+    std::vector<float> newHistory(W * H);
+
+    parallelFor(H, [&](size_t begin, size_t end) {
+        for (size_t y = begin; y < end; y++)
+        {
+            for (size_t x = 0; x < W; x++)
+            {
+                size_t i = y * W + x;
+                Vector3D current = film.getPixelValue(x, y);
+                double d = film.getLayerValue(depthLayer, x, y).x;
+                Vector3D n = film.getLayerValue(normalLayer, x, y);
+                if (n.lengthSq() > 0.0)
+                    n = n.normalized();
+
+                // History of the point seen by the pixel, in the previous frame
+                Vector3D previousColor(0.0);
+                double previousHistory = 0.0;
+                double u, v, distance;
+                Ray r = cam.generateRay((x + 0.5) / W, (y + 0.5) / H);
+                if (hasHistory && d > 0.0 &&
+                    cam.cameraSpaceToNDC(worldToCamera.transformPoint(r.o + r.d * d), u, v, distance))
+                {
+                    double fx = u * W - 0.5;
+                    double fy = v * H - 0.5;
+                    int x0 = (int)std::floor(fx);
+                    int y0 = (int)std::floor(fy);
+                    double tx = fx - x0;
+                    double ty = fy - y0;
+
+                    Vector3D colorSum(0.0);
+                    double historySum = 0.0, weightSum = 0.0;
+                    for (int k = 0; k < 4; k++)
+                    {
+                        int px = x0 + (k & 1);
+                        int py = y0 + (k >> 1);
+                        if (px < 0 || py < 0 || px >= (int)W || py >= (int)H)
+                            continue;
+
+                        size_t j = (size_t)py * W + (size_t)px;
+                        if (history[j] <= 0.0f || std::abs(depth[j] - distance) > depthTolerance * distance)
+                            continue;
+                        if (n.lengthSq() > 0.0 && normal[j].lengthSq() > 0.0 &&
+                            dot(n, normal[j]) < normalTolerance)
+                            continue;
+
+                        double w = ((k & 1) ? tx : 1.0 - tx) * ((k >> 1) ? ty : 1.0 - ty);
+                        colorSum += color[j] * w;
+                        historySum += history[j] * w;
+                        weightSum += w;
+                    }
+
+                    if (weightSum > 1e-3)
+                    {
+                        previousColor = colorSum / weightSum;
+                        previousHistory = historySum / weightSum;
+                    }
+                }
+
+                // Running mean over the last maxHistory frames at most
+                double frames = std::min(previousHistory, (double)(maxHistory - 1)) + 1.0;
+                Vector3D blended = previousColor * (1.0 - 1.0 / frames) + current / frames;
+                film.setPixelValue(x, y, blended);
+
+                newColor[i] = blended;
+                newDepth[i] = (float)d;
+                newNormal[i] = n;
+                newHistory[i] = d > 0.0 ? (float)frames : 0.0f;
+            }
+        }
+    }, numThreads);
+
+    color.swap(newColor);
+    depth.swap(newDepth);
+    normal.swap(newNormal);
+    history.swap(newHistory);
+    width = W;
+    height = H;
+    cam.cameraToWorld.inverse(worldToCamera);
+    corner0 = newCorner0;
+    corner1 = newCorner1;
+}
@@ -0,0 +1,55 @@
+#ifndef TEMPORALACCUMULATOR_H
+#define TEMPORALACCUMULATOR_H
+
+#include <vector>
+
+#include "film.h"
+#include "matrix4x4.h"
+#include "../cameras/camera.h"
+
+// Reuse of the samples of the previous frames of an animation. Each pixel of
+// a new frame is traced back to the previous frame with its depth and the
+// motion of the camera, and the history found there (filtered bilinearly)
+// is blended with the new samples as a running mean of up to maxHistory
+// frames. Only the neighbours of the previous frame at about the expected
+// distance and with about the same normal are used, so that the history of
+// surfaces which were hidden (or are not there any more) is dropped. Other
+// motion than that of the camera is not followed: moving objects are only
+// caught by those tests.
+// The frames must be rendered with the "depth" and "normal" layers (see
+// Renderer::addLayers). Changing the field of view or the lens of the
+// camera, or the size of the film, starts the history again.
+class TemporalAccumulator
+{
+public:
+    TemporalAccumulator();
+
+    // Blend the image of the film, just rendered by cam, with the history
+    // and replace it with the result, which becomes the new history
+    void accumulate(Film &film, const Camera &cam);
+
+    // Forget the previous frames
+    void reset();
+
+    // Settings
+    int maxHistory;             // Frames averaged at most (1 = no reuse)
+    double depthTolerance;      // Relative difference of the distances
+    double normalTolerance;     // Minimum cosine between the normals
+    unsigned int numThreads;    // 0 = all the hardware threads
+
+private:
+    size_t width, height;
+
+    // Previous frame: blended color, distance, normal and history length
+    std::vector<Vector3D> color;
+    std::vector<float> depth;
+    std::vector<Vector3D> normal;
+    std::vector<float> history;
+
+    // Previous camera, and the corners of its image plane to detect a
+    // change of projection
+    Matrix4x4 worldToCamera;
+    Vector3D corner0, corner1;
+};
+
+#endif // TEMPORALACCUMULATOR_H
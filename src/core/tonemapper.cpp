@@ -0,0 +1,182 @@
+#include "tonemapper.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Entries of the gamma table over [0,1]
+#define TONEMAPPER_TABLE_SIZE 65536
+// Side of the tiled blue-noise threshold map
+#define BLUE_NOISE_SIZE 64
+
+// Blue-noise threshold map in [0,1), built once with the void-and-cluster
+// method (Ulichney): pixels are ranked by repeatedly filling the largest
+// void of a toroidal Gaussian energy field, so that the thresholds of
+// neighbouring pixels are always far apart
+static const std::vector<float>& blueNoise()
+{
+    static const std::vector<float> thresholds = [] {
+        const int n = BLUE_NOISE_SIZE;
+        const int numPixels = n * n;
+        const double sigma = 1.5;
+
+        // Energy that a set pixel adds at each toroidal offset
+        std::vector<double> kernel(numPixels);
+        for (int dy = 0; dy < n; dy++)
+        {
+            for (int dx = 0; dx < n; dx++)
+            {
+                int wx = std::min(dx, n - dx);
+                int wy = std::min(dy, n - dy);
+                kernel[dy * n + dx] = std::exp(-(wx * wx + wy * wy) / (2.0 * sigma * sigma));
+            }
+        }
+
+        std::vector<bool> set(numPixels, false);
+        std::vector<double> energy(numPixels, 0.0);
+        auto update = [&](int p, double sign) {
+            int px = p % n, py = p / n;
+            for (int y = 0; y < n; y++)
+                for (int x = 0; x < n; x++)
+                    energy[y * n + x] += sign * kernel[((y - py + n) % n) * n + (x - px + n) % n];
+        };
+        auto extreme = [&](bool value, bool largest) {
+            int best = -1;
+            for (int p = 0; p < numPixels; p++)
+                if (set[p] == value && (best < 0 || (largest ? energy[p] > energy[best] : energy[p] < energy[best])))
+                    best = p;
+            return best;
+        };
+
+        // Initial pattern: a tenth of the pixels, at fixed pseudo-random places
+        unsigned int state = 12345u;
+        int numInitial = 0;
+        while (numInitial < numPixels / 10)
+        {
+            state = state * 1664525u + 1013904223u;
+            int p = (int)((state >> 8) % (unsigned int)numPixels);
+            if (!set[p])
+            {
+                set[p] = true;
+                update(p, 1.0);
+                numInitial++;
+            }
+        }
+
+        // Spread it: move the tightest cluster into the largest void until
+        // that undoes the move
+        while (true)
+        {
+            int cluster = extreme(true, true);
+            set[cluster] = false;
+            update(cluster, -1.0);
+            int hole = extreme(false, false);
+            set[hole] = true;
+            update(hole, 1.0);
+            if (hole == cluster)
+                break;
+        }
+
+        std::vector<int> rank(numPixels, 0);
+
+        // Rank the initial pixels by taking out the tightest clusters
+        std::vector<bool> initial = set;
+        std::vector<double> initialEnergy = energy;
+        for (int r = numInitial - 1; r >= 0; r--)
+        {
+            int cluster = extreme(true, true);
+            set[cluster] = false;
+            update(cluster, -1.0);
+            rank[cluster] = r;
+        }
+
+        // Rank the rest by filling the largest voids
+        set = initial;
+        energy = initialEnergy;
+        for (int r = numInitial; r < numPixels; r++)
+        {
+            int hole = extreme(false, false);
+            set[hole] = true;
+            update(hole, 1.0);
+            rank[hole] = r;
+        }
+
+        std::vector<float> result(numPixels);
+        for (int p = 0; p < numPixels; p++)
+            result[p] = (rank[p] + 0.5f) / numPixels;
+        return result;
+    }();
+
+    return thresholds;
+}
+
+ToneMapper::ToneMapper()
+    : toneMapping(TONEMAP_CLAMP), exposure(1.0), gamma(1.0), dither(false), tableGamma(0.0)
+{ }
+
+void ToneMapper::prepare()
+{
+    if (!gammaTable.empty() && tableGamma == gamma)
+        return;
+
+    gammaTable.resize(TONEMAPPER_TABLE_SIZE);
+    for (int i = 0; i < TONEMAPPER_TABLE_SIZE; i++)
+        gammaTable[i] = (float)std::pow(i / (double)(TONEMAPPER_TABLE_SIZE - 1), 1.0 / gamma);
+    tableGamma = gamma;
+
+    if (dither)
+        blueNoise();
+}
+
+void ToneMapper::apply(const float *rgb, size_t count, size_t x, size_t y,
+                       unsigned char *out, float *scratch) const
+{
+    const size_t n = 3 * count;
+    const float scale = (float)exposure;
+
+    // Exposure and tone curve, mapped to [0,1]
+    switch (toneMapping)
+    {
+    case TONEMAP_REINHARD:
+        for (size_t i = 0; i < n; i++)
+        {
+            float v = std::max(rgb[i] * scale, 0.0f);
+            scratch[i] = v / (1.0f + v);
+        }
+        break;
+    case TONEMAP_ACES:
+        for (size_t i = 0; i < n; i++)
+        {
+            float v = std::max(rgb[i] * scale, 0.0f);
+            v = (v * (2.51f * v + 0.03f)) / (v * (2.43f * v + 0.59f) + 0.14f);
+            scratch[i] = std::min(v, 1.0f);
+        }
+        break;
+    default:
+        for (size_t i = 0; i < n; i++)
+            scratch[i] = std::min(std::max(rgb[i] * scale, 0.0f), 1.0f);
+        break;
+    }
+
+    // Gamma
+    const float *table = gammaTable.data();
+    for (size_t i = 0; i < n; i++)
+        scratch[i] = table[(int)(scratch[i] * (TONEMAPPER_TABLE_SIZE - 1) + 0.5f)];
+
+    // Quantization, rounding to the nearest level or against the thresholds
+    // of the blue-noise map
+    if (dither)
+    {
+        const float *noiseRow = blueNoise().data() + (y % BLUE_NOISE_SIZE) * BLUE_NOISE_SIZE;
+        for (size_t i = 0; i < n; i++)
+        {
+            float threshold = noiseRow[(x + i / 3) % BLUE_NOISE_SIZE];
+            out[i] = (unsigned char)std::min(scratch[i] * 255.0f + threshold, 255.0f);
+        }
+    }
+    else
+    {
+        for (size_t i = 0; i < n; i++)
+            out[i] = (unsigned char)(scratch[i] * 255.0f + 0.5f);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef TONEMAPPER_H
+#define TONEMAPPER_H
+
+#include <cstddef>
+#include <vector>
+
+enum ToneMapping
+{
+    TONEMAP_CLAMP,      // Values above 1 are clipped
+    TONEMAP_REINHARD,   // x / (1 + x)
+    TONEMAP_ACES        // Filmic curve (Narkowicz's fit of the ACES reference transform)
+};
+
+// Conversion of linear radiance to 8-bit display values: exposure, tone
+// curve, gamma and quantization, optionally with a blue-noise dither which
+// turns the banding of smooth gradients into fine, unstructured noise.
+// Rows are converted as flat arrays of floats in branch-free loops, one per
+// step, which the compiler vectorizes; the gamma curve is a lookup table.
+class ToneMapper
+{
+public:
+    ToneMapper();
+
+    // Build the gamma table; call it again after changing gamma
+    void prepare();
+
+    // Convert "count" pixels (interleaved RGB floats) of row y, starting at
+    // column x, to interleaved 8-bit RGB. "scratch" holds 3 * count floats
+    void apply(const float *rgb, size_t count, size_t x, size_t y,
+               unsigned char *out, float *scratch) const;
+
+    // Settings
+    ToneMapping toneMapping;    // TONEMAP_CLAMP by default
+    double exposure;            // Scale of the radiance before the tone curve
+    double gamma;               // 1 keeps linear values (as the BMP output always did)
+    bool dither;
+
+private:
+    std::vector<float> gammaTable;
+    double tableGamma;
+};
+
+#endif // TONEMAPPER_H
@@ -1,4 +1,7 @@
 #include "utils.h"
+#include "scene.h"
+
+#include <algorithm>
 
 Utils::Utils()
 { }
@@ -10,37 +13,16 @@ double Utils::degreesToRadians(double degrees)
 
 
 
-bool Utils::hasIntersection(const Ray& cameraRay, const std::vector<Shape*>& objectsList) //or Shadow Ray
+bool Utils::hasIntersection(const Ray& cameraRay, const Scene& scene) //or Shadow Ray
 {
-
-    // For each object on the scene...
-    for(size_t objIndex = 0; objIndex < objectsList.size(); objIndex ++)
-    {
-          // Get the current object
-          const Shape *obj = objectsList.at(objIndex);
-          if (obj->rayIntersectP(cameraRay))
-              return true;
-    }   
-
-    return false;
+    return scene.rayIntersectP(cameraRay);
 }
 
 
 
-bool Utils::getClosestIntersection(const Ray& cameraRay, const std::vector<Shape*>& objectsList, Intersection& its) //or Closest Hit Ray
+bool Utils::getClosestIntersection(const Ray& cameraRay, const Scene& scene, Intersection& its) //or Closest Hit Ray
 {
-    //std::cout << "Need to implement the function Utils::getClosestIntersection() in the file utils.cpp" << std::endl;
-
-    bool hasIntersection = false;
-
-    for (size_t objIndex = 0; objIndex < objectsList.size(); objIndex++)
-    {
-        // Get the current object
-        const Shape* obj = objectsList.at(objIndex);
-        if (obj->rayIntersect(cameraRay, its))
-            hasIntersection =  true;
-    }
-    return hasIntersection;
+    return scene.rayIntersect(cameraRay, its);
 }
 
 double interpolate(double val, double y0, double x0, double y1, double x1 )
@@ -91,3 +73,109 @@ Vector3D Utils::computeReflectionDirection(const Vector3D &Direction, const Vect
     return wr;
 }
 
+Vector3D Utils::sampleCosineHemisphere(const Vector3D &n, double u1, double u2)
+{
+    // Uniform point of the unit disk, projected up to the hemisphere
+    double r = std::sqrt(u1);
+    double phi = 2.0 * M_PI * u2;
+    double z = std::sqrt(std::max(0.0, 1.0 - u1));
+
+    Vector3D t = cross(n, std::abs(n.x) < 0.9 ? Vector3D(1.0, 0.0, 0.0) : Vector3D(0.0, 1.0, 0.0)).normalized();
+    Vector3D b = cross(n, t);
+    return (t * (r * std::cos(phi)) + b * (r * std::sin(phi)) + n * z).normalized();
+}
+
+Vector3D Utils::sampleUniformSphere(double u1, double u2)
+{
+    double z = 1.0 - 2.0 * u1;
+    double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+    double phi = 2.0 * M_PI * u2;
+    return Vector3D(r * std::cos(phi), r * std::sin(phi), z);
+}
+
+bool Utils::scatterSpecular(const MaterialRecord &material, const Vector3D &x,
+                            const Vector3D &n, const Vector3D &d,
+                            size_t depth, double time, Ray &next)
+{
+    Vector3D wo = (-d).normalized();
+
+    if (material.hasSpecular())
+    {
+        Vector3D n1 = dot(n, wo) < 0 ? -n : n;
+        Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
+        next = Ray(x + n1 * Epsilon, wr, depth, Epsilon, INFINITY, time);
+        return true;
+    }
+
+    if (material.hasTransmission())
+    {
+        float muT = material.getIndexOfRefraction();
+        Vector3D n1 = n;
+
+        if (dot(n, wo) < 0)
+        {
+            n1 = -n;
+            muT = 1.0 / muT;
+        }
+
+        float radicand = 1 - muT * muT * (1 - dot(n1, wo) * dot(n1, wo));
+
+        if (radicand >= 0)
+        {
+            Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized();
+            next = Ray(x - n1 * Epsilon, wt, depth, Epsilon, INFINITY, time);
+        }
+        else
+        {
+            Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
+            next = Ray(x + n1 * Epsilon, wr, depth, Epsilon, INFINITY, time);
+        }
+        return true;
+    }
+
+    return false;
+}
+
+Vector3D Utils::sampleDirectLight(const Vector3D &x, const Vector3D &wo, const Vector3D &n,
+                                  const MaterialRecord &material, double time,
+                                  const Scene &scene)
+{
+    Vector3D Ldir(0.0);
+
+    // Pick one light (proportionally to its power, or to its estimated
+    // contribution with the light BVH), then a point y on it, sampled by
+    // the solid angle of the light as seen from x
+    double lightPmf;
+    const LightSource* light = scene.sampleLight(x, n, (double)rand() / RAND_MAX, lightPmf);
+    if (light == nullptr || lightPmf <= 0.0)
+        return Ldir;
+
+    Vector3D lightNormal;
+    double areaPdf;
+    Vector3D y = light->sampleLightPosition(x, (double)rand() / RAND_MAX,
+                                            (double)rand() / RAND_MAX, lightNormal, areaPdf);
+    if (areaPdf <= 0.0)
+        return Ldir;
+
+    Vector3D L = y - x;
+    double distance = L.length();
+    if (distance <= 0.0)
+        return Ldir;
+    Vector3D wi = L / distance;
+
+    // G(x, y). Point lights have no normal (and no area): their intensity
+    // falls off with the squared distance only
+    double cosY = lightNormal.lengthSq() > 0.0 ? dot(lightNormal, -wi) : 1.0;
+    double G = dot(n, wi) * cosY / (distance * distance);
+    if (G <= 0.0)
+        return Ldir;
+
+    // V(x, y)
+    Ray shadowRay(x, wi, 0, Epsilon, distance - Epsilon, time);
+    if (hasIntersection(shadowRay, scene))
+        return Ldir;
+
+    // Le * reflectance * G / pdf, with pdf = pmf(light) * pdf(y)
+    Vector3D Le = light->getRadiance(y, x - y);
+    return Le * material.getReflectance(n, wo, wi) * G / (lightPmf * areaPdf);
+}
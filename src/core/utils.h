@@ -8,6 +8,9 @@
 
 #include "ray.h"
 #include "../shapes/shape.h"
+#include "../materials/materialrecord.h"
+
+class Scene;
 
 
 #define PBSTR "||||||||||||||||||||||||||||||||||||||||||||||||||||||||||||"
@@ -18,15 +21,41 @@ class Utils
 public:
     Utils();
 
-    static bool getClosestIntersection(const Ray &cameraRay, const std::vector<Shape*> &objectsList, Intersection &its);
-    static bool hasIntersection(const Ray &ray, const std::vector<Shape*> &objectsList);
+    static bool getClosestIntersection(const Ray &cameraRay, const Scene &scene, Intersection &its);
+    static bool hasIntersection(const Ray &ray, const Scene &scene);
     static Vector3D scalarToRGB(double scalar);
     static double degreesToRadians(double degrees);
 
+    // Luminance of a linear RGB color (Rec. 709 weights)
+    static double luminance(const Vector3D &c)
+    {
+        return 0.2126 * c.x + 0.7152 * c.y + 0.0722 * c.z;
+    }
+
 
 
     static Vector3D computeReflectionDirection(const Vector3D &Direction, const Vector3D &normal);
 
+    // Directions for the random numbers u1, u2 in [0,1]: around n with a
+    // density of cos(theta) / pi, and uniform over the sphere (1 / (4 pi))
+    static Vector3D sampleCosineHemisphere(const Vector3D &n, double u1, double u2);
+    static Vector3D sampleUniformSphere(double u1, double u2);
+
+    // Ray leaving x (normal n) after the perfect reflection or refraction,
+    // as the shaders do them, of the direction d arriving there, with the
+    // given depth and time. Returns false if the material is neither a
+    // mirror nor transmissive
+    static bool scatterSpecular(const MaterialRecord &material, const Vector3D &x,
+                                const Vector3D &n, const Vector3D &d,
+                                size_t depth, double time, Ray &next);
+
+    // One sample, drawn with rand(), of the light which reaches x (normal n)
+    // straight from a light chosen by Scene::sampleLight and is reflected
+    // toward wo, as the next event estimation of the shaders does it
+    static Vector3D sampleDirectLight(const Vector3D &x, const Vector3D &wo, const Vector3D &n,
+                                      const MaterialRecord &material, double time,
+                                      const Scene &scene);
+
 
 
     static void printProgress(double percentage) {
@@ -1,5 +1,7 @@
 #include "vector3d.h"
 
+#include <cmath>
+
 Vector3D::Vector3D() : x(0), y(0), z(0)
 {
 }
@@ -1,8 +1,129 @@
 #include "arealightsource.h"
+#include "../core/utils.h"
+#include <algorithm>
+#include <cmath>
 #include <cstdlib>
 
+#define PI 3.14159265358979323846
+
+// Rectangles subtending a solid angle outside this range are sampled by
+// area: the spherical parametrization loses precision for tiny ones and for
+// ones which cover most of the hemisphere
+#define MIN_SOLID_ANGLE 3e-4
+#define MAX_SOLID_ANGLE 6.22
+
+// The rectangle as seen from the point o (Urena et al., "An Area-Preserving
+// Parametrization for Spherical Rectangles"), in a local frame (ex, ey, ez)
+// with the rectangle at z = z0 < 0 covering [x0, x1] x [y0, y1]
+struct SphericalRectangle
+{
+    Vector3D o, ex, ey, ez;
+    double x0, y0, z0, x1, y1;
+    double b0, b1, k;
+    double solidAngle;
+};
+
+static bool buildSphericalRectangle(const Square* square, const Vector3D &o, SphericalRectangle &r)
+{
+    double lengthX = square->v1.length();
+    double lengthY = square->v2.length();
+    if (lengthX <= 0.0 || lengthY <= 0.0)
+        return false;
+
+    r.o = o;
+    r.ex = square->v1 / lengthX;
+    r.ey = square->v2 / lengthY;
+
+    // The parametrization needs a rectangle
+    if (std::abs(dot(r.ex, r.ey)) > 1e-4)
+        return false;
+
+    r.ez = cross(r.ex, r.ey);
+    Vector3D d = square->corner - o;
+    r.z0 = dot(d, r.ez);
+    if (r.z0 > 0.0)
+    {
+        r.ez = -r.ez;
+        r.z0 = -r.z0;
+    }
+    if (r.z0 > -1e-6)
+        return false;   // o lies on the plane of the rectangle
+
+    r.x0 = dot(d, r.ex);
+    r.y0 = dot(d, r.ey);
+    r.x1 = r.x0 + lengthX;
+    r.y1 = r.y0 + lengthY;
+
+    // Normals of the planes through o and each edge
+    double z0 = r.z0;
+    double n0[3] = { 0.0, z0, -r.y0 };
+    double n1[3] = { -z0, 0.0, r.x1 };
+    double n2[3] = { 0.0, -z0, r.y1 };
+    double n3[3] = { z0, 0.0, -r.x0 };
+    double *normals[4] = { n0, n1, n2, n3 };
+    for (double *n : normals)
+    {
+        double len = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+        n[0] /= len; n[1] /= len; n[2] /= len;
+    }
+
+    // Internal angles of the spherical rectangle
+    auto angle = [](const double *a, const double *b) {
+        double c = -(a[0] * b[0] + a[1] * b[1] + a[2] * b[2]);
+        return std::acos(std::min(1.0, std::max(-1.0, c)));
+    };
+    double g0 = angle(n0, n1);
+    double g1 = angle(n1, n2);
+    double g2 = angle(n2, n3);
+    double g3 = angle(n3, n0);
+
+    r.b0 = n0[2];
+    r.b1 = n2[2];
+    r.k = 2.0 * PI - g2 - g3;
+    r.solidAngle = g0 + g1 - r.k;
+
+    return r.solidAngle >= MIN_SOLID_ANGLE && r.solidAngle <= MAX_SOLID_ANGLE;
+}
+
+// Point of the rectangle for the random numbers u, v. Uniform by solid angle
+static Vector3D sampleSphericalRectangle(const SphericalRectangle &r, double u, double v)
+{
+    // Choose the x coordinate by the area to its left
+    double au = u * r.solidAngle + r.k;
+    double fu = (std::cos(au) * r.b0 - r.b1) / std::sin(au);
+    double cu = 1.0 / std::sqrt(fu * fu + r.b0 * r.b0) * (fu > 0.0 ? 1.0 : -1.0);
+    cu = std::min(1.0, std::max(-1.0, cu));
+    double xu = -(cu * r.z0) / std::sqrt(std::max(1e-12, 1.0 - cu * cu));
+    xu = std::min(r.x1, std::max(r.x0, xu));
+
+    // And y uniformly in the angle along that column
+    double d = std::sqrt(xu * xu + r.z0 * r.z0);
+    double h0 = r.y0 / std::sqrt(d * d + r.y0 * r.y0);
+    double h1 = r.y1 / std::sqrt(d * d + r.y1 * r.y1);
+    double hv = h0 + v * (h1 - h0);
+    double hv2 = hv * hv;
+    double yv = hv2 < 1.0 - 1e-6 ? (hv * d) / std::sqrt(1.0 - hv2) : r.y1;
+    yv = std::min(r.y1, std::max(r.y0, yv));
+
+    return r.o + r.ex * xu + r.ey * yv + r.ez * r.z0;
+}
+
+// From a density per solid angle around x to a density per unit area at y
+static double solidAngleToArea(const Vector3D &x, const Vector3D &y, const Vector3D &normal,
+                               double pdfSolidAngle)
+{
+    Vector3D L = y - x;
+    double distance2 = L.lengthSq();
+    if (distance2 <= 0.0)
+        return 0.0;
+    double cosY = std::abs(dot(normal.normalized(), L)) / std::sqrt(distance2);
+    if (cosY <= 0.0)
+        return 0.0;
+    return pdfSolidAngle * cosY / distance2;
+}
+
 AreaLightSource::AreaLightSource(Square* areaLightsource_) :
-    myAreaLightsource(areaLightsource_)
+    LightSource(LIGHT_AREA), myAreaLightsource(areaLightsource_)
 { }
 
 
@@ -13,6 +134,19 @@ Vector3D AreaLightSource::getIntensity() const
 }
 
 
+// Lambertian emitter: Phi = pi * Le * area
+double AreaLightSource::getPower() const
+{
+    Vector3D Le = getIntensity();
+    return 3.14159265358979323846 * (Le.x + Le.y + Le.z) / 3.0 * getArea();
+}
+
+// The square only emits on the side of its normal
+LightBounds AreaLightSource::getLightBounds() const
+{
+    return LightBounds::planar(myAreaLightsource->getBounds(), getNormal(), getPower());
+}
+
 Vector3D AreaLightSource::sampleLightPosition() const
 {
     // Generate random point inside the area light source (rectangle)
@@ -27,3 +161,49 @@ Vector3D AreaLightSource::sampleLightPosition() const
     return randomPoint;
 }
 
+Vector3D AreaLightSource::sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                              Vector3D &lightNormal, double &pdf) const
+{
+    lightNormal = getNormal();
+
+    // Points behind the light get nothing from it: no need to sample well
+    SphericalRectangle rect;
+    if (dot(getNormal(), x - myAreaLightsource->corner) > 0.0 &&
+        buildSphericalRectangle(myAreaLightsource, x, rect))
+    {
+        Vector3D y = sampleSphericalRectangle(rect, u1, u2);
+        pdf = solidAngleToArea(x, y, getNormal(), 1.0 / rect.solidAngle);
+        if (pdf > 0.0)
+            return y;
+    }
+
+    // Uniform by area
+    pdf = 1.0 / getArea();
+    return myAreaLightsource->corner + u1 * myAreaLightsource->v1 + u2 * myAreaLightsource->v2;
+}
+
+double AreaLightSource::getPdf(const Vector3D &x, const Vector3D &y) const
+{
+    SphericalRectangle rect;
+    if (dot(getNormal(), x - myAreaLightsource->corner) > 0.0 &&
+        buildSphericalRectangle(myAreaLightsource, x, rect))
+    {
+        double pdf = solidAngleToArea(x, y, getNormal(), 1.0 / rect.solidAngle);
+        if (pdf > 0.0)
+            return pdf;
+    }
+
+    return 1.0 / getArea();
+}
+
+// Uniform point and cosine weighted direction on the side of the normal:
+// power = Le * cos / ((1 / area) * (cos / pi)) = Le * pi * area
+bool AreaLightSource::samplePhoton(double u1, double u2, double u3, double u4,
+                                   Vector3D &y, Vector3D &normal, Vector3D &w, Vector3D &power) const
+{
+    y = myAreaLightsource->corner + u1 * myAreaLightsource->v1 + u2 * myAreaLightsource->v2;
+    normal = getNormal().normalized();
+    w = Utils::sampleCosineHemisphere(normal, u3, u4);
+    power = getIntensity() * (PI * getArea());
+    return true;
+}
@@ -5,7 +5,7 @@
 #include "lightsource.h"
 
 
-class AreaLightSource : public LightSource
+class AreaLightSource final : public LightSource
 {
 public:
     AreaLightSource() = delete;
@@ -15,18 +15,17 @@ public:
 
     Vector3D getIntensity() const;        
     Vector3D sampleLightPosition() const ;
-
+    Vector3D sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                 Vector3D &lightNormal, double &pdf) const;
+    double getPdf(const Vector3D &x, const Vector3D &y) const;
+    bool samplePhoton(double u1, double u2, double u3, double u4,
+                      Vector3D &y, Vector3D &normal, Vector3D &w, Vector3D &power) const;
+    double getPower() const;
+    LightBounds getLightBounds() const;
+
+    // Area of the parallelogram spanned by v1 and v2, in any orientation
     double getArea() const {
-        Vector3D square_dim = myAreaLightsource->v1 + myAreaLightsource->v2;
-        if (square_dim.x <= Epsilon) {
-            return square_dim.y * square_dim.z;
-        }
-        if (square_dim.y <= Epsilon) {
-            return square_dim.x * square_dim.z;
-        }
-        if (square_dim.z <= Epsilon) {
-            return square_dim.x * square_dim.y;
-        }
+        return cross(myAreaLightsource->v1, myAreaLightsource->v2).length();
     }
 
     Vector3D getNormal() const {
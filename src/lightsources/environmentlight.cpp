@@ -0,0 +1,183 @@
+#include "environmentlight.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+
+#include "../core/tinyexr.h"
+#include "../core/utils.h"
+
+#define PI 3.14159265358979323846
+
+EnvironmentLight::EnvironmentLight(const std::string &filename, double scale)
+    : LightSource(LIGHT_ENVIRONMENT), width(1), height(1), pixels(1, Vector3D(0.0)), sceneCenter(0.0), sceneRadius(1.0)
+{
+    float* rgba = nullptr;
+    int w, h;
+    const char* err = nullptr;
+
+    if (LoadEXR(&rgba, &w, &h, filename.c_str(), &err) != TINYEXR_SUCCESS)
+    {
+        std::cout << "Error loading EXR file " << filename << " --> "
+                  << (err != nullptr ? err : "") << std::endl;
+        if (err != nullptr)
+            FreeEXRErrorMessage(err);
+    }
+    else
+    {
+        width = w;
+        height = h;
+        pixels.resize((size_t)w * h);
+        for (size_t i = 0; i < pixels.size(); i++)
+            pixels[i] = Vector3D(rgba[4 * i], rgba[4 * i + 1], rgba[4 * i + 2]) * scale;
+        free(rgba);
+    }
+
+    buildDistribution();
+}
+
+EnvironmentLight::EnvironmentLight(int width_, int height_, const std::vector<Vector3D> &pixels_,
+                                   double scale)
+    : LightSource(LIGHT_ENVIRONMENT), width(width_), height(height_), pixels(pixels_), sceneCenter(0.0), sceneRadius(1.0)
+{
+    for (Vector3D &p : pixels)
+        p = p * scale;
+
+    buildDistribution();
+}
+
+void EnvironmentLight::buildDistribution()
+{
+    // Luminance times sin(theta), which is proportional to the solid angle
+    // of the pixels of each row
+    std::vector<double> f((size_t)width * height);
+    for (int v = 0; v < height; v++)
+    {
+        double sinTheta = std::sin(PI * (v + 0.5) / height);
+        for (int u = 0; u < width; u++)
+            f[(size_t)v * width + u] = std::max(0.0, Utils::luminance(pixels[(size_t)v * width + u])) * sinTheta;
+    }
+    distribution = Distribution2D(f.data(), width, height);
+}
+
+void EnvironmentLight::setSceneBounds(const Vector3D &center, double radius)
+{
+    sceneCenter = center;
+    sceneRadius = std::max(radius, Epsilon);
+}
+
+Vector3D EnvironmentLight::getRadiance(const Vector3D &wi) const
+{
+    Vector3D d = wi.normalized();
+    double theta = std::acos(std::min(1.0, std::max(-1.0, (double)d.y)));
+    double phi = std::atan2((double)d.z, (double)d.x);
+    if (phi < 0.0)
+        phi += 2.0 * PI;
+
+    int u = std::min((int)(phi / (2.0 * PI) * width), width - 1);
+    int v = std::min((int)(theta / PI * height), height - 1);
+    return pixels[(size_t)v * width + u];
+}
+
+Vector3D EnvironmentLight::sampleDirection(double u1, double u2, double &pdf) const
+{
+    double u, v, mapPdf;
+    distribution.sampleContinuous(u1, u2, u, v, mapPdf);
+
+    double theta = v * PI;
+    double phi = u * 2.0 * PI;
+    double sinTheta = std::sin(theta);
+
+    // From the density over the image to the density per solid angle
+    pdf = sinTheta > 0.0 ? mapPdf / (2.0 * PI * PI * sinTheta) : 0.0;
+    return Vector3D(sinTheta * std::cos(phi), std::cos(theta), sinTheta * std::sin(phi));
+}
+
+double EnvironmentLight::getDirectionPdf(const Vector3D &wi) const
+{
+    Vector3D d = wi.normalized();
+    double theta = std::acos(std::min(1.0, std::max(-1.0, (double)d.y)));
+    double phi = std::atan2((double)d.z, (double)d.x);
+    if (phi < 0.0)
+        phi += 2.0 * PI;
+
+    double sinTheta = std::sin(theta);
+    if (sinTheta <= 0.0)
+        return 0.0;
+    return distribution.getPdf(phi / (2.0 * PI), theta / PI) / (2.0 * PI * PI * sinTheta);
+}
+
+// Average radiance over the sphere of directions
+Vector3D EnvironmentLight::getIntensity() const
+{
+    Vector3D sum(0.0);
+    double weight = 0.0;
+    for (int v = 0; v < height; v++)
+    {
+        double sinTheta = std::sin(PI * (v + 0.5) / height);
+        for (int u = 0; u < width; u++)
+            sum += pixels[(size_t)v * width + u] * sinTheta;
+        weight += sinTheta * width;
+    }
+    return weight > 0.0 ? sum / weight : Vector3D(0.0);
+}
+
+// y is a point given by sampleLightPosition, w goes from y to the shading
+// point: the light comes from the direction of y
+Vector3D EnvironmentLight::getRadiance(const Vector3D &y, const Vector3D &w) const
+{
+    return getRadiance(-w);
+}
+
+double EnvironmentLight::getFarDistance(const Vector3D &x) const
+{
+    return (x - sceneCenter).length() + 2.0 * sceneRadius;
+}
+
+Vector3D EnvironmentLight::sampleLightPosition() const
+{
+    double pdf;
+    Vector3D wi = sampleDirection((double)rand() / RAND_MAX, (double)rand() / RAND_MAX, pdf);
+    return sceneCenter + wi * (2.0 * sceneRadius);
+}
+
+Vector3D EnvironmentLight::sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                               Vector3D &lightNormal, double &pdf) const
+{
+    double pdfDirection;
+    Vector3D wi = sampleDirection(u1, u2, pdfDirection);
+
+    // Facing x, so that the density per unit area is pdf(wi) / distance^2
+    double distance = getFarDistance(x);
+    lightNormal = -wi;
+    pdf = pdfDirection / (distance * distance);
+    return x + wi * distance;
+}
+
+double EnvironmentLight::getPdf(const Vector3D &x, const Vector3D &y) const
+{
+    Vector3D L = y - x;
+    double distance2 = L.lengthSq();
+    if (distance2 <= 0.0)
+        return 0.0;
+    return getDirectionPdf(L) / distance2;
+}
+
+// Power reaching a disk as large as the scene: Phi = pi * avg(L) * pi r^2
+double EnvironmentLight::getPower() const
+{
+    Vector3D L = getIntensity();
+    return PI * (L.x + L.y + L.z) / 3.0 * PI * sceneRadius * sceneRadius;
+}
+
+LightBounds EnvironmentLight::getLightBounds() const
+{
+    LightBounds lb = LightBounds::omnidirectional(sceneCenter, getPower());
+    lb.bounds = BoundingBox::unbounded();
+    return lb;
+}
+
+double EnvironmentLight::getArea() const
+{
+    return 4.0 * PI * sceneRadius * sceneRadius;
+}
@@ -0,0 +1,74 @@
+#ifndef ENVIRONMENTLIGHT_H
+#define ENVIRONMENTLIGHT_H
+
+#include <string>
+#include <vector>
+
+#include "../core/distribution.h"
+#include "lightsource.h"
+
+// Light arriving from infinitely far away, given by an HDR image in
+// latitude-longitude layout: the top row is +Y (up) and the columns go
+// around +Y starting at +X. The directions are importance sampled with a
+// piecewise-constant distribution over the pixels, weighted by their
+// luminance and solid angle, so bright areas of the sky (e.g., the sun) get
+// most of the samples.
+//
+// The light is seen as a sphere around the scene (see setSceneBounds):
+// sampled points are placed beyond all the geometry along the sampled
+// direction, so that the area based estimators of the shaders still apply.
+class EnvironmentLight final : public LightSource
+{
+public:
+    EnvironmentLight() = delete;
+
+    // Load the image from an EXR file. scale multiplies the radiance.
+    // An image which cannot be read gives a black environment
+    EnvironmentLight(const std::string &filename, double scale = 1.0);
+
+    // Image already in memory, row major from the top row
+    EnvironmentLight(int width_, int height_, const std::vector<Vector3D> &pixels_,
+                     double scale = 1.0);
+
+    // Center and radius of a sphere containing the bounded geometry of the
+    // scene (set by Scene::buildBVH)
+    void setSceneBounds(const Vector3D &center, double radius);
+
+    // Radiance arriving from the direction wi, e.g., along a ray with
+    // direction wi which leaves the scene
+    Vector3D getRadiance(const Vector3D &wi) const;
+
+    // Direction towards the environment for the random numbers u1, u2, and
+    // its density per unit solid angle
+    Vector3D sampleDirection(double u1, double u2, double &pdf) const;
+    double getDirectionPdf(const Vector3D &wi) const;
+
+    Vector3D getIntensity() const;
+    Vector3D getRadiance(const Vector3D &y, const Vector3D &w) const;
+    Vector3D sampleLightPosition() const;
+    Vector3D sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                 Vector3D &lightNormal, double &pdf) const;
+    double getPdf(const Vector3D &x, const Vector3D &y) const;
+    double getPower() const;
+    LightBounds getLightBounds() const;
+
+    // Area of the sphere around the scene
+    double getArea() const;
+    Vector3D getNormal() const { return Vector3D(0.0); };
+
+private:
+    void buildDistribution();
+
+    // Distance from x to a point beyond all the geometry in any direction
+    double getFarDistance(const Vector3D &x) const;
+
+    int width;
+    int height;
+    std::vector<Vector3D> pixels;
+    Distribution2D distribution;
+
+    Vector3D sceneCenter;
+    double sceneRadius;
+};
+
+#endif // ENVIRONMENTLIGHT_H
@@ -0,0 +1,175 @@
+#include "lightbounds.h"
+
+#include <algorithm>
+#include <cmath>
+
+#define PI 3.14159265358979323846
+
+static double safeSqrt(double x)
+{
+    return std::sqrt(std::max(0.0, x));
+}
+
+static double safeAcos(double x)
+{
+    return std::acos(std::min(1.0, std::max(-1.0, x)));
+}
+
+// cos(max(0, a - b)) and sin(max(0, a - b)) from the sines and cosines of
+// the angles a and b
+static double cosSubClamped(double sinA, double cosA, double sinB, double cosB)
+{
+    if (cosA > cosB)
+        return 1.0;
+    return cosA * cosB + sinA * sinB;
+}
+
+static double sinSubClamped(double sinA, double cosA, double sinB, double cosB)
+{
+    if (cosA > cosB)
+        return 0.0;
+    return sinA * cosB - cosA * sinB;
+}
+
+// Rotate v by "angle" radians around the unit vector "axis" (Rodrigues)
+static Vector3D rotate(const Vector3D &v, const Vector3D &axis, double angle)
+{
+    double c = std::cos(angle);
+    double s = std::sin(angle);
+    return v * c + cross(axis, v) * s + axis * (dot(axis, v) * (1.0 - c));
+}
+
+LightBounds LightBounds::omnidirectional(const Vector3D &p, double power)
+{
+    LightBounds lb;
+    lb.bounds = BoundingBox(p);
+    lb.axis = Vector3D(0, 0, 1);
+    lb.cosThetaO = -1.0;    // thetaO = pi: every direction
+    lb.cosThetaE = 0.0;
+    lb.power = power;
+    return lb;
+}
+
+LightBounds LightBounds::planar(const BoundingBox &bounds, const Vector3D &normal,
+                                double power, bool twoSided)
+{
+    LightBounds lb;
+    lb.bounds = bounds;
+    lb.axis = normal.normalized();
+    lb.cosThetaO = 1.0;     // A single normal...
+    lb.cosThetaE = 0.0;     // ...emitting over the hemisphere
+    lb.power = power;
+    lb.twoSided = twoSided;
+    return lb;
+}
+
+LightBounds LightBounds::merge(const LightBounds &a, const LightBounds &b)
+{
+    if (a.power <= 0.0)
+        return b;
+    if (b.power <= 0.0)
+        return a;
+
+    LightBounds lb;
+    lb.bounds = a.bounds;
+    lb.bounds.expand(b.bounds);
+    lb.power = a.power + b.power;
+    lb.cosThetaE = std::min(a.cosThetaE, b.cosThetaE);
+    lb.twoSided = a.twoSided || b.twoSided;
+
+    // Smallest cone containing both orientation cones
+    double thetaA = safeAcos(a.cosThetaO);
+    double thetaB = safeAcos(b.cosThetaO);
+    double thetaD = safeAcos(dot(a.axis, b.axis));
+
+    if (std::min(thetaD + thetaB, PI) <= thetaA)
+    {
+        lb.axis = a.axis;
+        lb.cosThetaO = a.cosThetaO;
+        return lb;
+    }
+    if (std::min(thetaD + thetaA, PI) <= thetaB)
+    {
+        lb.axis = b.axis;
+        lb.cosThetaO = b.cosThetaO;
+        return lb;
+    }
+
+    double thetaO = (thetaA + thetaD + thetaB) / 2.0;
+    Vector3D rotationAxis = cross(a.axis, b.axis);
+    if (thetaO >= PI || rotationAxis.lengthSq() == 0.0)
+    {
+        lb.axis = a.axis;
+        lb.cosThetaO = -1.0;
+        return lb;
+    }
+
+    // Rotate a.axis towards b.axis so that the cone just covers both
+    lb.axis = rotate(a.axis, rotationAxis.normalized(), thetaO - thetaA).normalized();
+    lb.cosThetaO = std::cos(thetaO);
+    return lb;
+}
+
+double LightBounds::importance(const Vector3D &p, const Vector3D &n) const
+{
+    // Distance to the center, clamped so that points inside the bounds do
+    // not get an unbounded importance
+    Vector3D pc = bounds.centroid();
+    Vector3D diagonal = bounds.pMax - bounds.pMin;
+    double d2 = (p - pc).lengthSq();
+    d2 = std::max(d2, diagonal.length() / 2.0);
+
+    // Angle between the cone axis and the direction to p
+    Vector3D wi = (p - pc).normalized();
+    double cosThetaW = dot(axis, wi);
+    if (twoSided)
+        cosThetaW = std::abs(cosThetaW);
+    double sinThetaW = safeSqrt(1.0 - cosThetaW * cosThetaW);
+
+    // Angle subtended by the bounds as seen from p
+    double cosThetaB;
+    double radius2 = diagonal.lengthSq() / 4.0;
+    double dist2 = (p - pc).lengthSq();
+    if (dist2 < radius2)
+        cosThetaB = -1.0;
+    else
+        cosThetaB = safeSqrt(1.0 - radius2 / dist2);
+    double sinThetaB = safeSqrt(1.0 - cosThetaB * cosThetaB);
+
+    // Minimum angle between the emission and the direction to p
+    double sinThetaO = safeSqrt(1.0 - cosThetaO * cosThetaO);
+    double cosThetaX = cosSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+    double sinThetaX = sinSubClamped(sinThetaW, cosThetaW, sinThetaO, cosThetaO);
+    double cosThetaP = cosSubClamped(sinThetaX, cosThetaX, sinThetaB, cosThetaB);
+    if (cosThetaP <= cosThetaE)
+        return 0.0;
+
+    double result = power * cosThetaP / d2;
+
+    // Minimum angle between the normal at p and the bounds
+    if (n.lengthSq() > 0.0)
+    {
+        double cosThetaI = std::abs(dot(wi, n.normalized()));
+        double sinThetaI = safeSqrt(1.0 - cosThetaI * cosThetaI);
+        result *= cosSubClamped(sinThetaI, cosThetaI, sinThetaB, cosThetaB);
+    }
+
+    return std::max(result, 0.0);
+}
+
+double LightBounds::cost() const
+{
+    double thetaO = safeAcos(cosThetaO);
+    double thetaE = safeAcos(cosThetaE);
+    double thetaW = std::min(thetaO + thetaE, PI);
+    double sinThetaO = safeSqrt(1.0 - cosThetaO * cosThetaO);
+
+    // Solid angle measure of the emission
+    double mOmega = 2.0 * PI * (1.0 - cosThetaO) +
+                    PI / 2.0 * (2.0 * thetaW * sinThetaO - std::cos(thetaO - 2.0 * thetaW) -
+                                2.0 * thetaO * sinThetaO + cosThetaO);
+
+    // Points have no area: use the size of a tiny box instead
+    double area = bounds.surfaceArea();
+    return power * mOmega * std::max(area, 1e-6);
+}
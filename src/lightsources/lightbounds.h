@@ -0,0 +1,40 @@
+#ifndef LIGHTBOUNDS_H
+#define LIGHTBOUNDS_H
+
+#include "../core/vector3d.h"
+#include "../core/boundingbox.h"
+
+// Spatial and directional bounds of the emission of one light, or of a group
+// of lights (Conty Estevez and Kulla, "Importance Sampling of Many Lights
+// with Adaptive Tree Splitting"). Every emitter inside "bounds" emits along
+// directions at most thetaO away from "axis", and each of them emits over a
+// further thetaE around its own normal.
+struct LightBounds
+{
+    BoundingBox bounds;
+    Vector3D axis;
+    double cosThetaO = 1.0;
+    double cosThetaE = 0.0;
+    double power = 0.0;
+    bool twoSided = false;
+
+    // Bounds of a light which emits in every direction from a point
+    static LightBounds omnidirectional(const Vector3D &p, double power);
+
+    // Bounds of a planar emitter covering "bounds" with the given normal
+    static LightBounds planar(const BoundingBox &bounds, const Vector3D &normal,
+                              double power, bool twoSided = false);
+
+    // Bounds of both a and b
+    static LightBounds merge(const LightBounds &a, const LightBounds &b);
+
+    // Conservative estimate of the light reaching the point p with normal n
+    // (pass n = 0 for points without a surface, e.g., in a medium)
+    double importance(const Vector3D &p, const Vector3D &n) const;
+
+    // Cost of the node used to build the light BVH (surface area and
+    // orientation heuristic)
+    double cost() const;
+};
+
+#endif // LIGHTBOUNDS_H
@@ -0,0 +1,265 @@
+#include "lightbvh.h"
+
+#include <algorithm>
+
+#define LIGHTBVH_NUM_BUCKETS 12
+// Below this depth the nodes are split in halves, so that the bit trails
+// (64 bits) are long enough for any number of lights
+#define LIGHTBVH_MAX_SAH_DEPTH 32
+
+LightBVH::LightBVH()
+{ }
+
+void LightBVH::clear()
+{
+    lights.clear();
+    nodes.clear();
+    infiniteLights.clear();
+    lightBitTrails.clear();
+}
+
+bool LightBVH::isBuilt() const
+{
+    return !nodes.empty() || !infiniteLights.empty();
+}
+
+void LightBVH::build(const std::vector<LightSource*> &lights_)
+{
+    clear();
+    lights = lights_;
+    lightBitTrails.assign(lights.size(), 0);
+
+    // Lights which do not emit are left out of the tree
+    std::vector<BuildLight> buildLights;
+    for (size_t i = 0; i < lights.size(); i++)
+    {
+        BuildLight bl;
+        bl.index = (int)i;
+        bl.lightBounds = lights[i]->getLightBounds();
+        if (bl.lightBounds.power <= 0.0)
+            continue;
+        if (!bl.lightBounds.bounds.isBounded())
+        {
+            infiniteLights.push_back(bl.index);
+            continue;
+        }
+        bl.centroid = bl.lightBounds.bounds.centroid();
+        buildLights.push_back(bl);
+    }
+
+    if (buildLights.empty())
+        return;
+
+    nodes.reserve(2 * buildLights.size());
+    buildRecursive(buildLights, 0, buildLights.size(), 0, 0);
+}
+
+int LightBVH::buildRecursive(std::vector<BuildLight> &buildLights, size_t start, size_t end,
+                             uint64_t bitTrail, int depth)
+{
+    int nodeIndex = (int)nodes.size();
+    nodes.push_back(Node());
+
+    if (end - start == 1)
+    {
+        nodes[nodeIndex].lightBounds = buildLights[start].lightBounds;
+        nodes[nodeIndex].index = buildLights[start].index;
+        nodes[nodeIndex].isLeaf = true;
+        lightBitTrails[buildLights[start].index] = bitTrail;
+        return nodeIndex;
+    }
+
+    BoundingBox bounds, centroidBounds;
+    for (size_t i = start; i < end; i++)
+    {
+        bounds.expand(buildLights[i].lightBounds.bounds);
+        centroidBounds.expand(buildLights[i].centroid);
+    }
+
+    // Choose the split with the lowest cost among the buckets of the three
+    // axes
+    double bestCost = INFINITY;
+    int bestAxis = -1, bestSplit = -1;
+    Vector3D extent = centroidBounds.pMax - centroidBounds.pMin;
+    double maxExtent = std::max(extent.x, std::max(extent.y, extent.z));
+
+    auto coordinate = [](const Vector3D &v, int axis) {
+        return axis == 0 ? v.x : axis == 1 ? v.y : v.z;
+    };
+
+    for (int axis = 0; axis < 3; axis++)
+    {
+        double axisMin = coordinate(centroidBounds.pMin, axis);
+        double axisMax = coordinate(centroidBounds.pMax, axis);
+        if (axisMax <= axisMin)
+            continue;
+
+        LightBounds bucketBounds[LIGHTBVH_NUM_BUCKETS];
+        for (size_t i = start; i < end; i++)
+        {
+            int b = (int)(LIGHTBVH_NUM_BUCKETS * (coordinate(buildLights[i].centroid, axis) - axisMin) /
+                          (axisMax - axisMin));
+            b = std::min(b, LIGHTBVH_NUM_BUCKETS - 1);
+            bucketBounds[b] = LightBounds::merge(bucketBounds[b], buildLights[i].lightBounds);
+        }
+
+        // Penalize thin splits of long boxes
+        double kr = maxExtent / (axisMax - axisMin);
+
+        for (int s = 0; s < LIGHTBVH_NUM_BUCKETS - 1; s++)
+        {
+            LightBounds left, right;
+            for (int b = 0; b <= s; b++)
+                left = LightBounds::merge(left, bucketBounds[b]);
+            for (int b = s + 1; b < LIGHTBVH_NUM_BUCKETS; b++)
+                right = LightBounds::merge(right, bucketBounds[b]);
+
+            if (left.power <= 0.0 || right.power <= 0.0)
+                continue;
+
+            double cost = kr * (left.cost() + right.cost());
+            if (cost < bestCost)
+            {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = s;
+            }
+        }
+    }
+
+    size_t mid;
+    if (bestAxis >= 0)
+    {
+        double axisMin = coordinate(centroidBounds.pMin, bestAxis);
+        double axisMax = coordinate(centroidBounds.pMax, bestAxis);
+        auto split = std::partition(buildLights.begin() + start, buildLights.begin() + end,
+            [&](const BuildLight &bl) {
+                int b = (int)(LIGHTBVH_NUM_BUCKETS * (coordinate(bl.centroid, bestAxis) - axisMin) /
+                              (axisMax - axisMin));
+                return std::min(b, LIGHTBVH_NUM_BUCKETS - 1) <= bestSplit;
+            });
+        mid = split - buildLights.begin();
+    }
+    else
+    {
+        mid = (start + end) / 2;
+    }
+
+    // Lights at the same place, or a tree too deep for the bit trails
+    if (mid == start || mid == end || depth >= LIGHTBVH_MAX_SAH_DEPTH)
+        mid = (start + end) / 2;
+
+    buildRecursive(buildLights, start, mid, bitTrail, depth + 1);
+    int secondChild = buildRecursive(buildLights, mid, end, bitTrail | ((uint64_t)1 << depth), depth + 1);
+
+    nodes[nodeIndex].lightBounds = LightBounds::merge(nodes[nodeIndex + 1].lightBounds,
+                                                      nodes[secondChild].lightBounds);
+    nodes[nodeIndex].index = secondChild;
+    nodes[nodeIndex].isLeaf = false;
+    return nodeIndex;
+}
+
+const LightSource* LightBVH::sample(const Vector3D &x, const Vector3D &n,
+                                    double u, double &pmf) const
+{
+    pmf = 0.0;
+    if (!isBuilt())
+        return nullptr;
+
+    // Choose between the lights at infinity and the tree
+    double pInfinite = (double)infiniteLights.size() /
+                       (infiniteLights.size() + (nodes.empty() ? 0 : 1));
+    if (u < pInfinite)
+    {
+        size_t i = std::min((size_t)(u / pInfinite * infiniteLights.size()), infiniteLights.size() - 1);
+        pmf = pInfinite / infiniteLights.size();
+        return lights[infiniteLights[i]];
+    }
+    if (nodes.empty())
+        return nullptr;
+    u = std::min((u - pInfinite) / (1.0 - pInfinite), 1.0);
+
+    double nodePmf = 1.0 - pInfinite;
+    int current = 0;
+
+    while (!nodes[current].isLeaf)
+    {
+        const Node &first = nodes[current + 1];
+        const Node &second = nodes[nodes[current].index];
+        double importance0 = first.lightBounds.importance(x, n);
+        double importance1 = second.lightBounds.importance(x, n);
+        if (importance0 == 0.0 && importance1 == 0.0)
+            return nullptr;
+
+        // Choose a child and reuse u for the next level
+        double p0 = importance0 / (importance0 + importance1);
+        if (u < p0)
+        {
+            current = current + 1;
+            nodePmf *= p0;
+            u = std::min(u / p0, 1.0);
+        }
+        else
+        {
+            current = nodes[current].index;
+            nodePmf *= 1.0 - p0;
+            u = std::min((u - p0) / (1.0 - p0), 1.0);
+        }
+    }
+
+    // A single light in the tree: make sure it can reach x
+    if (current == 0 && nodes[0].lightBounds.importance(x, n) == 0.0)
+        return nullptr;
+
+    pmf = nodePmf;
+    return lights[nodes[current].index];
+}
+
+double LightBVH::getPmf(const Vector3D &x, const Vector3D &n, int lightIndex) const
+{
+    if (!isBuilt())
+        return 0.0;
+
+    LightBounds lightBounds = lights[lightIndex]->getLightBounds();
+    if (lightBounds.power <= 0.0)
+        return 0.0;
+
+    double pInfinite = (double)infiniteLights.size() /
+                       (infiniteLights.size() + (nodes.empty() ? 0 : 1));
+    if (!lightBounds.bounds.isBounded())
+        return pInfinite / infiniteLights.size();
+    if (nodes.empty())
+        return 0.0;
+
+    if (nodes[0].isLeaf)
+        return nodes[0].lightBounds.importance(x, n) > 0.0 ? 1.0 - pInfinite : 0.0;
+
+    // Follow the bit trail of the light down to its leaf
+    uint64_t bitTrail = lightBitTrails[lightIndex];
+    double pmf = 1.0 - pInfinite;
+    int current = 0;
+
+    while (!nodes[current].isLeaf)
+    {
+        const Node &first = nodes[current + 1];
+        const Node &second = nodes[nodes[current].index];
+        double importance0 = first.lightBounds.importance(x, n);
+        double importance1 = second.lightBounds.importance(x, n);
+        if (importance0 == 0.0 && importance1 == 0.0)
+            return 0.0;
+
+        if (bitTrail & 1)
+        {
+            pmf *= importance1 / (importance0 + importance1);
+            current = nodes[current].index;
+        }
+        else
+        {
+            pmf *= importance0 / (importance0 + importance1);
+            current = current + 1;
+        }
+        bitTrail >>= 1;
+    }
+
+    return pmf;
+}
@@ -0,0 +1,70 @@
+#ifndef LIGHTBVH_H
+#define LIGHTBVH_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "lightbounds.h"
+#include "lightsource.h"
+
+// Bounding volume hierarchy over the lights of the scene. Each node stores
+// the LightBounds of its subtree; a light is chosen for a shading point by
+// descending the tree and picking, at each node, one child with probability
+// proportional to its importance for that point. Distant lights and lights
+// facing away are thus rarely chosen, and the cost per sample grows with the
+// logarithm of the number of lights. Lights at infinity (e.g., an
+// environment) cannot be bounded and are kept outside the tree; each of them
+// is chosen as often as the whole tree.
+class LightBVH
+{
+public:
+    LightBVH();
+
+    void build(const std::vector<LightSource*> &lights_);
+    void clear();
+    bool isBuilt() const;
+
+    // Return a light chosen for the point x with normal n, with the random
+    // number u in [0,1], and its probability in pmf. Returns nullptr if no
+    // light can reach x
+    const LightSource* sample(const Vector3D &x, const Vector3D &n,
+                              double u, double &pmf) const;
+
+    // Probability of choosing the light at the given index of the list for
+    // the point x with normal n
+    double getPmf(const Vector3D &x, const Vector3D &n, int lightIndex) const;
+
+private:
+    // Flattened node. The first child of an interior node is the next node
+    // in the array and "index" is the second one; for a leaf, "index" is
+    // the light in the list
+    struct Node
+    {
+        LightBounds lightBounds;
+        int index;
+        bool isLeaf;
+    };
+
+    struct BuildLight
+    {
+        int index;
+        LightBounds lightBounds;
+        Vector3D centroid;
+    };
+
+    int buildRecursive(std::vector<BuildLight> &buildLights, size_t start, size_t end,
+                       uint64_t bitTrail, int depth);
+
+    std::vector<LightSource*> lights;
+    std::vector<Node> nodes;
+
+    // Indices of the lights at infinity
+    std::vector<int> infiniteLights;
+
+    // Path from the root to the leaf of each light: bit i tells whether the
+    // second child is taken at depth i
+    std::vector<uint64_t> lightBitTrails;
+};
+
+#endif // LIGHTBVH_H
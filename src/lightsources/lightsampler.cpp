@@ -0,0 +1,131 @@
+#include "lightsampler.h"
+
+#include <algorithm>
+
+LightSampler::LightSampler()
+    : source(nullptr), stale(false)
+{ }
+
+void LightSampler::invalidate(const std::vector<LightSource*> &lights_)
+{
+    source = &lights_;
+    stale.store(true, std::memory_order_release);
+}
+
+void LightSampler::update() const
+{
+    if (!stale.load(std::memory_order_acquire))
+        return;
+
+    std::lock_guard<std::mutex> lock(buildMutex);
+    if (stale.load(std::memory_order_relaxed))
+        const_cast<LightSampler*>(this)->build(*source);
+}
+
+void LightSampler::build(const std::vector<LightSource*> &lights_)
+{
+    buildTable(lights_);
+    stale.store(false, std::memory_order_release);
+}
+
+void LightSampler::buildTable(const std::vector<LightSource*> &lights_)
+{
+    lights = lights_;
+    size_t n = lights.size();
+
+    prob.assign(n, 1.0);
+    alias.resize(n);
+    pmfs.assign(n, n > 0 ? 1.0 / n : 0.0);
+    for (size_t i = 0; i < n; i++)
+        alias[i] = (int)i;
+
+    if (n == 0)
+        return;
+
+    std::vector<double> weights(n);
+    double total = 0.0;
+    for (size_t i = 0; i < n; i++)
+    {
+        weights[i] = std::max(0.0, lights[i]->getPower());
+        total += weights[i];
+    }
+
+    // Without any emitted power, all the lights are equally likely
+    if (total <= 0.0)
+        return;
+
+    // Scale the weights so that the average bucket holds 1, and split them
+    // between under-full and over-full buckets
+    std::vector<int> small, large;
+    for (size_t i = 0; i < n; i++)
+    {
+        pmfs[i] = weights[i] / total;
+        prob[i] = pmfs[i] * n;
+        if (prob[i] < 1.0)
+            small.push_back((int)i);
+        else
+            large.push_back((int)i);
+    }
+
+    // Fill each under-full bucket with the excess of an over-full one
+    while (!small.empty() && !large.empty())
+    {
+        int s = small.back();
+        small.pop_back();
+        int l = large.back();
+        large.pop_back();
+
+        alias[s] = l;
+        prob[l] = (prob[l] + prob[s]) - 1.0;
+
+        if (prob[l] < 1.0)
+            small.push_back(l);
+        else
+            large.push_back(l);
+    }
+
+    // Left-overs are full up to rounding errors
+    for (int i : small)
+        prob[i] = 1.0;
+    for (int i : large)
+        prob[i] = 1.0;
+}
+
+size_t LightSampler::size() const
+{
+    update();
+    return lights.size();
+}
+
+int LightSampler::sampleIndex(double u, double &pmf) const
+{
+    update();
+    if (lights.empty())
+    {
+        pmf = 0.0;
+        return -1;
+    }
+
+    // The integer part of u*n chooses the bucket, the fractional part
+    // chooses between the bucket light and its alias
+    size_t n = lights.size();
+    double scaled = u * n;
+    size_t bucket = std::min((size_t)scaled, n - 1);
+    double frac = scaled - bucket;
+
+    int index = frac < prob[bucket] ? (int)bucket : alias[bucket];
+    pmf = pmfs[index];
+    return index;
+}
+
+const LightSource* LightSampler::sample(double u, double &pmf) const
+{
+    int index = sampleIndex(u, pmf);
+    return index < 0 ? nullptr : lights[index];
+}
+
+double LightSampler::getPmf(int index) const
+{
+    update();
+    return pmfs[index];
+}
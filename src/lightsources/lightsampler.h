@@ -0,0 +1,58 @@
+#ifndef LIGHTSAMPLER_H
+#define LIGHTSAMPLER_H
+
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <vector>
+
+#include "../core/vector3d.h"
+#include "lightsource.h"
+
+// Picks one light of the scene with probability proportional to its emitted
+// power, in constant time, using an alias table (Walker / Vose). Adding
+// lights only marks the table as out of date (see invalidate), and it is
+// built again once, when it is next used, so that adding n lights stays
+// O(n). The first use after a change may come from several threads at once.
+class LightSampler
+{
+public:
+    LightSampler();
+
+    void build(const std::vector<LightSource*> &lights_);
+
+    // The lights changed: build the table from lights_ (which must outlive
+    // the sampler) before it is used again
+    void invalidate(const std::vector<LightSource*> &lights_);
+
+    size_t size() const;
+
+    // Return a light chosen with the random number u in [0,1], and its
+    // probability in pmf. Returns nullptr if there are no lights
+    const LightSource* sample(double u, double &pmf) const;
+
+    // Same as above, returning the index of the light in the list
+    int sampleIndex(double u, double &pmf) const;
+
+    // Probability of choosing the light at the given index
+    double getPmf(int index) const;
+
+private:
+    // Build the table if it is out of date
+    void update() const;
+    void buildTable(const std::vector<LightSource*> &lights_);
+
+    std::vector<LightSource*> lights;
+
+    const std::vector<LightSource*> *source;
+    mutable std::atomic<bool> stale;
+    mutable std::mutex buildMutex;
+
+    // Alias table: bucket i keeps light i with probability prob[i], and
+    // light alias[i] otherwise
+    std::vector<double> prob;
+    std::vector<int> alias;
+    std::vector<double> pmfs;
+};
+
+#endif // LIGHTSAMPLER_H
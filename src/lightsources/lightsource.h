@@ -1,24 +1,84 @@
 #ifndef LIGHTSOURCE_H
 #define LIGHTSOURCE_H
 
+#include "lightbounds.h"
+
 
 // To start, let this be the interface of a point light source
 // Then, make this an abstract class from which we can derive:
 //   - omnidirectional uniform point light sources
 //   - area light sources
 
+// Kind of a light. Code which avoids the virtual calls (see
+// IntegratorKernel) switches on it and calls the final light classes
+// directly, as PrimitiveStore does for the shapes
+enum LightType
+{
+    LIGHT_POINT,
+    LIGHT_AREA,
+    LIGHT_SPHERE,
+    LIGHT_MESH,
+    LIGHT_ENVIRONMENT
+};
+
 class LightSource
 {
 public:
-    LightSource() {}; 
+    LightSource(LightType type_) : type(type_) {}; 
+
+    LightType getType() const { return type; };
 
 
     virtual Vector3D getIntensity() const = 0;
+
+    // Radiance leaving the point y of the light in the direction w. Lights
+    // whose emission does not depend on the direction return getIntensity()
+    virtual Vector3D getRadiance(const Vector3D &y, const Vector3D &w) const {
+        return getIntensity();
+    };
     virtual Vector3D sampleLightPosition() const = 0;
 
+    // Sample a point y of the light to illuminate x, with the random
+    // numbers u1, u2 in [0,1]. Returns the normal of the light at y in
+    // lightNormal, and in pdf the density of y per unit area of the light
+    // (1 for point lights, which need no area term and have no normal)
+    virtual Vector3D sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                         Vector3D &lightNormal, double &pdf) const = 0;
+
+    // Density per unit area with which sampleLightPosition(x, ...) returns
+    // the point y of the light
+    virtual double getPdf(const Vector3D &x, const Vector3D &y) const = 0;
+
+    // Start a photon with the random numbers u1..u4 in [0,1]: a point y of
+    // the light with its normal (zero for point lights), a direction w
+    // leaving it, and the power the photon carries (the radiance times the
+    // cosine at y over the density of y and w). The points are uniform over
+    // the area of the light, the directions cosine weighted around the
+    // normal (uniform for point lights). Returns false for lights which do not emit photons
+    virtual bool samplePhoton(double u1, double u2, double u3, double u4,
+                              Vector3D &y, Vector3D &normal, Vector3D &w,
+                              Vector3D &power) const {
+        return false;
+    };
+
     virtual double getArea() const = 0;
     virtual Vector3D getNormal() const = 0;
 
+    // Total emitted power (averaged over the color channels), used to
+    // choose among the lights of the scene
+    virtual double getPower() const = 0;
+
+    // Where and towards which directions the light emits, used to build
+    // the light BVH
+    virtual LightBounds getLightBounds() const = 0;
+
+    // Recompute what the light keeps from its shapes after they moved (see
+    // Scene::refitBVH). Lights which read their shapes directly need not
+    // override it
+    virtual void update() {};
+
+private:
+    LightType type;
 
 };
 
@@ -0,0 +1,121 @@
+#include "meshlightsource.h"
+#include "../core/utils.h"
+#include <algorithm>
+#include <cstdlib>
+
+#define PI 3.14159265358979323846
+
+MeshLightSource::MeshLightSource(const std::vector<Triangle*> &triangles_) :
+    LightSource(LIGHT_MESH), triangles(triangles_), totalArea(0.0), averageNormal(0.0)
+{
+    update();
+}
+
+void MeshLightSource::update()
+{
+    totalArea = 0.0;
+    averageNormal = Vector3D(0.0);
+    cdf.clear();
+    cdf.reserve(triangles.size());
+    for (const Triangle* t : triangles)
+    {
+        double area = t->getArea();
+        totalArea += area;
+        averageNormal += t->normal * area;
+        cdf.push_back(totalArea);
+    }
+
+    for (double &c : cdf)
+        c /= totalArea;
+    if (!cdf.empty())
+        cdf.back() = 1.0;
+
+    if (averageNormal.lengthSq() > 0.0)
+        averageNormal = averageNormal.normalized();
+}
+
+// An empty mesh emits nothing
+Vector3D MeshLightSource::getIntensity() const
+{
+    if (triangles.empty())
+        return Vector3D(0.0);
+    return triangles[0]->getMaterial().getEmissiveRadiance();
+}
+
+// Lambertian emitter: Phi = pi * Le * area
+double MeshLightSource::getPower() const
+{
+    Vector3D Le = getIntensity();
+    return PI * (Le.x + Le.y + Le.z) / 3.0 * totalArea;
+}
+
+// Union of the bounds of the triangles, each emitting around its normal
+LightBounds MeshLightSource::getLightBounds() const
+{
+    Vector3D Le = getIntensity();
+    double radiance = PI * (Le.x + Le.y + Le.z) / 3.0;
+
+    LightBounds lb;
+    for (const Triangle* t : triangles)
+        lb = LightBounds::merge(lb, LightBounds::planar(t->getBounds(), t->normal, radiance * t->getArea()));
+    return lb;
+}
+
+size_t MeshLightSource::chooseTriangle(double &u) const
+{
+    size_t i = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+    i = std::min(i, cdf.size() - 1);
+
+    double start = i > 0 ? cdf[i - 1] : 0.0;
+    double width = cdf[i] - start;
+    u = width > 0.0 ? std::min((u - start) / width, 1.0) : 0.0;
+    return i;
+}
+
+Vector3D MeshLightSource::sampleLightPosition() const
+{
+    if (triangles.empty())
+        return Vector3D(0.0);
+    double u1 = (double)rand() / RAND_MAX;
+    double u2 = (double)rand() / RAND_MAX;
+    size_t i = chooseTriangle(u1);
+    return triangles[i]->samplePoint(u1, u2);
+}
+
+Vector3D MeshLightSource::sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                              Vector3D &lightNormal, double &pdf) const
+{
+    if (triangles.empty())
+    {
+        lightNormal = Vector3D(0.0);
+        pdf = 0.0;
+        return Vector3D(0.0);
+    }
+
+    // Reuse u1 to sample the triangle
+    size_t i = chooseTriangle(u1);
+    lightNormal = triangles[i]->normal;
+    pdf = 1.0 / totalArea;
+    return triangles[i]->samplePoint(u1, u2);
+}
+
+double MeshLightSource::getPdf(const Vector3D &x, const Vector3D &y) const
+{
+    return totalArea > 0.0 ? 1.0 / totalArea : 0.0;
+}
+
+// Uniform point, and cosine weighted direction around the normal of its
+// triangle
+bool MeshLightSource::samplePhoton(double u1, double u2, double u3, double u4,
+                                   Vector3D &y, Vector3D &normal, Vector3D &w, Vector3D &power) const
+{
+    if (triangles.empty())
+        return false;
+
+    size_t i = chooseTriangle(u1);
+    y = triangles[i]->samplePoint(u1, u2);
+    normal = triangles[i]->normal.normalized();
+    w = Utils::sampleCosineHemisphere(normal, u3, u4);
+    power = getIntensity() * (PI * totalArea);
+    return true;
+}
@@ -0,0 +1,51 @@
+#ifndef MESHLIGHTSOURCE_H
+#define MESHLIGHTSOURCE_H
+
+#include <vector>
+
+#include "../shapes/triangle.h"
+#include "lightsource.h"
+
+// Emissive set of triangles (usually a TriangleMesh) treated as one light.
+// A triangle is chosen with the cumulative distribution of the areas and a
+// point is then sampled uniformly on it, so the points are uniform over the
+// whole surface
+class MeshLightSource final : public LightSource
+{
+public:
+    MeshLightSource() = delete;
+
+    MeshLightSource(const std::vector<Triangle*> &triangles_);
+
+    Vector3D getIntensity() const;
+    Vector3D sampleLightPosition() const;
+    Vector3D sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                 Vector3D &lightNormal, double &pdf) const;
+    double getPdf(const Vector3D &x, const Vector3D &y) const;
+    bool samplePhoton(double u1, double u2, double u3, double u4,
+                      Vector3D &y, Vector3D &normal, Vector3D &w, Vector3D &power) const;
+    double getPower() const;
+    LightBounds getLightBounds() const;
+
+    // Areas and normals of the triangles
+    void update();
+
+    double getArea() const { return totalArea; };
+
+    // Area weighted average of the normals of the triangles (see
+    // sampleLightPosition for the normal at a point)
+    Vector3D getNormal() const { return averageNormal; };
+
+private:
+    // Index of the triangle for u in [0,1], and u remapped to [0,1] inside it
+    size_t chooseTriangle(double &u) const;
+
+    std::vector<Triangle*> triangles;
+
+    // cdf[i] = area of the triangles before i + 1 over the total area
+    std::vector<double> cdf;
+    double totalArea;
+    Vector3D averageNormal;
+};
+
+#endif // MESHLIGHTSOURCE_H
@@ -2,27 +2,54 @@
 #define POINTLIGHTSOURCE_H
 
 #include "../core/vector3d.h"
+#include "../core/utils.h"
 #include "lightsource.h"
 
 
-class PointLightSource : public LightSource
+class PointLightSource final : public LightSource
 {
 public:
     PointLightSource() = delete;
     PointLightSource(Vector3D pos_, Vector3D intensity_) :
-        pos(pos_), intensity(intensity_)
+        LightSource(LIGHT_POINT), pos(pos_), intensity(intensity_)
     { }
 
 
 
     Vector3D getIntensity() const { return intensity; };
     Vector3D sampleLightPosition() const { return pos; };
+    Vector3D sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                 Vector3D &lightNormal, double &pdf) const {
+        lightNormal = Vector3D(0.0);
+        pdf = 1.0;
+        return pos;
+    };
+    double getPdf(const Vector3D &x, const Vector3D &y) const { return 1.0; };
+
+    // Uniform direction: power = I * 4 pi
+    bool samplePhoton(double u1, double u2, double u3, double u4,
+                      Vector3D &y, Vector3D &normal, Vector3D &w, Vector3D &power) const {
+        y = pos;
+        normal = Vector3D(0.0);
+        w = Utils::sampleUniformSphere(u1, u2);
+        power = intensity * (4.0 * 3.14159265358979323846);
+        return true;
+    };
 
     ////A point light emits light uniformly in all directions
     //Its Area is zero and have no Normal
     double getArea() const { return 0.0; };              
     Vector3D getNormal() const { return Vector3D(0.0); };
 
+    // Phi = 4 * pi * I
+    double getPower() const {
+        return 4.0 * 3.14159265358979323846 * (intensity.x + intensity.y + intensity.z) / 3.0;
+    };
+
+    LightBounds getLightBounds() const {
+        return LightBounds::omnidirectional(pos, getPower());
+    };
+
 private:
     Vector3D pos;
     Vector3D intensity; // (unity: watts/sr)
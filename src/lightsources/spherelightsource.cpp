@@ -0,0 +1,149 @@
+#include "spherelightsource.h"
+#include "../core/utils.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+#define PI 3.14159265358979323846
+
+// Below this value of sin^2(thetaMax), 1 - cos(thetaMax) is computed with
+// its Taylor expansion to avoid the cancellation for far spheres
+#define SMALL_CONE_SIN2 0.00068523
+
+SphereLightSource::SphereLightSource(Sphere* sphereLightsource_) :
+    LightSource(LIGHT_SPHERE), mySphereLightsource(sphereLightsource_)
+{
+    update();
+}
+
+void SphereLightSource::update()
+{
+    center = mySphereLightsource->getCenterWorld();
+    radius = mySphereLightsource->getRadiusWorld();
+}
+
+Vector3D SphereLightSource::getIntensity() const
+{
+    return mySphereLightsource->getMaterial().getEmissiveRadiance();
+}
+
+double SphereLightSource::getArea() const
+{
+    return 4.0 * PI * radius * radius;
+}
+
+// Lambertian emitter: Phi = pi * Le * area
+double SphereLightSource::getPower() const
+{
+    Vector3D Le = getIntensity();
+    return PI * (Le.x + Le.y + Le.z) / 3.0 * getArea();
+}
+
+// A sphere emits in every direction from every part of its bounds
+LightBounds SphereLightSource::getLightBounds() const
+{
+    LightBounds lb = LightBounds::omnidirectional(center, getPower());
+    lb.bounds = mySphereLightsource->getBounds();
+    return lb;
+}
+
+// Uniform point on the sphere
+Vector3D SphereLightSource::sampleLightPosition() const
+{
+    double z = 1.0 - 2.0 * ((double)rand() / RAND_MAX);
+    double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+    double phi = 2.0 * PI * ((double)rand() / RAND_MAX);
+    return center + Vector3D(r * std::cos(phi), r * std::sin(phi), z) * radius;
+}
+
+// Orthonormal vectors t, b perpendicular to the unit vector w
+static void coordinateSystem(const Vector3D &w, Vector3D &t, Vector3D &b)
+{
+    t = std::abs(w.x) > 0.9 ? Vector3D(0, 1, 0) : Vector3D(1, 0, 0);
+    t = cross(w, t).normalized();
+    b = cross(w, t);
+}
+
+Vector3D SphereLightSource::sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                                Vector3D &lightNormal, double &pdf) const
+{
+    Vector3D toCenter = center - x;
+    double dc2 = toCenter.lengthSq();
+    double r2 = radius * radius;
+
+    // From inside, any point of the sphere can be seen: sample by area
+    if (dc2 <= r2)
+    {
+        double z = 1.0 - 2.0 * u1;
+        double r = std::sqrt(std::max(0.0, 1.0 - z * z));
+        double phi = 2.0 * PI * u2;
+        lightNormal = Vector3D(r * std::cos(phi), r * std::sin(phi), z);
+        pdf = 1.0 / getArea();
+        return center + lightNormal * radius;
+    }
+
+    // Direction inside the cone subtended by the sphere
+    double sin2ThetaMax = r2 / dc2;
+    double cosThetaMax = std::sqrt(std::max(0.0, 1.0 - sin2ThetaMax));
+    double oneMinusCosThetaMax = 1.0 - cosThetaMax;
+
+    double cosTheta = (cosThetaMax - 1.0) * u1 + 1.0;
+    double sin2Theta = 1.0 - cosTheta * cosTheta;
+    if (sin2ThetaMax < SMALL_CONE_SIN2)
+    {
+        sin2Theta = sin2ThetaMax * u1;
+        cosTheta = std::sqrt(1.0 - sin2Theta);
+        oneMinusCosThetaMax = sin2ThetaMax / 2.0;
+    }
+
+    // Angle alpha, at the center, between the direction to x and the point
+    double dc = std::sqrt(dc2);
+    double cosAlpha = sin2Theta / std::sqrt(sin2ThetaMax) +
+                      cosTheta * std::sqrt(std::max(0.0, 1.0 - sin2Theta / sin2ThetaMax));
+    double sinAlpha = std::sqrt(std::max(0.0, 1.0 - cosAlpha * cosAlpha));
+    double phi = 2.0 * PI * u2;
+
+    Vector3D wc = toCenter / dc;
+    Vector3D wcX, wcY;
+    coordinateSystem(wc, wcX, wcY);
+    lightNormal = -(wcX * (sinAlpha * std::cos(phi)) + wcY * (sinAlpha * std::sin(phi)) + wc * cosAlpha);
+    Vector3D y = center + lightNormal * radius;
+
+    // pdf = 1 / cone solid angle, per unit area
+    Vector3D L = y - x;
+    double distance2 = L.lengthSq();
+    double cosY = std::abs(dot(lightNormal, L)) / std::sqrt(distance2);
+    pdf = cosY / (2.0 * PI * oneMinusCosThetaMax * distance2);
+    return y;
+}
+
+double SphereLightSource::getPdf(const Vector3D &x, const Vector3D &y) const
+{
+    double dc2 = (center - x).lengthSq();
+    double r2 = radius * radius;
+    if (dc2 <= r2)
+        return 1.0 / getArea();
+
+    double sin2ThetaMax = r2 / dc2;
+    double oneMinusCosThetaMax = sin2ThetaMax < SMALL_CONE_SIN2 ? sin2ThetaMax / 2.0 :
+                                 1.0 - std::sqrt(std::max(0.0, 1.0 - sin2ThetaMax));
+
+    Vector3D lightNormal = (y - center) / radius;
+    Vector3D L = y - x;
+    double distance2 = L.lengthSq();
+    if (distance2 <= 0.0)
+        return 0.0;
+    double cosY = std::abs(dot(lightNormal, L)) / std::sqrt(distance2);
+    return cosY / (2.0 * PI * oneMinusCosThetaMax * distance2);
+}
+
+// Uniform point, and cosine weighted direction around the normal there
+bool SphereLightSource::samplePhoton(double u1, double u2, double u3, double u4,
+                                     Vector3D &y, Vector3D &normal, Vector3D &w, Vector3D &power) const
+{
+    normal = Utils::sampleUniformSphere(u1, u2);
+    y = center + normal * radius;
+    w = Utils::sampleCosineHemisphere(normal, u3, u4);
+    power = getIntensity() * (PI * getArea());
+    return true;
+}
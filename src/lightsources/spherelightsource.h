@@ -0,0 +1,41 @@
+#ifndef SPHERELIGHTSOURCE_H
+#define SPHERELIGHTSOURCE_H
+
+#include "../shapes/sphere.h"
+#include "lightsource.h"
+
+// Emissive sphere (with a uniform scale). Seen from outside, it is sampled
+// uniformly inside the cone of directions it subtends, so that every sample
+// lands on the visible cap
+class SphereLightSource final : public LightSource
+{
+public:
+    SphereLightSource() = delete;
+
+    SphereLightSource(Sphere* sphereLightsource);
+
+    Vector3D getIntensity() const;
+    Vector3D sampleLightPosition() const;
+    Vector3D sampleLightPosition(const Vector3D &x, double u1, double u2,
+                                 Vector3D &lightNormal, double &pdf) const;
+    double getPdf(const Vector3D &x, const Vector3D &y) const;
+    bool samplePhoton(double u1, double u2, double u3, double u4,
+                      Vector3D &y, Vector3D &normal, Vector3D &w, Vector3D &power) const;
+    double getPower() const;
+    LightBounds getLightBounds() const;
+
+    double getArea() const;
+
+    // Center and radius of the sphere
+    void update();
+
+    // The normal depends on the point: see sampleLightPosition
+    Vector3D getNormal() const { return Vector3D(0.0); };
+
+private:
+    Sphere* mySphereLightsource;
+    Vector3D center;
+    double radius;
+};
+
+#endif // SPHERELIGHTSOURCE_H
@@ -6,10 +6,19 @@
 #include "core/ray.h"
 #include "core/utils.h"
 #include "core/scene.h"
+#include "core/renderer.h"
+#include "core/denoiser.h"
+#include "core/exrwriter.h"
+#include "core/ldrwriter.h"
+#include "core/coordinator.h"
+#include "core/previewserver.h"
+#include "core/animation.h"
+#include "core/progressivephotonmapper.h"
 
 
 #include "shapes/sphere.h"
 #include "shapes/infiniteplan.h"
+#include "shapes/trianglemesh.h"
 
 #include "cameras/ortographic.h"
 #include "cameras/perspective.h"
@@ -26,6 +35,9 @@
 #include "shaders/areadirect-DOF.h"
 #include "shaders/neeDOF.h"
 #include "shaders/areadirectMB.h"
+#include "shaders/photonmapper.h"
+#include "shaders/bdpt.h"
+#include "shaders/integratorkernel.h"
 
 
 #include "materials/phong.h"
@@ -41,7 +53,7 @@ typedef std::chrono::duration<double, std::milli> durationMs;
 
 
 void buildSceneCornellBox(Camera*& cam, Film*& film,
-    Scene myScene)
+    Scene& myScene)
 {
     /* **************************** */
 /* Declare and place the camera */
@@ -118,10 +130,11 @@ void buildSceneCornellBox(Camera*& cam, Film*& film,
     //PointLightSource* thirdLight = new PointLightSource(Vector3D(-2.0, 2.5, 3.0), Vector3D(0.0, 0.0, 2.0));
     //myScene.AddPointLight(thirdLight);
 
+    myScene.buildBVH();
 }
 
 //void buildSceneCornellBox2(Camera*& cam, Film*& film,
-//    Scene myScene)
+//    Scene& myScene)
 //{
 //    /* **************************** */
 ///* Declare and place the camera */
@@ -185,7 +198,7 @@ void buildSceneCornellBox(Camera*& cam, Film*& film,
 //    myScene.AddObject(s2);
 //    myScene.AddObject(square);
 //}
-void buildSceneDepthOfField(Camera*& cam, Film*& film, Scene myScene)
+void buildSceneDepthOfField(Camera*& cam, Film*& film, Scene& myScene)
 {
     /* **************************** */
     /* Declare and place the camera */
@@ -248,10 +261,15 @@ void buildSceneDepthOfField(Camera*& cam, Film*& film, Scene myScene)
     Matrix4x4 t4 = Matrix4x4::translate(Vector3D(1.5, -1, 14));
     Shape* s4 = new Sphere(radius, t4, goldGlossy);
     myScene.AddObject(s4);
+
+    myScene.buildBVH();
 }
 
 
-void buildMotionBlurScene(Camera*& cam, Film*& film, Scene myScene)
+// ballVelocity: desplazamiento de las bolas pequeñas durante el obturador
+// [0, 1] (motion blur por objeto). Con velocidad 0 la escena es estática
+void buildMotionBlurScene(Camera*& cam, Film*& film, Scene& myScene,
+    const Vector3D& ballVelocity)
 {
     /* **************************** */
    /* Cámara */
@@ -345,14 +363,199 @@ void buildMotionBlurScene(Camera*& cam, Film*& film, Scene myScene)
     for (const auto& b : balls) {
         Matrix4x4 t = Matrix4x4::translate(Vector3D(b.p.x, -offset + b.r, b.p.z));
         Shape* s = new Sphere(b.r, t, b.m);
+        if (b.r <= 1.0 && ballVelocity.lengthSq() > 0.0) {
+            s->addKeyframe(0.0, Matrix4x4());
+            s->addKeyframe(1.0, Matrix4x4::translate(ballVelocity));
+        }
         myScene.AddObject(s);
     }
 
+    myScene.buildBVH();
+}
+
+// A glowing sphere and a glowing triangle mesh (an octahedron) next to a
+// diffuse tetrahedron, on a floor against a back wall
+void buildSceneEmitterShapes(Camera*& cam, Film*& film, Scene& myScene)
+{
+    Matrix4x4 cameraToWorld = Matrix4x4::translate(Vector3D(0.0, 0.5, -5.0));
+    double fovRadians = Utils::degreesToRadians(60);
+    cam = new PerspectiveCamera(cameraToWorld, fovRadians, *film);
+
+    Material* greyDiffuse = new Phong(Vector3D(0.8, 0.8, 0.8), Vector3D(0.0), 100);
+    Material* blueGlossy = new Phong(Vector3D(0.2, 0.3, 0.8), Vector3D(0.6, 0.6, 0.6), 50);
+    Material* warmEmissive = new Emissive(Vector3D(8.0, 6.0, 3.0), Vector3D(0.0));
+    Material* coldEmissive = new Emissive(Vector3D(2.0, 4.0, 8.0), Vector3D(0.0));
+
+    myScene.AddObject(new InfinitePlan(Vector3D(0, -1, 0), Vector3D(0, 1, 0), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, 0, 6), Vector3D(0, 0, -1), greyDiffuse));
+
+    // Sampled by the cone it subtends
+    myScene.AddObject(new Sphere(0.4, Matrix4x4::translate(Vector3D(-1.8, 1.5, 3.0)), warmEmissive));
+
+    // Sampled by area, one triangle chosen by its area each time
+    std::vector<Vector3D> octahedron = {
+        Vector3D(1, 0, 0), Vector3D(-1, 0, 0), Vector3D(0, 1, 0),
+        Vector3D(0, -1, 0), Vector3D(0, 0, 1), Vector3D(0, 0, -1) };
+    std::vector<int> octahedronFaces = {
+        0, 2, 4,  2, 1, 4,  1, 3, 4,  3, 0, 4,
+        2, 0, 5,  1, 2, 5,  3, 1, 5,  0, 3, 5 };
+    Matrix4x4 octahedronTransform = Matrix4x4::translate(Vector3D(1.8, 1.2, 3.5)) *
+                                    Matrix4x4::scale(Vector3D(0.5, 0.5, 0.5));
+    myScene.AddMesh(new TriangleMesh(octahedron, octahedronFaces, octahedronTransform, coldEmissive));
+
+    std::vector<Vector3D> tetrahedron = {
+        Vector3D(0, 1, 0), Vector3D(-1, -1, -1), Vector3D(1, -1, -1), Vector3D(0, -1, 1) };
+    std::vector<int> tetrahedronFaces = { 0, 2, 1,  0, 3, 2,  0, 1, 3,  1, 2, 3 };
+    myScene.AddMesh(new TriangleMesh(tetrahedron, tetrahedronFaces,
+                                     Matrix4x4::translate(Vector3D(0.0, 0.0, 3.0)), blueGlossy));
+
+    myScene.buildBVH();
+}
+
+// Closed room lit by a small lamp which faces a wall, out of the view: all
+// the light in the image bounced on that wall first. The glass ball is only
+// lit through the room
+void buildSceneIndirectLight(Camera*& cam, Film*& film, Scene& myScene)
+{
+    Matrix4x4 cameraToWorld = Matrix4x4::translate(Vector3D(0.0, 0.0, -3.0));
+    double fovRadians = Utils::degreesToRadians(60);
+    cam = new PerspectiveCamera(cameraToWorld, fovRadians, *film);
+
+    Material* redDiffuse = new Phong(Vector3D(0.7, 0.2, 0.3), Vector3D(0.0), 100);
+    Material* greenDiffuse = new Phong(Vector3D(0.2, 0.7, 0.3), Vector3D(0.0), 100);
+    Material* greyDiffuse = new Phong(Vector3D(0.8, 0.8, 0.8), Vector3D(0.0), 100);
+    Material* glass = new Transmissive(0.7);
+    Material* lamp = new Emissive(Vector3D(120.0), Vector3D(0.0));
+
+    double offset = 3.0;
+    myScene.AddObject(new InfinitePlan(Vector3D(-offset - 1, 0, 0), Vector3D(1, 0, 0), redDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(offset + 1, 0, 0), Vector3D(-1, 0, 0), greenDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, offset, 0), Vector3D(0, -1, 0), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, -offset, 0), Vector3D(0, 1, 0), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, 0, 3 * offset), Vector3D(0, 0, -1), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, 0, -offset - 1), Vector3D(0, 0, 1), greyDiffuse));
+
+    myScene.AddObject(new Sphere(1.0, Matrix4x4::translate(Vector3D(-1.5, -offset + 1.0, 5.0)), glass));
+    myScene.AddObject(new Square(Vector3D(offset + 0.4, 2.2, 0.7), Vector3D(0.0, 0.6, 0.0),
+                                 Vector3D(0.0, 0.0, 0.6), Vector3D(1.0, 0.0, 0.0), lamp));
+
+    myScene.buildBVH();
+}
+
+// Room lit by a lamp on the other side of a partition: its light only
+// comes in through a narrow slit, on the right of the view
+void buildSceneLightThroughSlit(Camera*& cam, Film*& film, Scene& myScene)
+{
+    Matrix4x4 cameraToWorld = Matrix4x4::translate(Vector3D(0.0, 0.0, -3.0));
+    double fovRadians = Utils::degreesToRadians(60);
+    cam = new PerspectiveCamera(cameraToWorld, fovRadians, *film);
+
+    Material* redDiffuse = new Phong(Vector3D(0.7, 0.2, 0.3), Vector3D(0.0), 100);
+    Material* blueDiffuse = new Phong(Vector3D(0.2, 0.3, 0.8), Vector3D(0.0), 100);
+    Material* greyDiffuse = new Phong(Vector3D(0.8, 0.8, 0.8), Vector3D(0.0), 100);
+    Material* lamp = new Emissive(Vector3D(300.0), Vector3D(0.0));
+
+    double offset = 3.0;
+    myScene.AddObject(new InfinitePlan(Vector3D(-offset - 1, 0, 0), Vector3D(1, 0, 0), redDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(offset + 1, 0, 0), Vector3D(-1, 0, 0), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, offset, 0), Vector3D(0, -1, 0), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, -offset, 0), Vector3D(0, 1, 0), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, 0, 3 * offset), Vector3D(0, 0, -1), greyDiffuse));
+    myScene.AddObject(new InfinitePlan(Vector3D(0, 0, -offset - 1), Vector3D(0, 0, 1), greyDiffuse));
+
+    // Partition at x = 1.5, open between z = 3.0 and z = 3.3
+    myScene.AddObject(new Square(Vector3D(1.5, -offset, -offset - 1), Vector3D(0.0, 2 * offset, 0.0),
+                                 Vector3D(0.0, 0.0, 7.0), Vector3D(-1.0, 0.0, 0.0), greyDiffuse));
+    myScene.AddObject(new Square(Vector3D(1.5, -offset, 3.3), Vector3D(0.0, 2 * offset, 0.0),
+                                 Vector3D(0.0, 0.0, 3 * offset - 3.3), Vector3D(-1.0, 0.0, 0.0), greyDiffuse));
+
+    myScene.AddObject(new Sphere(1.0, Matrix4x4::translate(Vector3D(-1.5, -offset + 1.0, 5.0)), blueDiffuse));
+    myScene.AddObject(new Square(Vector3D(2.2, offset - 0.01, 2.55), Vector3D(1.2, 0.0, 0.0),
+                                 Vector3D(0.0, 0.0, 1.2), Vector3D(0.0, -1.0, 0.0), lamp));
+
+    myScene.buildBVH();
+}
+
+// A few spheres on a floor under an environment light. Without a file, the
+// sky is a blue gradient with a small, bright sun
+void buildSceneEnvironment(Camera*& cam, Film*& film, Scene& myScene,
+    const std::string& envFilename)
+{
+    Matrix4x4 cameraToWorld = Matrix4x4::translate(Vector3D(0.0, 0.5, -6.0));
+    double fovRadians = Utils::degreesToRadians(60);
+    cam = new PerspectiveCamera(cameraToWorld, fovRadians, *film);
+
+    Material* greyDiffuse = new Phong(Vector3D(0.6, 0.6, 0.6), Vector3D(0.0), 100);
+    Material* redGlossy = new Phong(Vector3D(0.8, 0.2, 0.2), Vector3D(0.5, 0.5, 0.5), 60);
+    Material* mirror = new Mirror();
+
+    myScene.AddObject(new InfinitePlan(Vector3D(0, -1, 0), Vector3D(0, 1, 0), greyDiffuse));
+    myScene.AddObject(new Sphere(1.0, Matrix4x4::translate(Vector3D(-1.3, 0.0, 2.0)), redGlossy));
+    myScene.AddObject(new Sphere(1.0, Matrix4x4::translate(Vector3D(1.3, 0.0, 3.0)), mirror));
+
+    EnvironmentLight* environment;
+    if (!envFilename.empty())
+    {
+        environment = new EnvironmentLight(envFilename);
+    }
+    else
+    {
+        int width = 256, height = 128;
+        std::vector<Vector3D> sky(width * height);
+        for (int v = 0; v < height; v++)
+        {
+            double t = (v + 0.5) / height;    // 0 at the zenith, 1 at the nadir
+            for (int u = 0; u < width; u++)
+            {
+                bool sun = std::abs(u - 80) <= 2 && std::abs(v - 30) <= 2;
+                sky[v * width + u] = sun ? Vector3D(5000.0, 4500.0, 4000.0) :
+                                     t < 0.5 ? Vector3D(0.4, 0.6, 1.0) * (1.5 - t) : Vector3D(0.2, 0.2, 0.2);
+            }
+        }
+        environment = new EnvironmentLight(width, height, sky);
+    }
+    myScene.AddEnvironmentLight(environment);
+
+    myScene.buildBVH();
+}
+
+// A floor with a few spheres lit by a grid of small emissive panels of
+// different colors hanging at different heights
+void buildSceneManyLights(Camera*& cam, Film*& film, Scene& myScene,
+    int lightsPerSide)
+{
+    Matrix4x4 cameraToWorld = Matrix4x4::translate(Vector3D(0.0, 1.0, -6.0));
+    double fovRadians = Utils::degreesToRadians(60);
+    cam = new PerspectiveCamera(cameraToWorld, fovRadians, *film);
+
+    Material* floorMaterial = new Phong(Vector3D(0.6, 0.6, 0.6), Vector3D(0.2, 0.2, 0.2), 40);
+    Material* redGlossy = new Phong(Vector3D(0.8, 0.2, 0.2), Vector3D(0.5, 0.5, 0.5), 60);
+    Material* whiteDiffuse = new Phong(Vector3D(0.8, 0.8, 0.8), Vector3D(0.0), 1);
+
+    myScene.AddObject(new InfinitePlan(Vector3D(0, -1, 0), Vector3D(0, 1, 0), floorMaterial));
+    myScene.AddObject(new Sphere(1.0, Matrix4x4::translate(Vector3D(-1.5, 0.0, 4.0)), redGlossy));
+    myScene.AddObject(new Sphere(1.0, Matrix4x4::translate(Vector3D(1.5, 0.0, 6.0)), whiteDiffuse));
+
+    // Panels over a 40 x 40 area, facing down
+    double size = 40.0 / lightsPerSide;
+    for (int i = 0; i < lightsPerSide; i++)
+    {
+        for (int j = 0; j < lightsPerSide; j++)
+        {
+            Vector3D color(0.5 + 0.5 * ((i + j) % 3 == 0), 0.5 + 0.5 * ((i + j) % 3 == 1), 0.5 + 0.5 * ((i + j) % 3 == 2));
+            Material* emissive = new Emissive(color * 20.0, Vector3D(0.0));
+            Vector3D corner(-20.0 + i * size, 4.0 + 2.0 * ((i * 7 + j * 3) % 5) / 5.0, -10.0 + j * size);
+            myScene.AddObject(new Square(corner, Vector3D(0.3 * size, 0, 0), Vector3D(0, 0, 0.3 * size),
+                                         Vector3D(0.0, -1.0, 0.0), emissive));
+        }
+    }
+
+    myScene.buildBVH();
 }
 
 
 void buildSceneSphere(Camera*& cam, Film*& film,
-    Scene myScene)
+    Scene& myScene)
 {
     /* **************************** */
       /* Declare and place the camera */
@@ -391,10 +594,11 @@ void buildSceneSphere(Camera*& cam, Film*& film,
     myScene.AddObject(s2);
     myScene.AddObject(s3);
 
+    myScene.buildBVH();
 }
 
 void raytrace(Camera*& cam, Shader*& shader, Film*& film,
-    std::vector<Shape*>*& objectsList, std::vector<LightSource*>*& lightSourceList)
+    const Scene& scene)
 {
 
     double my_PI = 0.0;
@@ -423,7 +627,7 @@ void raytrace(Camera*& cam, Shader*& shader, Film*& film,
             Vector3D pixelColor = Vector3D(0.0);
 
             // Compute ray color according to the used shader
-            pixelColor += shader->computeColor(cameraRay, *objectsList, *lightSourceList);
+            pixelColor += shader->computeColor(cameraRay, scene);
 
             // Store the pixel color
             film->setPixelValue(col, lin, pixelColor);
@@ -435,7 +639,7 @@ void raytrace(Camera*& cam, Shader*& shader, Film*& film,
 
 // Path Tracing Algorithm with multiple samples per pixel (spp)
 void raytracePathTracer(Camera*& cam, Shader*& shader, Film*& film,
-    std::vector<Shape*>*& objectsList, std::vector<LightSource*>*& lightSourceList, int spp)
+    const Scene& scene, int spp)
 {
     unsigned int sizeBar = 40;
 
@@ -456,9 +660,14 @@ void raytracePathTracer(Camera*& cam, Shader*& shader, Film*& film,
 
             for (int s = 0; s < spp; s++) //iterate over the number of samples
             {
-                Ray cameraRay = cam->generateRay(x, y);
-
-                pixelColor += shader->computeColor(cameraRay, *objectsList, *lightSourceList);
+                // Random lens and shutter samples for the camera depth of
+                // field and motion blur
+                double lensU = (double)rand() / RAND_MAX;
+                double lensV = (double)rand() / RAND_MAX;
+                double time = (double)rand() / RAND_MAX;
+                Ray cameraRay = cam->generateRay(x, y, lensU, lensV, time);
+
+                pixelColor += shader->computeColor(cameraRay, scene);
             }
 
             pixelColor = pixelColor / (double)spp;
@@ -515,6 +724,11 @@ int main()
     Shader* DOFshader = new AreaDirectDOF(bgColor, 10, 10.21f, 0.5f);
     Shader* MBshader = new AreaDirectMB(bgColor, 260, 40, cameraVelocity); //Change 5 to 40
 
+    // Settings of the compile-time specialized kernels (same values as the shaders above)
+    KernelSettings kernelSettings;
+    kernelSettings.bgColor = bgColor;
+    kernelSettings.numLightSamples = 10;
+
 
     // Build the scene---------------------------------------------------------
     Camera* cam;
@@ -523,9 +737,9 @@ int main()
 
 	// ------------------------------- Motion Blur Scene -------------------------//
 
-    buildMotionBlurScene(cam, film, myScene); 
+    buildMotionBlurScene(cam, film, myScene, Vector3D(0.0)); 
     auto start = high_resolution_clock::now();
-    raytrace(cam, MBshader, film, myScene.objectsList, myScene.LightSourceList);
+    raytrace(cam, MBshader, film, myScene);
 
 
 	//------------------------------- Depth of Field with Area Direct -------------------------//
@@ -534,7 +748,258 @@ int main()
 	//buildSceneDepthOfField(cam, film, myScene);
  //   auto start = high_resolution_clock::now();
  //   int spp = 20;
- //   raytracePathTracer(cam, DOFshader, film, myScene.objectsList, myScene.LightSourceList, spp);
+ //   raytracePathTracer(cam, DOFshader, film, myScene, spp);
+
+	//------------------------------- Camera depth of field and motion blur -------------------------//
+	// The lens and the shutter belong to the camera, so any shader gets them
+	// by taking several samples per pixel
+
+
+	//buildSceneDepthOfField(cam, film, myScene);
+ //   cam->setThinLens(0.5, 10.21);                     // aperture radius, focus distance
+ //   cam->setShutter(0.0, 1.0, cameraVelocity);        // both effects can be combined
+ //   auto start = high_resolution_clock::now();
+ //   Shader* areaShader = new AreaDirect(bgColor, 4);
+ //   raytracePathTracer(cam, areaShader, film, myScene, 64);
+
+	//------------------------------- Object motion blur -------------------------//
+	// The small balls move during the shutter; each path takes one time sample
+
+
+	//buildMotionBlurScene(cam, film, myScene, Vector3D(1.5, 0.0, 0.0));
+ //   cam->setShutter(0.0, 1.0, Vector3D(0.0));
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   raytracePathTracer(cam, &nee, film, myScene, 64);
+
+	//------------------------------- Many lights -------------------------//
+	// 1024 emitters; the light BVH picks the ones which matter for each point
+
+
+	//buildSceneManyLights(cam, film, myScene, 32);
+ //   myScene.lightSelection = LIGHT_SELECTION_BVH; // or LIGHT_SELECTION_POWER
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   raytracePathTracer(cam, &nee, film, myScene, 16);
+
+	//------------------------------- Emissive spheres and meshes -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   raytracePathTracer(cam, &nee, film, myScene, 16);
+
+	//------------------------------- Environment light -------------------------//
+	// Pass the path of a latitude-longitude EXR, or "" for a procedural sky
+
+
+	//buildSceneEnvironment(cam, film, myScene, "");
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   raytracePathTracer(cam, &nee, film, myScene, 16);
+
+	//------------------------------- Specialized kernels -------------------------//
+	// KERNEL_AREADIRECT_DOF, KERNEL_AREADIRECT_MB or KERNEL_NEE_DOF, chosen once here
+
+
+	//buildSceneDepthOfField(cam, film, myScene);
+ //   cam->setThinLens(0.5, 10.21);
+ //   auto start = high_resolution_clock::now();
+ //   renderKernel(KERNEL_AREADIRECT_DOF, kernelSettings, *cam, myScene, *film, 60);
+
+	//------------------------------- NEE with material-sorted shading -------------------------//
+
+
+	//buildMotionBlurScene(cam, film, myScene, Vector3D(0.0));
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   renderer.sortByMaterial = true; // shade the hits of each tile grouped by material
+ //   renderer.render(*film, 16);
+
+	//------------------------------- AOVs in the same pass -------------------------//
+	// output.exr gets the albedo, normal, depth, direct, indirect, samples and variance layers
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   Renderer::addLayers(*film);
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   renderer.render(*film, 16);
+
+	//------------------------------- Tiled EXR written while rendering -------------------------//
+	// PIZ compressed 32x32 tiles, each one compressed and written when its pixels are done
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   Renderer::addLayers(*film);
+ //   auto start = high_resolution_clock::now();
+ //   EXRWriter writer("output-tiled.exr", *film);
+ //   writer.compression = EXR_PIZ_COMPRESSION;
+ //   writer.tileSize = 32;
+ //   writer.open();
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   renderer.render(*film, 16, &writer);
+ //   writer.close();
+
+	//------------------------------- Tone-mapped PNG written while rendering -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   LDRWriter png("output.png", *film);
+ //   png.toneMapper.toneMapping = TONEMAP_ACES;
+ //   png.toneMapper.gamma = 2.2;
+ //   png.toneMapper.dither = true;
+ //   png.open();
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   renderer.render(*film, 16, &png);
+ //   png.close();
+
+	//------------------------------- Checkpointed render -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   Accumulator accumulation(film->getWidth(), film->getHeight());
+ //   accumulation.load("render.ckpt");
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   renderer.checkpointFile = "render.ckpt";
+ //   renderer.checkpointInterval = 60.0;
+ //   renderer.renderPasses(accumulation, 64 - (int)accumulation.getPassCount(), 1);
+ //   accumulation.resolve(*film);
+
+	//------------------------------- Render on local worker processes -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   Accumulator accumulation(film->getWidth(), film->getHeight());
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   RenderCoordinator coordinator(renderer);
+ //   coordinator.numWorkers = 8;
+ //   coordinator.renderPasses(accumulation, 64, 1);
+ //   accumulation.resolve(*film);
+
+	//------------------------------- Interactive preview (http://localhost:8080/) -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   PreviewServer preview(*cam, nee, myScene, *film);
+ //   preview.addShader("dof", *DOFshader);
+ //   preview.toneMapper.gamma = 2.2;
+ //   preview.run();
+
+	//------------------------------- Animation sequence -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   Animation animation(*cam, myScene);
+ //   animation.addCameraKeyframe(0, Matrix4x4::translate(Vector3D(-1.0, 0.5, -5.0)));
+ //   animation.addCameraKeyframe(47, Matrix4x4::translate(Vector3D(1.0, 0.5, -5.0)));
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   animation.render(renderer, *film, 16, 0, 47, "frame%04d.png");
+
+	//------------------------------- Animation with temporal reuse -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   Animation animation(*cam, myScene);
+ //   animation.addCameraKeyframe(0, Matrix4x4::translate(Vector3D(-1.0, 0.5, -5.0)));
+ //   animation.addCameraKeyframe(47, Matrix4x4::translate(Vector3D(1.0, 0.5, -5.0)));
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   TemporalAccumulator temporal;
+ //   animation.render(renderer, *film, 2, 0, 47, "frame%04d.png", &temporal);
+
+	//------------------------------- Irradiance cache -------------------------//
+	// A 1 spp overture pass places the records, the final pass interpolates them
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   IrradianceCache cache;
+ //   NEE cachedNEE(bgColor, 4);
+ //   cachedNEE.irradianceCache = &cache;
+ //   Renderer renderer(*cam, cachedNEE, myScene);
+ //   renderer.render(*film, 1);
+ //   renderer.render(*film, 16);
+
+	//------------------------------- Photon mapping -------------------------//
+	// Caustic of the point light through the mirror square, which NEE never finds
+
+
+	//buildSceneCornellBox(cam, film, myScene);
+ //   PhotonMapper photonMapper(bgColor, 4);
+ //   photonMapper.emitPhotons(myScene);
+ //   auto start = high_resolution_clock::now();
+ //   Renderer renderer(*cam, photonMapper, myScene);
+ //   renderer.render(*film, 16);
+
+	//------------------------------- Progressive photon mapping -------------------------//
+	// Same caustic, converging as iterations are added, in a fixed memory
+
+
+	//buildSceneCornellBox(cam, film, myScene);
+ //   ProgressivePhotonMapper sppm(*cam, myScene);
+ //   sppm.bgColor = bgColor;
+ //   auto start = high_resolution_clock::now();
+ //   sppm.render(*film, 64);
+
+	//------------------------------- Bidirectional path tracing -------------------------//
+	// NEE finds no direct light in this room: in the same time (56 spp) its error is about 5x that of BDPT
+
+
+	//buildSceneIndirectLight(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   BDPT bdpt(bgColor, 5); // Paths as long as those of the NEE below
+ //   Renderer renderer(*cam, bdpt, myScene);
+ //   renderer.render(*film, 16);
+ //   Film neeFilm(film->getWidth(), film->getHeight());
+ //   NEE nee(bgColor, 4);
+ //   Renderer(*cam, nee, myScene).render(neeFilm, 56);
+ //   neeFilm.save("output_nee.bmp");
+
+	//------------------------------- Path guiding -------------------------//
+	// Training passes of 1 to 8 spp, then the guided pass: ~2.5x less variance than without the guide, in 1.3x the time
+
+
+	//buildSceneLightThroughSlit(cam, film, myScene);
+ //   auto start = high_resolution_clock::now();
+ //   PathGuide guide;
+ //   NEE guidedNEE(bgColor, 4);
+ //   guidedNEE.pathGuide = &guide;
+ //   Renderer renderer(*cam, guidedNEE, myScene);
+ //   for (int spp = 1; spp <= 8; spp *= 2)
+ //   {
+ //       Film training(film->getWidth(), film->getHeight());
+ //       renderer.render(training, spp);
+ //       guide.update();
+ //   }
+ //   guide.learning = false;
+ //   renderer.render(*film, 16);
+
+	//------------------------------- Denoised render with AOVs -------------------------//
+
+
+	//buildSceneEmitterShapes(cam, film, myScene);
+ //   Renderer::addLayers(*film);
+ //   auto start = high_resolution_clock::now();
+ //   NEE nee(bgColor, 4);
+ //   Renderer renderer(*cam, nee, myScene);
+ //   renderer.render(*film, 8);
+ //   Denoiser().denoise(*film);
 
 	//-----------------------------------------------------------------------------------------//
 
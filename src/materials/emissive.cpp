@@ -32,3 +32,13 @@ Vector3D Emissive::getDiffuseReflectance() const
 {
     return rho_d;
 }
+
+MaterialRecord Emissive::getRecord() const
+{
+    MaterialRecord rec;
+    rec.type = MAT_EMISSIVE;
+    rec.flags = MAT_DIFFUSE_OR_GLOSSY | MAT_EMISSION;
+    rec.rho_d = rho_d;
+    rec.Ke = Ke;
+    return rec;
+}
@@ -2,6 +2,7 @@
 #define MATERIAL
 
 #include "../core/vector3d.h"
+#include "materialrecord.h"
 
 class Material
 {
@@ -21,6 +22,9 @@ public:
     virtual bool hasDiffuseOrGlossy() const = 0;
     virtual bool isEmissive() const = 0;
 
+    // Return the flat copy of the material used by the shaders
+    virtual MaterialRecord getRecord() const = 0;
+
 
     
 };
@@ -0,0 +1,72 @@
+#ifndef MATERIALRECORD_H
+#define MATERIALRECORD_H
+
+#include <cmath>
+
+#include "../core/vector3d.h"
+
+enum MaterialType : unsigned char
+{
+    MAT_PHONG,
+    MAT_EMISSIVE,
+    MAT_MIRROR,
+    MAT_TRANSMISSIVE
+};
+
+// Bits of MaterialRecord::flags
+enum MaterialFlags : unsigned char
+{
+    MAT_DIFFUSE_OR_GLOSSY = 1 << 0,
+    MAT_SPECULAR          = 1 << 1,
+    MAT_TRANSMISSION      = 1 << 2,
+    MAT_EMISSION          = 1 << 3
+};
+
+// Flat, non-virtual copy of a Material built once when the object is added
+// to the scene. The classification functions are a single test on "flags"
+// and the BRDF is evaluated with a switch on "type", so everything can be
+// inlined in the shaders.
+struct MaterialRecord
+{
+    MaterialType  type = MAT_PHONG;
+    unsigned char flags = 0;
+    float    alpha = 0;   // Phong exponent
+    float    muT = -1;    // Index of refraction (transmissive only)
+    Vector3D rho_d;       // Diffuse reflectance
+    Vector3D Ks;          // Specular reflectance (Phong only)
+    Vector3D Ke;          // Emitted radiance (emissive only)
+
+    bool hasSpecular() const { return (flags & MAT_SPECULAR) != 0; }
+    bool hasTransmission() const { return (flags & MAT_TRANSMISSION) != 0; }
+    bool hasDiffuseOrGlossy() const { return (flags & MAT_DIFFUSE_OR_GLOSSY) != 0; }
+    bool isEmissive() const { return (flags & MAT_EMISSION) != 0; }
+    bool isPurelyDiffuse() const
+    {
+        return hasDiffuseOrGlossy() && Ks.x == 0 && Ks.y == 0 && Ks.z == 0;
+    }
+
+    double getIndexOfRefraction() const { return muT; }
+    Vector3D getEmissiveRadiance() const { return Ke; }
+    Vector3D getDiffuseReflectance() const { return rho_d; }
+
+    // Same BRDFs as Phong::getReflectance and Emissive::getReflectance
+    Vector3D getReflectance(const Vector3D &n, const Vector3D &wo,
+                            const Vector3D &wi) const
+    {
+        switch (type)
+        {
+        case MAT_PHONG:
+        {
+            Vector3D wr = 2 * dot(n, wi) * n - wi;
+            return (rho_d / 3.14159265359) +
+                   ((alpha + 2) / (2 * 3.14159265359)) * Ks * std::pow(dot(wo, wr), alpha);
+        }
+        case MAT_EMISSIVE:
+            return rho_d / 3.1416;
+        default:
+            return Vector3D(0.0);
+        }
+    }
+};
+
+#endif // MATERIALRECORD_H
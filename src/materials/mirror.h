@@ -19,6 +19,13 @@ public:
     Vector3D getDiffuseReflectance() const override { return Vector3D(0.0); }
 	Vector3D getEmissiveRadiance() const override { return Vector3D(0.0); }
 
+    MaterialRecord getRecord() const override {
+        MaterialRecord rec;
+        rec.type = MAT_MIRROR;
+        rec.flags = MAT_SPECULAR;
+        return rec;
+    }
+
 };
 
 #endif // MIRROR_MATERIAL_H
\ No newline at end of file
@@ -64,3 +64,14 @@ Vector3D Phong::getDiffuseReflectance() const
     return rho_d;
 }
 
+MaterialRecord Phong::getRecord() const
+{
+    MaterialRecord rec;
+    rec.type = MAT_PHONG;
+    rec.flags = MAT_DIFFUSE_OR_GLOSSY;
+    rec.rho_d = rho_d;
+    rec.Ks = Ks;
+    rec.alpha = alpha;
+    return rec;
+}
+
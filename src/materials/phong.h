@@ -21,6 +21,8 @@ public:
     Vector3D getEmissiveRadiance() const;
     Vector3D getDiffuseReflectance() const;
 
+    MaterialRecord getRecord() const;
+
 
 private:
     Vector3D rho_d;
@@ -19,6 +19,14 @@ public:
     Vector3D getDiffuseReflectance() const override { return Vector3D(0.0); }
     double getIndexOfRefraction() const override { return muT; }
 
+    MaterialRecord getRecord() const override {
+        MaterialRecord rec;
+        rec.type = MAT_TRANSMISSIVE;
+        rec.flags = MAT_TRANSMISSION;
+        rec.muT = (float)muT;
+        return rec;
+    }
+
 private:
 	double muT; // ndice de refraccin 
 };
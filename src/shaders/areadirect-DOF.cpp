@@ -21,8 +21,7 @@ AreaDirectDOF::AreaDirectDOF(Vector3D bgColor_, int numSamples_, float focalLeng
 }
 
 Vector3D AreaDirectDOF::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     // CRTICO: Solo aplicar DOF en rayos primarios (depth == 0)
     if (r.depth == 0)
@@ -77,8 +76,8 @@ Vector3D AreaDirectDOF::computeColor(const Ray& r,
             Vector3D newDirection = (focalPoint - randomPosition).normalized();
 
             // Crear rayo modificado con depth=1 para evitar re-aplicar DOF
-            Ray modifiedRay(randomPosition, newDirection, 1);
-            color += computeColorInternal(modifiedRay, objList, lsList);
+            Ray modifiedRay(randomPosition, newDirection, 1, Epsilon, INFINITY, r.time);
+            color += computeColorInternal(modifiedRay, scene);
         }
 
         // Promediar todas las muestras
@@ -87,13 +86,12 @@ Vector3D AreaDirectDOF::computeColor(const Ray& r,
     else
     {
         // Para rayos secundarios (reflexiones, refracciones), NO aplicar DOF
-        return computeColorInternal(r, objList, lsList);
+        return computeColorInternal(r, scene);
     }
 }
 
 Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     // Lmite de profundidad para evitar recursin infinita
     if (r.depth > MAX_DEPTH)
@@ -102,12 +100,12 @@ Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
     }
 
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its))
+    if (!Utils::getClosestIntersection(r, scene, its))
     {
-        return bgColor;
+        return getBackground(r, scene);
     }
 
-    const Material& material = its.shape->getMaterial();
+    const MaterialRecord& material = scene.getMaterial(its);
     Vector3D n = its.normal.normalized();
     Vector3D wo = (-r.d).normalized();
 
@@ -125,10 +123,9 @@ Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
         Vector3D Ldir(0.0);
 
         // iterate over area light sources
-        for (auto areaLight : lsList)
+        for (auto areaLight : *scene.LightSourceList)
         {
             Vector3D Le = areaLight->getIntensity();
-            Vector3D lightNormal = areaLight->getNormal();
             double lightArea = areaLight->getArea();
 
             // Manejar luces puntuales (rea = 0)
@@ -146,8 +143,8 @@ Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
 
                     if (ndotwi > 0.0)
                     {
-                        Ray shadowRay(its.itsPoint, wi, r.depth, Epsilon, distance - Epsilon);
-                        bool isVisible = !Utils::hasIntersection(shadowRay, objList);
+                        Ray shadowRay(its.itsPoint, wi, r.depth, Epsilon, distance - Epsilon, r.time);
+                        bool isVisible = !Utils::hasIntersection(shadowRay, scene);
 
                         if (isVisible)
                         {
@@ -159,15 +156,19 @@ Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
                 continue;
             }
 
-            double pdf = 1.0 / lightArea;
-
             // Reducir samples para rayos secundarios (optimizacin)
             int effectiveSamples = (r.depth <= 1) ? numSamples : std::max(1, numSamples / 10);
 
             for (int i = 0; i < effectiveSamples; i++)
             {
-                // sample a random point on the light source
-                Vector3D y = areaLight->sampleLightPosition();
+                // sample a point on the light source, by the solid angle it
+                // subtends from the hit point
+                Vector3D lightNormal;
+                double pdf;
+                Vector3D y = areaLight->sampleLightPosition(its.itsPoint, (double)rand() / RAND_MAX,
+                                                            (double)rand() / RAND_MAX, lightNormal, pdf);
+                if (pdf <= 0.0) continue;
+                Vector3D Ly = areaLight->getRadiance(y, its.itsPoint - y);
 
                 // direction from hit point to light sample
                 Vector3D L = y - its.itsPoint;
@@ -187,13 +188,13 @@ Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
                 double G = (ndotwi * lndotwi) / (distance * distance);
 
                 // check visibility V(x,y)
-                Ray shadowRay(its.itsPoint, wi, r.depth, Epsilon, distance - Epsilon);
-                bool isVisible = !Utils::hasIntersection(shadowRay, objList);
+                Ray shadowRay(its.itsPoint, wi, r.depth, Epsilon, distance - Epsilon, r.time);
+                bool isVisible = !Utils::hasIntersection(shadowRay, scene);
 
                 if (isVisible && G > 0.0)
                 {
                     Vector3D refl = material.getReflectance(n, wo, wi);
-                    Ldir += Le * refl * G / pdf;
+                    Ldir += Ly * refl * G / pdf;
                 }
             }
 
@@ -219,8 +220,8 @@ Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
         if (material.hasSpecular())
         {
             Vector3D wr = (2 * dot(n, wo) * n - wo).normalized();
-            Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1);
-            color += computeColorInternal(reflRay, objList, lsList);
+            Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+            color += computeColorInternal(reflRay, scene);
         }
 
         // transmission (Transmissive)
@@ -240,15 +241,15 @@ Vector3D AreaDirectDOF::computeColorInternal(const Ray& r,
             if (radicand >= 0)
             {
                 Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized();
-                Ray refrRay(its.itsPoint - n1 * Epsilon, wt, r.depth + 1);
-                color += computeColorInternal(refrRay, objList, lsList);
+                Ray refrRay(its.itsPoint - n1 * Epsilon, wt, r.depth + 1, Epsilon, INFINITY, r.time);
+                color += computeColorInternal(refrRay, scene);
             }
             else
             {
                 // Total internal reflection
                 Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
-                Ray reflRay(its.itsPoint + n1 * Epsilon, wr, r.depth + 1);
-                color += computeColorInternal(reflRay, objList, lsList);
+                Ray reflRay(its.itsPoint + n1 * Epsilon, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+                color += computeColorInternal(reflRay, scene);
             }
         }
     }
@@ -10,8 +10,7 @@ public:
     AreaDirectDOF(Vector3D bgColor_, int numSamples_, float focalLength, float sensorWidth );
 
     Vector3D computeColor(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 
 private:
     int numSamples;
@@ -19,8 +18,7 @@ private:
     //---------------------------------------	// Focal length and sensor width (for depth of field)
 
     Vector3D computeColorInternal(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
     
     float focalLength;
     float sensorWidth;
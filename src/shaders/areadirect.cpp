@@ -14,16 +14,15 @@ AreaDirect::AreaDirect(Vector3D bgColor_, int numSamples_)
 { }
 
 Vector3D AreaDirect::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its))
+    if (!Utils::getClosestIntersection(r, scene, its))
     {
-        return bgColor;
+        return getBackground(r, scene);
     }
 
-    const Material& material = its.shape->getMaterial();
+    const MaterialRecord& material = scene.getMaterial(its);
     Vector3D n = its.normal.normalized();
     Vector3D wo = (-r.d).normalized(); 
 
@@ -40,50 +39,56 @@ Vector3D AreaDirect::computeColor(const Ray& r,
         // direct illumination via area light sampling
         Vector3D Ldir(0.0);
 
-		// iterate over area light sources
-        for (auto areaLight : lsList)
+		// numSamples light samples in total: each one picks a light (see
+		// Scene::sampleLight), so the cost does not grow with the number
+		// of lights
+        for (int i = 0; i < numSamples; i++)
         {
+            double lightPmf;
+            const LightSource* areaLight = scene.sampleLight(its.itsPoint, n, (double)rand() / RAND_MAX, lightPmf);
+            if (areaLight == nullptr || lightPmf <= 0.0)
+                break;
+
+            Vector3D lightNormal;
+
+            // sample a point on the light source, by the solid angle it
+            // subtends from the hit point
+            double areaPdf;
+            Vector3D y = areaLight->sampleLightPosition(its.itsPoint, (double)rand() / RAND_MAX,
+                                                        (double)rand() / RAND_MAX, lightNormal, areaPdf);
+            if (areaPdf <= 0.0) continue;
+            double pdf = lightPmf * areaPdf; // pmf(light) * pdf(y)
+            Vector3D Le = areaLight->getRadiance(y, its.itsPoint - y);
+
+            // direction from hit point to light sample
+            Vector3D L = y - its.itsPoint;
+            double distance = L.length();
+            
+            if (distance <= 0.0) continue;
+
+			Vector3D wi = L / distance; //noramalized direction to light
 
-            Vector3D Le = areaLight->getIntensity();
-            Vector3D lightNormal = areaLight->getNormal();
-            double lightArea = areaLight->getArea();
-            double pdf = 1.0 / lightArea; // Uniform sampling PDF
+            // compute G(x, y) following the formula
+            double G = (dot(n, wi) * dot(lightNormal, -wi)) / (distance * distance);
 
-            for (int i = 0; i < numSamples; i++)
+            // check visibility V(x,y)
+            Ray shadowRay(its.itsPoint, wi, 0.0, Epsilon, distance - Epsilon, r.time);
+			bool isVisible = !Utils::hasIntersection(shadowRay, scene); // 1 if visible, 0 if blocked
+
+            double V_s;
+            if (isVisible) {
+                V_s = 1.0; // light reaches the point
+            }
+            else {
+                V_s = 0.0; // blocked, in shadow
+            }
+
+			if (G > 0.0) // only consider positive contributions
             {
-                // sample a random point on the light source
-                Vector3D y = areaLight->sampleLightPosition();
-
-                // direction from hit point to light sample
-                Vector3D L = y - its.itsPoint;
-                double distance = L.length();
-                
-                if (distance <= 0.0) continue;
-
-				Vector3D wi = L / distance; //noramalized direction to light
-
-                // compute G(x, y) following the formula
-                double G = (dot(n, wi) * dot(lightNormal, -wi)) / (distance * distance);
-
-                // check visibility V(x,y)
-                Ray shadowRay(its.itsPoint, wi, 0.0, Epsilon, distance - Epsilon);
-				bool isVisible = !Utils::hasIntersection(shadowRay, objList); // 1 if visible, 0 if blocked
-
-                double V_s;
-                if (isVisible) {
-                    V_s = 1.0; // light reaches the point
-                }
-                else {
-                    V_s = 0.0; // blocked, in shadow
-                }
-
-				if (G > 0.0) // only consider positive contributions
-                {
-                    Vector3D refl = material.getReflectance(n, wo, wi);
-
-                    // Le * reflectance * G* V / pdf
-                    Ldir += Le * refl * G* V_s / pdf;
-                }
+                Vector3D refl = material.getReflectance(n, wo, wi);
+
+                // Le * reflectance * G* V / pdf
+                Ldir += Le * refl * G* V_s / pdf;
             }
         }
 
@@ -102,8 +107,8 @@ Vector3D AreaDirect::computeColor(const Ray& r,
     if (material.hasSpecular())
     {
         Vector3D wr = (2 * dot(n, wo) * n - wo).normalized();
-        Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1);
-        color += computeColor(reflRay, objList, lsList);
+        Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+        color += computeColor(reflRay, scene);
     }
 
     // transmission (Transmissive)
@@ -123,15 +128,15 @@ Vector3D AreaDirect::computeColor(const Ray& r,
         if (radicand >= 0)
         {
             Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized();
-            Ray refrRay(its.itsPoint - n1 * Epsilon, wt, r.depth + 1);
-            color += computeColor(refrRay, objList, lsList);
+            Ray refrRay(its.itsPoint - n1 * Epsilon, wt, r.depth + 1, Epsilon, INFINITY, r.time);
+            color += computeColor(refrRay, scene);
         }
         else
         {
             
             Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
-            Ray reflRay(its.itsPoint + n1 * Epsilon, wr, r.depth + 1);
-            color += computeColor(reflRay, objList, lsList);
+            Ray reflRay(its.itsPoint + n1 * Epsilon, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+            color += computeColor(reflRay, scene);
         }
     }
 
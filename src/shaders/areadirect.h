@@ -10,8 +10,7 @@ public:
     AreaDirect(Vector3D bgColor_, int numSamples_);
 
     Vector3D computeColor(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 
 private:
     int numSamples;
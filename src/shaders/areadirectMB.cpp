@@ -15,8 +15,7 @@ AreaDirectMB::AreaDirectMB(Vector3D bgColor_, int numSamples_, int numTimeSample
 { }
 
 Vector3D AreaDirectMB::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     // Motion blur by averaging multiple time samples
     Vector3D finalColor(0.0);
@@ -28,25 +27,24 @@ Vector3D AreaDirectMB::computeColor(const Ray& r,
         
         // Offset ray origin by camera velocity * time
         Vector3D offset = cameraVelocity * time;
-        Ray offsetRay(r.o + offset, r.d, r.depth);
+        Ray offsetRay(r.o + offset, r.d, r.depth, Epsilon, INFINITY, time);
         
-        finalColor += computeDirectIllumination(offsetRay, objList, lsList);
+        finalColor += computeDirectIllumination(offsetRay, scene);
     }
     
     return finalColor / (double)numTimeSamples;
 }
 
 Vector3D AreaDirectMB::computeDirectIllumination(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its))
+    if (!Utils::getClosestIntersection(r, scene, its))
     {
-        return bgColor;
+        return getBackground(r, scene);
     }
 
-    const Material& material = its.shape->getMaterial();
+    const MaterialRecord& material = scene.getMaterial(its);
     Vector3D n = its.normal.normalized();
     Vector3D wo = (-r.d).normalized();
 
@@ -61,17 +59,19 @@ Vector3D AreaDirectMB::computeDirectIllumination(const Ray& r,
     if (material.hasDiffuseOrGlossy())
     {
         // Direct illumination from area lights
-        for (auto areaLight : lsList)
+        for (auto areaLight : *scene.LightSourceList)
         {
             Vector3D Ldir(0.0);
-            Vector3D Le = areaLight->getIntensity();
-            Vector3D lightNormal = areaLight->getNormal();
-            double lightArea = areaLight->getArea();
-            double pdf = 1.0 / lightArea;
 
             for (int s = 0; s < numSamples; s++)
             {
-                Vector3D y = areaLight->sampleLightPosition();
+                Vector3D lightNormal;
+                double pdf;
+                Vector3D y = areaLight->sampleLightPosition(its.itsPoint, (double)rand() / RAND_MAX,
+                                                            (double)rand() / RAND_MAX, lightNormal, pdf);
+                if (pdf <= 0.0)
+                    continue;
+                Vector3D Le = areaLight->getRadiance(y, its.itsPoint - y);
                 Vector3D L = y - its.itsPoint;
                 double distance = L.length();
 
@@ -81,8 +81,8 @@ Vector3D AreaDirectMB::computeDirectIllumination(const Ray& r,
                 Vector3D wi = L / distance;
                 double G = (dot(n, wi) * dot(lightNormal, -wi)) / (distance * distance);
 
-                Ray shadowRay(its.itsPoint, wi, 0.0, Epsilon, distance - Epsilon);
-                bool isVisible = !Utils::hasIntersection(shadowRay, objList);
+                Ray shadowRay(its.itsPoint, wi, 0.0, Epsilon, distance - Epsilon, r.time);
+                bool isVisible = !Utils::hasIntersection(shadowRay, scene);
 
                 if (G > 0.0 && isVisible)
                 {
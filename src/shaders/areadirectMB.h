@@ -12,8 +12,7 @@ public:
                  const Vector3D& cameraVelocity_);
 
     Vector3D computeColor(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 
 private:
     int numSamples;          // Light samples
@@ -21,8 +20,7 @@ private:
     Vector3D cameraVelocity; // Camera movement per time unit
     
     Vector3D computeDirectIllumination(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 };
 
 #endif // AREADIRECTMB_H
@@ -0,0 +1,414 @@
+#include "bdpt.h"
+#include "../core/utils.h"
+
+#include <algorithm>
+
+#define PI 3.14159265358979323846
+
+// Density per unit area at "to" of a direction leaving "from" with
+// density pdfDir (per unit solid angle)
+static double toAreaDensity(double pdfDir, const Vector3D& from, const Vector3D& to,
+    const Vector3D& toNormal)
+{
+    Vector3D d = to - from;
+    double distance2 = d.lengthSq();
+    if (distance2 <= 0.0)
+        return 0.0;
+    Vector3D w = d / std::sqrt(distance2);
+    double cosTo = toNormal.lengthSq() > 0.0 ? std::abs(dot(toNormal, w)) : 1.0;
+    return pdfDir * cosTo / distance2;
+}
+
+// Density of the direction w emitted by a light at a point with normal n:
+// cosine weighted, or uniform for point lights
+static double emissionPdf(const Vector3D& n, const Vector3D& w)
+{
+    if (n.lengthSq() <= 0.0)
+        return 1.0 / (4.0 * PI);
+    return std::max(0.0, dot(n, w)) / PI;
+}
+
+// Zero densities come from the specular vertices, which cancel out in the
+// ratios of the MIS weight
+static double remap0(double pdf)
+{
+    return pdf != 0.0 ? pdf : 1.0;
+}
+
+BDPT::BDPT()
+    : BDPT(Vector3D(0.0), 4)
+{ }
+
+BDPT::BDPT(Vector3D bgColor_, int maxDepth_)
+    : Shader(bgColor_), maxDepth(maxDepth_)
+{ }
+
+Vector3D BDPT::computeColor(const Ray& r,
+    const Scene& scene) const
+{
+    Intersection its;
+    if (!Utils::getClosestIntersection(r, scene, its))
+    {
+        return getBackground(r, scene);
+    }
+
+    return shadeHit(r, its, scene.getMaterial(its), scene);
+}
+
+Vector3D BDPT::shadeHit(const Ray& r, const Intersection& its,
+    const MaterialRecord& material,
+    const Scene& scene) const
+{
+    // Camera subpath, from the lens (vertex 0)
+    std::vector<PathVertex> cameraPath;
+    cameraPath.reserve(maxDepth + 2);
+    cameraPath.push_back({ r.o, Vector3D(0.0), nullptr, nullptr, 0.0, Vector3D(1.0), 0.0, 0.0, false });
+
+    Ray ray = r;
+    Vector3D beta(1.0);
+    bool escaped = randomWalk(cameraPath, ray, beta, 0.0, maxDepth + 2, false, &its, scene);
+
+    std::vector<PathVertex> lightPath;
+    lightPath.reserve(maxDepth + 1);
+    traceLightPath(lightPath, r.time, scene);
+
+    Vector3D L(0.0);
+    if (escaped)
+        L += beta * getBackground(ray, scene);
+
+    // The paths have s + t <= maxDepth + 2 vertices
+    MisBuffers buffers;
+    buffers.pL.resize(maxDepth + 2);
+    buffers.pC.resize(maxDepth + 2);
+    buffers.delta.resize(maxDepth + 2);
+
+    for (size_t t = 2; t <= cameraPath.size(); t++)
+    {
+        for (size_t s = 0; s <= std::max(lightPath.size(), (size_t)1); s++)
+        {
+            if ((int)(s + t) - 2 > maxDepth)
+                break;
+            L += connect(lightPath, cameraPath, s, t, r.time, buffers, scene);
+        }
+    }
+
+    return L;
+}
+
+bool BDPT::randomWalk(std::vector<PathVertex>& path, Ray& ray, Vector3D& beta, double pdfDir,
+    size_t maxVertices, bool lightSubpath, const Intersection* firstHit,
+    const Scene& scene) const
+{
+    while (path.size() < maxVertices)
+    {
+        Intersection its;
+        if (firstHit != nullptr)
+        {
+            its = *firstHit;
+            firstHit = nullptr;
+        }
+        else if (!Utils::getClosestIntersection(ray, scene, its))
+        {
+            return true;
+        }
+
+        const MaterialRecord& material = scene.getMaterial(its);
+        PathVertex vertex;
+        vertex.p = its.itsPoint;
+        vertex.n = its.normal.normalized();
+        vertex.material = &material;
+        vertex.light = nullptr;
+        vertex.lightPdf = 0.0;
+        if (material.isEmissive())
+        {
+            int lightIndex = scene.getLightIndex(its.shape);
+            if (lightIndex >= 0)
+            {
+                vertex.light = (*scene.LightSourceList)[lightIndex];
+                vertex.lightPdf = scene.lightSampler.getPmf(lightIndex) / vertex.light->getArea();
+            }
+        }
+        vertex.beta = beta;
+        vertex.pdfFwd = toAreaDensity(pdfDir, path.back().p, vertex.p, vertex.n);
+        vertex.pdfRev = 0.0;
+        vertex.delta = !material.hasDiffuseOrGlossy();
+        path.push_back(vertex);
+
+        if (path.size() >= maxVertices)
+            break;
+
+        // Next direction, and the density of the way back to the previous
+        // vertex
+        PathVertex& current = path.back();
+        PathVertex& previous = path[path.size() - 2];
+        Vector3D wo = (-ray.d).normalized();
+        Ray next;
+        double pdfRevDir;
+        if (material.hasDiffuseOrGlossy())
+        {
+            // Cosine weighted on the side it came from: brdf * cos / pdf = brdf * pi
+            Vector3D nf = dot(current.n, wo) < 0 ? -current.n : current.n;
+            Vector3D wi = Utils::sampleCosineHemisphere(nf, (double)rand() / RAND_MAX,
+                                                        (double)rand() / RAND_MAX);
+            double cosI = dot(nf, wi);
+            if (cosI <= 0.0)
+                break;
+
+            beta = beta * material.getReflectance(nf, wo, wi) * PI;
+            if (beta.x <= 0.0 && beta.y <= 0.0 && beta.z <= 0.0)
+                break;
+
+            next = Ray(current.p, wi, ray.depth + 1, Epsilon, INFINITY, ray.time);
+            pdfDir = cosI / PI;
+            pdfRevDir = dot(nf, wo) / PI;
+        }
+        else
+        {
+            if (!Utils::scatterSpecular(material, current.p, current.n, ray.d, ray.depth + 1, ray.time, next))
+                break;
+
+            // The shaders carry the radiance through glass unchanged, not
+            // scaled by the squared ratio of the indices of refraction, so
+            // the light subpaths carry the flux times that ratio to match
+            if (lightSubpath && dot(next.d, current.n) * dot(ray.d, current.n) > 0.0)
+            {
+                double muT = material.getIndexOfRefraction();
+                if (dot(ray.d, current.n) > 0.0)
+                    muT = 1.0 / muT;
+                beta = beta * (muT * muT);
+            }
+            pdfDir = 0.0;
+            pdfRevDir = 0.0;
+        }
+        previous.pdfRev = toAreaDensity(pdfRevDir, current.p, previous.p, previous.n);
+
+        ray = next;
+    }
+
+    return false;
+}
+
+void BDPT::traceLightPath(std::vector<PathVertex>& path, double time,
+    const Scene& scene) const
+{
+    // Light chosen by its power, then a point and a direction as for a
+    // photon. The environment emits no photons
+    double pmf;
+    const LightSource* light = scene.lightSampler.sample((double)rand() / RAND_MAX, pmf);
+    if (light == nullptr || pmf <= 0.0 || light == scene.environmentLight)
+        return;
+
+    double u1 = (double)rand() / RAND_MAX, u2 = (double)rand() / RAND_MAX;
+    double u3 = (double)rand() / RAND_MAX, u4 = (double)rand() / RAND_MAX;
+    Vector3D y, n, w, power;
+    if (!light->samplePhoton(u1, u2, u3, u4, y, n, w, power))
+        return;
+
+    double area = light->getArea();
+    double pdfPos = area > 0.0 ? 1.0 / area : 1.0;
+    path.push_back({ y, n, nullptr, light, pmf * pdfPos, light->getRadiance(y, w) / (pmf * pdfPos),
+                     pmf * pdfPos, 0.0, false });
+
+    Ray ray(y, w, 0, Epsilon, INFINITY, time);
+    Vector3D beta = power / pmf;
+    randomWalk(path, ray, beta, emissionPdf(n, w), maxDepth + 1, true, nullptr, scene);
+}
+
+Vector3D BDPT::connect(const std::vector<PathVertex>& lightPath,
+    const std::vector<PathVertex>& cameraPath, size_t s, size_t t,
+    double time, MisBuffers& buffers, const Scene& scene) const
+{
+    const PathVertex& pt = cameraPath[t - 1];
+    const PathVertex& ptMinus = cameraPath[t - 2];
+    Vector3D wo = (ptMinus.p - pt.p).normalized();
+
+    // The camera subpath hits an emitter. The lights only emit on the side
+    // of their normal, and the emitters which are not lights are found by
+    // no other strategy
+    if (s == 0)
+    {
+        if (!pt.material->isEmissive())
+            return Vector3D(0.0);
+        Vector3D L = pt.beta * pt.material->getEmissiveRadiance();
+        if (pt.light == nullptr)
+            return L;
+        if (dot(pt.n, wo) <= 0.0)
+            return Vector3D(0.0);
+        return L * misWeight(lightPath, cameraPath, s, t, nullptr, buffers);
+    }
+
+    if (pt.delta)
+        return Vector3D(0.0);
+    Vector3D nf = dot(pt.n, wo) < 0 ? -pt.n : pt.n;
+
+    // A point of a light sampled from pt
+    if (s == 1)
+    {
+        double pmf;
+        int lightIndex = scene.lightSampler.sampleIndex((double)rand() / RAND_MAX, pmf);
+        if (lightIndex < 0 || pmf <= 0.0)
+            return Vector3D(0.0);
+        const LightSource* light = (*scene.LightSourceList)[lightIndex];
+        if (light == scene.environmentLight)
+            return Vector3D(0.0);
+
+        Vector3D lightNormal;
+        double areaPdf;
+        Vector3D y = light->sampleLightPosition(pt.p, (double)rand() / RAND_MAX,
+                                                (double)rand() / RAND_MAX, lightNormal, areaPdf);
+        Vector3D d = y - pt.p;
+        double distance = d.length();
+        if (areaPdf <= 0.0 || distance <= 0.0)
+            return Vector3D(0.0);
+        Vector3D wi = d / distance;
+
+        // Point lights have no normal
+        double cosY = lightNormal.lengthSq() > 0.0 ? dot(lightNormal, -wi) : 1.0;
+        double cosX = dot(nf, wi);
+        if (cosY <= 0.0 || cosX <= 0.0)
+            return Vector3D(0.0);
+
+        Ray shadowRay(pt.p, wi, 0, Epsilon, distance - Epsilon, time);
+        if (Utils::hasIntersection(shadowRay, scene))
+            return Vector3D(0.0);
+
+        double area = light->getArea();
+        double lightPdf = pmf * (area > 0.0 ? 1.0 / area : 1.0);
+        PathVertex sampled = { y, lightNormal, nullptr, light, lightPdf,
+                               light->getRadiance(y, -wi) / (pmf * areaPdf), lightPdf, 0.0, false };
+        Vector3D L = pt.beta * pt.material->getReflectance(nf, wo, wi) * sampled.beta *
+                     (cosX * cosY / (distance * distance));
+        return L * misWeight(lightPath, cameraPath, s, t, &sampled, buffers);
+    }
+
+    // A vertex of the light subpath seen from pt
+    const PathVertex& qs = lightPath[s - 1];
+    const PathVertex& qsMinus = lightPath[s - 2];
+    if (qs.delta)
+        return Vector3D(0.0);
+
+    Vector3D d = qs.p - pt.p;
+    double distance = d.length();
+    if (distance <= 0.0)
+        return Vector3D(0.0);
+    Vector3D wi = d / distance;
+
+    Vector3D woQ = (qsMinus.p - qs.p).normalized();
+    Vector3D nfQ = dot(qs.n, woQ) < 0 ? -qs.n : qs.n;
+    double cosX = dot(nf, wi);
+    double cosQ = dot(nfQ, -wi);
+    if (cosX <= 0.0 || cosQ <= 0.0)
+        return Vector3D(0.0);
+
+    Vector3D L = qs.beta * qs.material->getReflectance(nfQ, woQ, -wi) *
+                 pt.material->getReflectance(nf, wo, wi) * pt.beta *
+                 (cosX * cosQ / (distance * distance));
+    if (L.x <= 0.0 && L.y <= 0.0 && L.z <= 0.0)
+        return Vector3D(0.0);
+
+    Ray shadowRay(pt.p, wi, 0, Epsilon, distance - Epsilon, time);
+    if (Utils::hasIntersection(shadowRay, scene))
+        return Vector3D(0.0);
+
+    return L * misWeight(lightPath, cameraPath, s, t, nullptr, buffers);
+}
+
+double BDPT::misWeight(const std::vector<PathVertex>& lightPath,
+    const std::vector<PathVertex>& cameraPath, size_t s, size_t t,
+    const PathVertex* sampled, MisBuffers& buffers) const
+{
+    // The whole path x_0 .. x_k, from the light to the camera, with the
+    // densities of each vertex when generated from the light side (pL) and
+    // from the camera side (pC)
+    size_t k = s + t - 1;
+    std::vector<double>& pL = buffers.pL;
+    std::vector<double>& pC = buffers.pC;
+    std::vector<bool>& delta = buffers.delta;
+    for (size_t j = 0; j < s; j++)
+    {
+        const PathVertex& v = (j == 0 && sampled != nullptr) ? *sampled : lightPath[j];
+        pL[j] = v.pdfFwd;
+        pC[j] = v.pdfRev;
+        delta[j] = v.delta;
+    }
+    for (size_t m = 0; m < t; m++)
+    {
+        const PathVertex& v = cameraPath[m];
+        pL[k - m] = v.pdfRev;
+        pC[k - m] = v.pdfFwd;
+        delta[k - m] = v.delta;
+    }
+
+    // The densities around the connection, which the subpaths did not know
+    const PathVertex& pt = cameraPath[t - 1];
+    const PathVertex& ptMinus = cameraPath[t - 2];
+    auto scatterPdf = [](const PathVertex& from, const PathVertex& at, const PathVertex& to) {
+        if (at.material == nullptr)
+            return toAreaDensity(emissionPdf(at.n, (to.p - at.p).normalized()), at.p, to.p, to.n);
+        if (at.delta)
+            return 0.0;
+        Vector3D wo = (from.p - at.p).normalized();
+        Vector3D nf = dot(at.n, wo) < 0 ? -at.n : at.n;
+        double cosI = std::max(0.0, dot(nf, (to.p - at.p).normalized()));
+        return toAreaDensity(cosI / PI, at.p, to.p, to.n);
+    };
+
+    bool deltaLight;
+    if (s == 0)
+    {
+        // pt is on a light, emitting towards ptMinus
+        pL[0] = pt.lightPdf;
+        pL[1] = toAreaDensity(emissionPdf(pt.n, (ptMinus.p - pt.p).normalized()), pt.p,
+                              ptMinus.p, ptMinus.n);
+        deltaLight = false;
+    }
+    else
+    {
+        const PathVertex& qs = s == 1 ? *sampled : lightPath[s - 1];
+        const PathVertex& light = s == 1 ? *sampled : lightPath[0];
+        pL[s] = s == 1 ? scatterPdf(qs, qs, pt) : scatterPdf(lightPath[s - 2], qs, pt);
+        pL[s + 1] = scatterPdf(qs, pt, ptMinus);
+        pC[s - 1] = scatterPdf(ptMinus, pt, qs);
+        if (s > 1)
+            pC[s - 2] = scatterPdf(pt, qs, lightPath[s - 2]);
+        deltaLight = light.light->getArea() <= 0.0;
+    }
+
+    // pL[0] is the density of x_0 as the start of a light subpath. The
+    // strategy s = 1 samples it from x_1 instead, with the density of the
+    // light's own sampling (e.g., by solid angle): connectRatio is the
+    // ratio of that density to pL[0]
+    const PathVertex& x0 = s == 0 ? pt : s == 1 ? *sampled : lightPath[0];
+    const PathVertex& x1 = s == 0 ? ptMinus : s == 1 ? pt : lightPath[1];
+    double area = x0.light->getArea();
+    double connectRatio = x0.light->getPdf(x1.p, x0.p) * (area > 0.0 ? area : 1.0);
+
+    // Ratios of the densities of the other strategies to this one (power
+    // heuristic), leaving out those which would connect to a specular
+    // vertex or end on the camera
+    double sum = 0.0;
+    double r = 1.0;
+    for (size_t j = s; j + 2 <= k; j++)
+    {
+        r *= remap0(pL[j]) / remap0(pC[j]);
+        double ratio = j == 0 ? r * connectRatio : r;
+        if (!delta[j] && !delta[j + 1])
+            sum += ratio * ratio;
+    }
+    r = 1.0;
+    for (size_t j = s; j-- > 0;)
+    {
+        r *= remap0(pC[j]) / remap0(pL[j]);
+        double ratio = j == 1 ? r * connectRatio : r;
+        bool deltaBefore = j > 0 ? delta[j - 1] : deltaLight;
+        if (!delta[j] && !deltaBefore)
+            sum += ratio * ratio;
+    }
+
+    // The ratios above are to the density of this strategy with x_0
+    // started as a light subpath
+    if (s == 1 && connectRatio > 0.0)
+        sum /= connectRatio * connectRatio;
+
+    return 1.0 / (1.0 + sum);
+}
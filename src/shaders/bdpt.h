@@ -0,0 +1,90 @@
+#ifndef BDPT_H
+#define BDPT_H
+
+#include <vector>
+
+#include "shader.h"
+
+// Bidirectional path tracing (Veach 1997). For every camera ray, a camera
+// subpath and a light subpath (from a light chosen by its power, started
+// as a photon) are traced, and every vertex of the one is connected to
+// every vertex of the other with a shadow ray. The paths made by the
+// different strategies (the camera path hitting an emitter, sampling a
+// point of a light, connecting to the light subpath) are weighted with
+// multiple importance sampling (power heuristic), so that each one counts
+// where it is good: the light subpath finds the surfaces lit only through
+// glass or by emitters facing away from the camera.
+// The strategies which end on the camera (light subpaths seen by the lens)
+// would splat into other pixels than the one shaded, so they are not used.
+// The lights emit on the side of their normal only, as when they are
+// sampled. The background and the environment light are only seen by the
+// camera subpath.
+class BDPT : public Shader
+{
+public:
+    BDPT();
+    BDPT(Vector3D bgColor_, int maxDepth_);
+
+    Vector3D computeColor(const Ray& r,
+        const Scene& scene) const;
+
+    Vector3D shadeHit(const Ray& r, const Intersection& its,
+        const MaterialRecord& material,
+        const Scene& scene) const;
+
+private:
+    // maxDepth bounces at most, counting mirrors and glass
+    int maxDepth;
+
+    // Vertex of a subpath, with the densities (per unit area) with which
+    // it is generated from the vertex before it (pdfFwd) and from the one
+    // after it, by a subpath going the other way (pdfRev). Both are 0 after
+    // a specular bounce
+    struct PathVertex
+    {
+        Vector3D p;
+        Vector3D n;             // Zero for the camera and point lights
+        const MaterialRecord* material;     // nullptr on the camera and lights
+        const LightSource* light;           // Light the vertex is on, if any
+        double lightPdf;        // Density of the vertex as the start of a light subpath
+        Vector3D beta;          // Throughput of the subpath up to here
+        double pdfFwd;
+        double pdfRev;
+        bool delta;             // Mirror or glass
+    };
+
+    // Extend the subpath from its last vertex along ray, with the
+    // throughput beta, up to maxVertices vertices. pdfDir is the density of
+    // the direction of ray, lightSubpath tells which way the light goes.
+    // firstHit is the closest hit along ray when already known. Returns
+    // true if the subpath left the scene, along ray and with the
+    // throughput beta
+    bool randomWalk(std::vector<PathVertex>& path, Ray& ray, Vector3D& beta, double pdfDir,
+        size_t maxVertices, bool lightSubpath, const Intersection* firstHit,
+        const Scene& scene) const;
+
+    void traceLightPath(std::vector<PathVertex>& path, double time,
+        const Scene& scene) const;
+
+    // Densities of the vertices of a whole path, filled in by misWeight.
+    // Allocated once per camera ray, for all of its connections
+    struct MisBuffers
+    {
+        std::vector<double> pL;
+        std::vector<double> pC;
+        std::vector<bool> delta;
+    };
+
+    // Path made of the first s vertices of the light subpath and the first
+    // t of the camera subpath, times its MIS weight
+    Vector3D connect(const std::vector<PathVertex>& lightPath,
+        const std::vector<PathVertex>& cameraPath, size_t s, size_t t,
+        double time, MisBuffers& buffers, const Scene& scene) const;
+
+    // sampled is the light vertex sampled for s = 1
+    double misWeight(const std::vector<PathVertex>& lightPath,
+        const std::vector<PathVertex>& cameraPath, size_t s, size_t t,
+        const PathVertex* sampled, MisBuffers& buffers) const;
+};
+
+#endif // BDPT_H
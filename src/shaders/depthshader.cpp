@@ -11,11 +11,11 @@ DepthShader::DepthShader(Vector3D hitColor_, double maxDist_, Vector3D bgColor_)
 { }
 
 
-Vector3D DepthShader::computeColor(const Ray &r, const std::vector<Shape*> &objList, const std::vector<LightSource*> &lsList) const
+Vector3D DepthShader::computeColor(const Ray &r, const Scene& scene) const
 {
     
     Intersection its;
-    if (Utils::getClosestIntersection(r, objList, its)) {
+    if (Utils::getClosestIntersection(r, scene, its)) {
         Vector3D origin = r.o;
         Vector3D dest = its.itsPoint;
 
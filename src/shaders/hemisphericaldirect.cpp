@@ -14,16 +14,15 @@ HemisphericalDirect::HemisphericalDirect(Vector3D bgColor_, int numSamples_)
 { }
 
 Vector3D HemisphericalDirect::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its))
+    if (!Utils::getClosestIntersection(r, scene, its))
     {
-        return bgColor;
+        return getBackground(r, scene);
     }
 
-    const Material& material = its.shape->getMaterial();
+    const MaterialRecord& material = scene.getMaterial(its);
     Vector3D n = its.normal.normalized();
     Vector3D wo = (-r.d).normalized(); 
 
@@ -47,14 +46,14 @@ Vector3D HemisphericalDirect::computeColor(const Ray& r,
             Vector3D wi = sampler.getSample(n);
 
             // Create a shadow ray from the hit point in the sampled direction
-            Ray shadowRay(its.itsPoint, wi);
+            Ray shadowRay(its.itsPoint, wi, 0, Epsilon, INFINITY, r.time);
             shadowRay.maxT = INFINITY; // Large value to reach any light
 
             // Check if the shadow ray hits an emissive surface
             Intersection lightIts;
-            if (Utils::getClosestIntersection(shadowRay, objList, lightIts))
+            if (Utils::getClosestIntersection(shadowRay, scene, lightIts))
             {
-                const Material& lightMaterial = lightIts.shape->getMaterial();
+                const MaterialRecord& lightMaterial = scene.getMaterial(lightIts);
                 if (lightMaterial.isEmissive())
                 {   
                     // Get the emissive radiance from the light source
@@ -66,6 +65,12 @@ Vector3D HemisphericalDirect::computeColor(const Ray& r,
                     Ldir += Le_light * refl * dot(wi, n) / pdf;
                 }
             }
+            else if (scene.environmentLight != nullptr)
+            {
+                // The ray leaves the scene: light from the environment
+                Vector3D refl = material.getReflectance(n, wo, wi);
+                Ldir += scene.environmentLight->getRadiance(wi) * refl * dot(wi, n) / pdf;
+            }
         }
 
         // Average the samples
@@ -86,8 +91,8 @@ Vector3D HemisphericalDirect::computeColor(const Ray& r,
     if (material.hasSpecular())
     {
         Vector3D wr = (2 * dot(n, wo) * n - wo).normalized();
-        Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1);
-        color += computeColor(reflRay, objList, lsList);
+        Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+        color += computeColor(reflRay, scene);
     }
 
     // transmission (Transmissive)
@@ -107,14 +112,14 @@ Vector3D HemisphericalDirect::computeColor(const Ray& r,
         if (radicand >= 0)
         {
             Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized();
-            Ray refrRay(its.itsPoint - n1 * Epsilon, wt, r.depth + 1);
-            color += computeColor(refrRay, objList, lsList);
+            Ray refrRay(its.itsPoint - n1 * Epsilon, wt, r.depth + 1, Epsilon, INFINITY, r.time);
+            color += computeColor(refrRay, scene);
         }
         else
         {
             Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
-            Ray reflRay(its.itsPoint + n1 * Epsilon, wr, r.depth + 1);
-            color += computeColor(reflRay, objList, lsList);
+            Ray reflRay(its.itsPoint + n1 * Epsilon, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+            color += computeColor(reflRay, scene);
         }
     }
 
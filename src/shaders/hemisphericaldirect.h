@@ -11,8 +11,7 @@ public:
     HemisphericalDirect(Vector3D bgColor_, int numSamples_);
 
     Vector3D computeColor(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 
 private:
     int numSamples;
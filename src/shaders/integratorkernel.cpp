@@ -0,0 +1,18 @@
+#include "integratorkernel.h"
+
+void renderKernel(KernelType type, const KernelSettings &settings,
+                  const Camera &cam, const Scene &scene, Film &film, int spp)
+{
+    switch (type)
+    {
+    case KERNEL_AREADIRECT_DOF:
+        IntegratorKernel<RandSampler, AreaDirectStrategy, true, false>(settings, cam, scene).render(film, spp);
+        break;
+    case KERNEL_AREADIRECT_MB:
+        IntegratorKernel<RandSampler, AreaDirectStrategy, false, true>(settings, cam, scene).render(film, spp);
+        break;
+    case KERNEL_NEE_DOF:
+        IntegratorKernel<RandSampler, NEEStrategy, true, false>(settings, cam, scene).render(film, spp);
+        break;
+    }
+}
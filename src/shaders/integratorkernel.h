@@ -0,0 +1,323 @@
+#ifndef INTEGRATORKERNEL_H
+#define INTEGRATORKERNEL_H
+
+#include "../core/film.h"
+#include "../core/scene.h"
+#include "../core/utils.h"
+#include "../cameras/camera.h"
+#include "../lightsources/arealightsource.h"
+#include "../lightsources/environmentlight.h"
+#include "../lightsources/meshlightsource.h"
+#include "../lightsources/pointlightsource.h"
+#include "../lightsources/spherelightsource.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+
+// Compile-time specialized render kernels. Unlike the Shader classes, the
+// sampler, the light sampling strategy and the depth of field / motion blur
+// features are template parameters: every configuration is compiled into
+// its own render loop, with no virtual calls to the integrator and no tests
+// for the features it does not use. The lights are dispatched on their type
+// (see LightType) once per sample, and then called through their final
+// classes. The lens and the shutter themselves are
+// set up in the Camera (see Camera::setThinLens and Camera::setShutter); the
+// kernel only decides whether each camera ray draws lens and time samples.
+
+// Run-time parameters shared by all kernels
+struct KernelSettings
+{
+    Vector3D bgColor = Vector3D(0.0);
+    int maxDepth = 3;           // Maximum number of bounces
+    int numLightSamples = 10;   // Light samples per shading point (area direct strategy)
+    double ambient = 0.1;       // Ambient term (area direct strategy)
+};
+
+/* ******** */
+/* Samplers */
+/* ******** */
+
+// Uniform random numbers in [0, 1] from std::rand, as in the rest of the
+// renderer
+struct RandSampler
+{
+    double get1D() const { return (double)std::rand() / RAND_MAX; }
+};
+
+/* ************************ */
+/* Light sampling strategies */
+/* ************************ */
+
+// Direct light only: numLightSamples light samples plus a constant ambient
+// term (AreaDirect)
+struct AreaDirectStrategy
+{
+    static constexpr bool ambientTerm = true;
+    static constexpr bool indirectBounce = false;
+    static int lightSamples(const KernelSettings &s) { return s.numLightSamples; }
+};
+
+// Next event estimation: one light sample plus one hemispherical bounce for
+// the indirect light (NEE)
+struct NEEStrategy
+{
+    static constexpr bool ambientTerm = false;
+    static constexpr bool indirectBounce = true;
+    static int lightSamples(const KernelSettings &) { return 1; }
+};
+
+template <class Sampler, class LightStrategy, bool DepthOfField, bool MotionBlur>
+class IntegratorKernel
+{
+public:
+    IntegratorKernel(const KernelSettings &settings_, const Camera &cam_, const Scene &scene_)
+        : settings(settings_), cam(cam_), scene(scene_)
+    { }
+
+    // Render spp camera rays per pixel into the film
+    void render(Film &film, int spp) const
+    {
+        size_t resX = film.getWidth();
+        size_t resY = film.getHeight();
+
+        for (size_t lin = 0; lin < resY; lin++)
+        {
+            Utils::printProgress((double)lin / double(resY));
+
+            for (size_t col = 0; col < resX; col++)
+            {
+                double x = (double)(col + 0.5) / resX;
+                double y = (double)(lin + 0.5) / resY;
+
+                Vector3D pixelColor(0.0);
+                for (int s = 0; s < spp; s++)
+                    pixelColor += radiance(cameraRay(x, y));
+
+                pixelColor = pixelColor / (double)spp;
+                film.setPixelValue(col, lin, pixelColor);
+            }
+        }
+    }
+
+private:
+    // Camera ray through (x, y). Features which are compiled out use the
+    // lens center and the shutter opening
+    Ray cameraRay(double x, double y) const
+    {
+        double lensU = 0.5, lensV = 0.5, time = 0.0;
+
+        if constexpr (DepthOfField)
+        {
+            lensU = sampler.get1D();
+            lensV = sampler.get1D();
+        }
+        if constexpr (MotionBlur)
+            time = sampler.get1D();
+
+        return cam.generateRay(x, y, lensU, lensV, time);
+    }
+
+    // Incoming radiance along r
+    Vector3D radiance(const Ray &r) const
+    {
+        Intersection its;
+        if (!scene.rayIntersect(r, its))
+            return scene.environmentLight != nullptr ? scene.environmentLight->getRadiance(r.d) : settings.bgColor;
+
+        const MaterialRecord &material = scene.getMaterial(its);
+        Vector3D n = its.normal.normalized();
+        Vector3D wo = (-r.d).normalized();
+
+        Vector3D Le(0.0);
+        if (material.isEmissive())
+            Le = material.getEmissiveRadiance();
+
+        return Le + reflectedRadiance(its.itsPoint, wo, n, material, (int)r.depth, r.time);
+    }
+
+    // All the rays spawned from x travel at the same time as the camera ray
+    Vector3D reflectedRadiance(const Vector3D &x, const Vector3D &wo, const Vector3D &n,
+                               const MaterialRecord &material, int depth, double time) const
+    {
+        Vector3D Lr(0.0);
+
+        if (material.hasDiffuseOrGlossy())
+        {
+            Lr += directRadiance(x, wo, n, material, time);
+
+            if constexpr (LightStrategy::ambientTerm)
+                Lr += settings.ambient * material.getDiffuseReflectance();
+
+            if constexpr (LightStrategy::indirectBounce)
+            {
+                if (depth < settings.maxDepth)
+                    Lr += indirectRadiance(x, wo, n, material, depth, time);
+            }
+        }
+        else if (depth < settings.maxDepth)
+        {
+            if (material.hasSpecular())
+            {
+                Vector3D wr = (2 * dot(n, wo) * n - wo).normalized();
+                Ray reflRay(x + n * Epsilon, wr, depth + 1, Epsilon, INFINITY, time);
+                Lr += radiance(reflRay);
+            }
+            else if (material.hasTransmission())
+            {
+                double muT = material.getIndexOfRefraction();
+                Vector3D n1 = n;
+                if (dot(n, wo) < 0)
+                {
+                    n1 = -n;
+                    muT = 1.0 / muT;
+                }
+
+                double cosO = dot(n1, wo);
+                double radicand = 1 - muT * muT * (1 - cosO * cosO);
+                if (radicand >= 0)
+                {
+                    Vector3D wt = (-muT * wo + n1 * (muT * cosO - std::sqrt(radicand))).normalized();
+                    Ray refrRay(x - n1 * Epsilon, wt, depth + 1, Epsilon, INFINITY, time);
+                    Lr += radiance(refrRay);
+                }
+                else
+                {
+                    Vector3D wr = (2 * cosO * n1 - wo).normalized();
+                    Ray reflRay(x + n1 * Epsilon, wr, depth + 1, Epsilon, INFINITY, time);
+                    Lr += radiance(reflRay);
+                }
+            }
+        }
+
+        return Lr;
+    }
+
+    Vector3D directRadiance(const Vector3D &x, const Vector3D &wo, const Vector3D &n,
+                            const MaterialRecord &material, double time) const
+    {
+        Vector3D Ldir(0.0);
+        int numSamples = LightStrategy::lightSamples(settings);
+
+        // Each sample picks one light (see Scene::sampleLight)
+        for (int s = 0; s < numSamples; s++)
+        {
+            double lightPmf;
+            const LightSource *light = scene.sampleLight(x, n, sampler.get1D(), lightPmf);
+            if (light == nullptr || lightPmf <= 0.0)
+                break;
+
+            Vector3D Ls(0.0);
+            switch (light->getType())
+            {
+            case LIGHT_POINT:
+                Ls = lightSample(static_cast<const PointLightSource &>(*light), x, wo, n, material, time);
+                break;
+            case LIGHT_AREA:
+                Ls = lightSample(static_cast<const AreaLightSource &>(*light), x, wo, n, material, time);
+                break;
+            case LIGHT_SPHERE:
+                Ls = lightSample(static_cast<const SphereLightSource &>(*light), x, wo, n, material, time);
+                break;
+            case LIGHT_MESH:
+                Ls = lightSample(static_cast<const MeshLightSource &>(*light), x, wo, n, material, time);
+                break;
+            case LIGHT_ENVIRONMENT:
+                Ls = lightSample(static_cast<const EnvironmentLight &>(*light), x, wo, n, material, time);
+                break;
+            }
+            Ldir += Ls / lightPmf;
+        }
+
+        return Ldir / (double)numSamples;
+    }
+
+    // Light reflected at x from one point sampled on light
+    template <class Light>
+    Vector3D lightSample(const Light &light, const Vector3D &x, const Vector3D &wo, const Vector3D &n,
+                         const MaterialRecord &material, double time) const
+    {
+        double lightArea = light.getArea();
+
+        double u1 = sampler.get1D();
+        double u2 = sampler.get1D();
+        Vector3D lightNormal;
+        double areaPdf;
+        Vector3D y = light.sampleLightPosition(x, u1, u2, lightNormal, areaPdf);
+        Vector3D Le = light.getRadiance(y, x - y);
+        Vector3D L = y - x;
+        double distance = L.length();
+        if (distance <= 0.0)
+            return Vector3D(0.0);
+
+        Vector3D wi = L / distance;
+        double cosX = dot(n, wi);
+        if (cosX <= 0.0)
+            return Vector3D(0.0);
+
+        // Point lights: Le * fr * cos / r^2, area lights: Le * fr * G / pdf,
+        // with pdf the density of the point per unit area
+        double G = cosX / (distance * distance);
+        if (lightArea > 0.0)
+        {
+            double cosY = dot(lightNormal, -wi);
+            if (cosY <= 0.0 || areaPdf <= 0.0)
+                return Vector3D(0.0);
+            G *= cosY / areaPdf;
+        }
+
+        Ray shadowRay(x, wi, 0, Epsilon, distance - Epsilon, time);
+        if (scene.rayIntersectP(shadowRay))
+            return Vector3D(0.0);
+
+        return Le * material.getReflectance(n, wo, wi) * G;
+    }
+
+    Vector3D indirectRadiance(const Vector3D &x, const Vector3D &wo, const Vector3D &n,
+                              const MaterialRecord &material, int depth, double time) const
+    {
+        // Uniform direction on the hemisphere around n (pdf = 1 / 2pi)
+        double cosTheta = sampler.get1D();
+        double sinTheta = std::sqrt(std::max(0.0, 1.0 - cosTheta * cosTheta));
+        double phi = 2.0 * M_PI * sampler.get1D();
+
+        Vector3D t = std::abs(n.x) > 0.9 ? Vector3D(0, 1, 0) : Vector3D(1, 0, 0);
+        Vector3D b = cross(n, t).normalized();
+        t = cross(b, n);
+        Vector3D wi = (t * (sinTheta * std::cos(phi)) + b * (sinTheta * std::sin(phi)) +
+                       n * cosTheta).normalized();
+
+        Ray newR(x, wi, depth + 1, Epsilon, INFINITY, time);
+        Intersection its;
+        if (!scene.rayIntersect(newR, its))
+            return Vector3D(0.0);
+
+        // The emission of the hit point is already accounted for by the
+        // direct light, so only its reflected radiance is gathered
+        const MaterialRecord &hitMaterial = scene.getMaterial(its);
+        Vector3D Ly = reflectedRadiance(its.itsPoint, (-wi).normalized(),
+                                        its.normal.normalized(), hitMaterial, depth + 1, time);
+
+        return Ly * material.getReflectance(n, wo, wi) * cosTheta * (2.0 * M_PI);
+    }
+
+    KernelSettings settings;
+    Sampler sampler;
+    const Camera &cam;
+    const Scene &scene;
+};
+
+// Kernel configurations used by main
+enum KernelType
+{
+    KERNEL_AREADIRECT_DOF,  // Area direct light with depth of field
+    KERNEL_AREADIRECT_MB,   // Area direct light with camera motion blur
+    KERNEL_NEE_DOF          // Next event estimation with depth of field
+};
+
+// Render the film with the kernel specialized for the given configuration.
+// The configuration is dispatched once; the render loop is fully inlined.
+void renderKernel(KernelType type, const KernelSettings &settings,
+                  const Camera &cam, const Scene &scene, Film &film, int spp);
+
+#endif // INTEGRATORKERNEL_H
@@ -9,10 +9,10 @@ IntersectionShader::IntersectionShader(Vector3D hitColor_, Vector3D bgColor_) :
     Shader(bgColor_), hitColor(hitColor_)
 { }
 
-Vector3D IntersectionShader::computeColor(const Ray &r, const std::vector<Shape*> &objList, const std::vector<LightSource*> &lsList) const
+Vector3D IntersectionShader::computeColor(const Ray &r, const Scene& scene) const
 {
         
-    if (Utils::hasIntersection(r, objList)) {
+    if (Utils::hasIntersection(r, scene)) {
         return Vector3D(1.0, 0.0, 0.0);
 	}
 
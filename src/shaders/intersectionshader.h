@@ -10,8 +10,7 @@ public:
     IntersectionShader(Vector3D hitColor, Vector3D bgColor_);
 
     virtual Vector3D computeColor(const Ray &r,
-                             const std::vector<Shape*> &objList,
-                             const std::vector<LightSource*> &lsList) const;
+                             const Scene& scene) const;
 
     Vector3D hitColor;
 };
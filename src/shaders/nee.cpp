@@ -6,32 +6,45 @@
 #define PI 3.14159265358979323846
 
 NEE::NEE()
-    : Shader(), maxDepth(4)
+    : Shader(), irradianceCache(nullptr), pathGuide(nullptr), maxDepth(4)
 { }
 
 NEE::NEE(Vector3D bgColor_, int maxDepth_)
-    : Shader(bgColor_), maxDepth(maxDepth_)
+    : Shader(bgColor_), irradianceCache(nullptr), pathGuide(nullptr), maxDepth(maxDepth_)
 { }
 
 Vector3D NEE::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
-    return computeRadiance(r, objList, lsList);
+    return computeRadiance(r, scene);
 }
 
 Vector3D NEE::computeRadiance(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     // find the closest intersection
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its))
+    if (!Utils::getClosestIntersection(r, scene, its))
     {
-        return bgColor;
+        return getBackground(r, scene);
     }
 
-    const Material& material = its.shape->getMaterial();
+    return shadeHit(r, its, scene.getMaterial(its), scene);
+}
+
+Vector3D NEE::shadeHit(const Ray& r, const Intersection& its,
+    const MaterialRecord& material,
+    const Scene& scene) const
+{
+    Vector3D direct, indirect;
+    return shadeHitSplit(r, its, material, scene, direct, indirect);
+}
+
+Vector3D NEE::shadeHitSplit(const Ray& r, const Intersection& its,
+    const MaterialRecord& material,
+    const Scene& scene,
+    Vector3D& direct, Vector3D& indirect) const
+{
     Vector3D n = its.normal.normalized();
     Vector3D wo = (-r.d).normalized();
 
@@ -42,54 +55,49 @@ Vector3D NEE::computeRadiance(const Ray& r,
         Le = material.getEmissiveRadiance();
     }
 
-    // Lr = ReflectedRadiance(x, -r.d, MaxDepth)
-    Vector3D Lr(0.0);
-    Lr = reflectedRadiance(its.itsPoint, wo, n, material, r.depth, objList, lsList);
-    
-    
-    return Le + Lr; //return Le  (emissive light) + Lr (reflected light = direct + indirect)
+    // Lr = ReflectedRadiance(x, -r.d, MaxDepth), kept as its direct and
+    // indirect parts
+    direct = Le;
+    indirect = Vector3D(0.0);
+    if (material.hasDiffuseOrGlossy())
+    {
+        direct += Utils::sampleDirectLight(its.itsPoint, wo, n, material, r.time, scene);
+        if (irradianceCache != nullptr && r.depth == 0 && maxDepth > 0 &&
+            material.isPurelyDiffuse())
+        {
+            // indirect = rho_d / pi * E, with E interpolated from the cache
+            indirect = material.getDiffuseReflectance() / PI *
+                       cachedIrradiance(its.itsPoint, n, r.depth, r.time, scene);
+        }
+        else
+        {
+            indirect = indirectRadiance(its.itsPoint, wo, n, material, r.depth, r.time, scene);
+        }
+    }
+    else
+    {
+        indirect = reflectedRadiance(its.itsPoint, wo, n, material, r.depth, r.time, scene);
+    }
+
+    return direct + indirect; //return Le  (emissive light) + Lr (reflected light = direct + indirect)
 }
 
 Vector3D NEE::reflectedRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-    const Material& material, int depth,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const MaterialRecord& material, int depth, double time,
+    const Scene& scene) const
 {
     Vector3D Ldir(0.0);
     Vector3D Lind(0.0);
 
     if (material.hasDiffuseOrGlossy()) {
-        Ldir = directRadiance(x, wo, n, material, objList, lsList);
-        Lind = indirectRadiance(x, wo, n, material, depth, objList, lsList);
+        Ldir = Utils::sampleDirectLight(x, wo, n, material, time, scene);
+        Lind = indirectRadiance(x, wo, n, material, depth, time, scene);
     }
-    else if (material.hasSpecular()) {
-        Vector3D wr = (2 * dot(n, wo) * n - wo).normalized();
-        Ray reflRay(x + n * Epsilon, wr, depth + 1);
-        Lind= computeColor(reflRay, objList, lsList);  // recursively compute light along the reflected ray
-    }
-    else if (material.hasTransmission()) {
-        float muT = material.getIndexOfRefraction();
-        Vector3D n1 = n;
-
-        if (dot(n, wo) < 0)
-        {
-            n1 = -n;
-            muT = 1.0 / muT;
-        }
-
-        float radicand = 1 - muT * muT * (1 - dot(n1, wo) * dot(n1, wo));
-
-        if (radicand >= 0)
-        {
-            Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized();
-            Ray refrRay(x- n1 * Epsilon, wt, depth + 1);
-            Lind += computeColor(refrRay, objList, lsList);
-        }
-        else
-        {
-            Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
-            Ray reflRay(x + n1 * Epsilon, wr, depth + 1);
-            Lind += computeColor(reflRay, objList, lsList);
+    else {
+        // perfect reflection (Mirror) or refraction (Transmissive)
+        Ray next;
+        if (Utils::scatterSpecular(material, x, n, -wo, depth + 1, time, next)) {
+            Lind = computeColor(next, scene);  // recursively compute light along the scattered ray
         }
     }
 
@@ -97,88 +105,83 @@ Vector3D NEE::reflectedRadiance(const Vector3D& x, const Vector3D& wo, const Vec
 }
 
 
-Vector3D NEE::directRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-    const Material& material,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+Vector3D NEE::indirectRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
+    const MaterialRecord& material, int depth, double time,
+    const Scene& scene) const
 {
-    Vector3D Ldir(0.0);
-
-    // Sample all area light sources
-    for (auto areaLight : lsList)
+    Vector3D Lind(0.0);
+   
+    // ωi, pdf = SampleHemisphere(x.normal), or from the mixture of the
+    // hemisphere and the distribution learned by the path guide
+    Vector3D wi;
+    double pdf;
+    if (pathGuide != nullptr && pathGuide->isReady())
     {
-        // Le, y, pdf = light.GetRandomPoint()
-        Vector3D y = areaLight->sampleLightPosition();
-        Vector3D Le = areaLight->getIntensity();
-        double lightArea = areaLight->getArea();
-        double pdf = 1.0 / lightArea;
-
-        // ωi = Direction(x, y)
-        Vector3D L = y - x;
-        double distance = L.length();
-        
-        if (distance <= 0.0)
-            continue;
-
-        Vector3D wi = L / distance;
-
-        Vector3D lightNormal = areaLight->getNormal();
-
-        // compute G(x, y) following the formula
-        double G = (dot(n, wi) * dot(lightNormal, -wi)) / (distance * distance);
-
-        // check visibility V(x,y)
-        Ray shadowRay(x, wi, 0.0, Epsilon, distance - Epsilon); //x= its.itsPoint
-        bool isVisible = !Utils::hasIntersection(shadowRay, objList); // 1 if visible, 0 if blocked
-
-        double V_s;
-        if (isVisible) {
-            V_s = 1.0; // light reaches the point
-        }
-        else {
-            V_s = 0.0; // blocked, in shadow
+        double alpha = pathGuide->bsdfFraction;
+        double guidePdf;
+        if ((double)rand() / RAND_MAX < alpha)
+        {
+            wi = sampler.getSample(n);
+            guidePdf = pathGuide->getPdf(x, wi);
         }
-
-        if (G > 0.0) // only consider positive contributions
+        else
         {
-            Vector3D refl = material.getReflectance(n, wo, wi);
-
-            // Le * reflectance * G* V / pdf
-            Ldir += Le * refl * G * V_s / pdf;
+            wi = pathGuide->sample(x, (double)rand() / RAND_MAX, (double)rand() / RAND_MAX, guidePdf);
         }
+        pdf = alpha * (dot(wi, n) > 0.0 ? 1.0 / (2.0 * PI) : 0.0) + (1.0 - alpha) * guidePdf;
     }
-    return Ldir;
-}
-
-Vector3D NEE::indirectRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-    const Material& material, int depth,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
-{
-    Vector3D Lind(0.0);
-   
-    // ωi, pdf = SampleHemisphere(x.normal)
-    Vector3D wi = sampler.getSample(n);
-    double pdf = 1.0 / (2.0 * PI);
-    Ray newR(x, wi, depth + 1);
+    else
+    {
+        wi = sampler.getSample(n);
+        pdf = 1.0 / (2.0 * PI);
+    }
+    Ray newR(x, wi, depth + 1, Epsilon, INFINITY, time);
 
-    if (depth < maxDepth){
+    if (depth < maxDepth && dot(wi, n) > 0.0){
         
+        Vector3D Ly(0.0);
         Intersection its;
-        if (Utils::getClosestIntersection(newR, objList, its))
+        if (Utils::getClosestIntersection(newR, scene, its))
         {
-            const Material& hitMaterial = its.shape->getMaterial();
+            const MaterialRecord& hitMaterial = scene.getMaterial(its);
             Vector3D hitNormal = its.normal.normalized();
             Vector3D newWo = (-newR.d).normalized();
 
             // Lind = ReflectedRadiance(y, −ωi) * x.BRDF(ωi, ωo) * (x.normal·ωi) / pdf
             // Calculate contribution from ANY material type (diffuse, mirror, transmissive)
-            Vector3D Ly = reflectedRadiance(its.itsPoint, newWo, hitNormal, 
-                                            hitMaterial, newR.depth, objList, lsList);
+            Ly = reflectedRadiance(its.itsPoint, newWo, hitNormal, 
+                                   hitMaterial, newR.depth, time, scene);
             Vector3D brdf = material.getReflectance(n, wo, wi);
 
             Lind = Ly * brdf * dot(wi, n) / pdf;
         }
+
+        // The guide learns the light which this bounce gathers: the
+        // emitters are left out, as they are sampled by Utils::sampleDirectLight
+        if (pathGuide != nullptr)
+            pathGuide->record(x, wi, Ly, pdf);
     }
     return Lind;
 }
+
+Vector3D NEE::cachedIrradiance(const Vector3D& x, const Vector3D& n,
+    int depth, double time,
+    const Scene& scene) const
+{
+    // The records hold the indirect irradiance only, the same light as
+    // indirectRadiance gathers: what the surfaces seen from x reflect,
+    // without their emission (the lights are sampled by Utils::sampleDirectLight)
+    return irradianceCache->getIrradiance(x, n,
+        [&](const Vector3D& wi, double& distance) {
+            Ray newR(x, wi, depth + 1, Epsilon, INFINITY, time);
+
+            Intersection its;
+            if (!Utils::getClosestIntersection(newR, scene, its))
+                return Vector3D(0.0);
+
+            distance = (its.itsPoint - x).length();
+            return reflectedRadiance(its.itsPoint, (-newR.d).normalized(),
+                                     its.normal.normalized(), scene.getMaterial(its),
+                                     newR.depth, time, scene);
+        });
+}
@@ -21,8 +21,7 @@ NEEDOF::NEEDOF(Vector3D bgColor_, int maxDepth_, float sensorWidth, const Vector
 { }
 
 Vector3D NEEDOF::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     // CRÍTICO: Solo aplicar DOF en rayos primarios (depth == 0)
     if (r.depth == 0)
@@ -79,8 +78,8 @@ Vector3D NEEDOF::computeColor(const Ray& r,
             Vector3D newDirection = (focalPoint - randomPosition).normalized();
 
             // Crear rayo modificado con depth=1 para evitar re-aplicar DOF
-            Ray modifiedRay(randomPosition, newDirection, 1);
-            color += computeRadiance(modifiedRay, objList, lsList);
+            Ray modifiedRay(randomPosition, newDirection, 1, Epsilon, INFINITY, r.time);
+            color += computeRadiance(modifiedRay, scene);
         }
 
         // Promediar todas las muestras
@@ -89,24 +88,23 @@ Vector3D NEEDOF::computeColor(const Ray& r,
     else
     {
         // Para rayos secundarios (reflexiones, refracciones), NO aplicar DOF
-        return computeRadiance(r, objList, lsList);
+        return computeRadiance(r, scene);
     }
 
-    return computeRadiance(r, objList, lsList);
+    return computeRadiance(r, scene);
 }
 
 Vector3D NEEDOF::computeRadiance(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     // find the closest intersection
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its))
+    if (!Utils::getClosestIntersection(r, scene, its))
     {
-        return bgColor;
+        return getBackground(r, scene);
     }
 
-    const Material& material = its.shape->getMaterial();
+    const MaterialRecord& material = scene.getMaterial(its);
     Vector3D n = its.normal.normalized();
     Vector3D wo = (-r.d).normalized();
 
@@ -119,28 +117,27 @@ Vector3D NEEDOF::computeRadiance(const Ray& r,
 
     // Lr = ReflectedRadiance(x, -r.d, MaxDepth)
     Vector3D Lr(0.0);
-    Lr = reflectedRadiance(its.itsPoint, wo, n, material, r.depth, objList, lsList);
+    Lr = reflectedRadiance(its.itsPoint, wo, n, material, r.depth, r.time, scene);
     
     
     return Le + Lr; //return Le  (emissive light) + Lr (reflected light = direct + indirect)
 }
 
 Vector3D NEEDOF::reflectedRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-    const Material& material, int depth,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const MaterialRecord& material, int depth, double time,
+    const Scene& scene) const
 {
     Vector3D Ldir(0.0);
     Vector3D Lind(0.0);
 
     if (material.hasDiffuseOrGlossy()) {
-        Ldir = directRadiance(x, wo, n, material, objList, lsList);
-        Lind = indirectRadiance(x, wo, n, material, depth, objList, lsList);
+        Ldir = directRadiance(x, wo, n, material, time, scene);
+        Lind = indirectRadiance(x, wo, n, material, depth, time, scene);
     }
     else if (material.hasSpecular()) {
         Vector3D wr = (2 * dot(n, wo) * n - wo).normalized();
-        Ray reflRay(x + n * Epsilon, wr, depth + 1);
-        Lind= computeColor(reflRay, objList, lsList);  // recursively compute light along the reflected ray
+        Ray reflRay(x + n * Epsilon, wr, depth + 1, Epsilon, INFINITY, time);
+        Lind= computeColor(reflRay, scene);  // recursively compute light along the reflected ray
     }
     else if (material.hasTransmission()) {
         float muT = material.getIndexOfRefraction();
@@ -157,14 +154,14 @@ Vector3D NEEDOF::reflectedRadiance(const Vector3D& x, const Vector3D& wo, const
         if (radicand >= 0)
         {
             Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized();
-            Ray refrRay(x- n1 * Epsilon, wt, depth + 1);
-            Lind += computeColor(refrRay, objList, lsList);
+            Ray refrRay(x- n1 * Epsilon, wt, depth + 1, Epsilon, INFINITY, time);
+            Lind += computeColor(refrRay, scene);
         }
         else
         {
             Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
-            Ray reflRay(x + n1 * Epsilon, wr, depth + 1);
-            Lind += computeColor(reflRay, objList, lsList);
+            Ray reflRay(x + n1 * Epsilon, wr, depth + 1, Epsilon, INFINITY, time);
+            Lind += computeColor(reflRay, scene);
         }
     }
 
@@ -173,20 +170,22 @@ Vector3D NEEDOF::reflectedRadiance(const Vector3D& x, const Vector3D& wo, const
 
 
 Vector3D NEEDOF::directRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-    const Material& material,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const MaterialRecord& material, double time,
+    const Scene& scene) const
 {
     Vector3D Ldir(0.0);
 
     // Sample all area light sources
-    for (auto areaLight : lsList)
+    for (auto areaLight : *scene.LightSourceList)
     {
         // Le, y, pdf = light.GetRandomPoint()
-        Vector3D y = areaLight->sampleLightPosition();
-        Vector3D Le = areaLight->getIntensity();
-        double lightArea = areaLight->getArea();
-        double pdf = 1.0 / lightArea;
+        Vector3D lightNormal;
+        double pdf;
+        Vector3D y = areaLight->sampleLightPosition(x, (double)rand() / RAND_MAX,
+                                                    (double)rand() / RAND_MAX, lightNormal, pdf);
+        if (pdf <= 0.0)
+            continue;
+        Vector3D Le = areaLight->getRadiance(y, x - y);
 
         // ωi = Direction(x, y)
         Vector3D L = y - x;
@@ -197,14 +196,12 @@ Vector3D NEEDOF::directRadiance(const Vector3D& x, const Vector3D& wo, const Vec
 
         Vector3D wi = L / distance;
 
-        Vector3D lightNormal = areaLight->getNormal();
-
         // compute G(x, y) following the formula
         double G = (dot(n, wi) * dot(lightNormal, -wi)) / (distance * distance);
 
         // check visibility V(x,y)
-        Ray shadowRay(x, wi, 0.0, Epsilon, distance - Epsilon); //x= its.itsPoint
-        bool isVisible = !Utils::hasIntersection(shadowRay, objList); // 1 if visible, 0 if blocked
+        Ray shadowRay(x, wi, 0.0, Epsilon, distance - Epsilon, time); //x= its.itsPoint
+        bool isVisible = !Utils::hasIntersection(shadowRay, scene); // 1 if visible, 0 if blocked
 
         double V_s;
         if (isVisible) {
@@ -226,30 +223,29 @@ Vector3D NEEDOF::directRadiance(const Vector3D& x, const Vector3D& wo, const Vec
 }
 
 Vector3D NEEDOF::indirectRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-    const Material& material, int depth,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const MaterialRecord& material, int depth, double time,
+    const Scene& scene) const
 {
     Vector3D Lind(0.0);
    
     // ωi, pdf = SampleHemisphere(x.normal)
     Vector3D wi = sampler.getSample(n);
     double pdf = 1.0 / (2.0 * PI);
-    Ray newR(x, wi, depth + 1);
+    Ray newR(x, wi, depth + 1, Epsilon, INFINITY, time);
 
     if (depth < maxDepth){
         
         Intersection its;
-        if (Utils::getClosestIntersection(newR, objList, its))
+        if (Utils::getClosestIntersection(newR, scene, its))
         {
-            const Material& hitMaterial = its.shape->getMaterial();
+            const MaterialRecord& hitMaterial = scene.getMaterial(its);
             Vector3D hitNormal = its.normal.normalized();
             Vector3D newWo = (-newR.d).normalized();
 
             // Lind = ReflectedRadiance(y, −ωi) * x.BRDF(ωi, ωo) * (x.normal·ωi) / pdf
             // Calculate contribution from ANY material type (diffuse, mirror, transmissive)
             Vector3D Ly = reflectedRadiance(its.itsPoint, newWo, hitNormal, 
-                                            hitMaterial, newR.depth, objList, lsList);
+                                            hitMaterial, newR.depth, time, scene);
             Vector3D brdf = material.getReflectance(n, wo, wi);
 
             Lind = Ly * brdf * dot(wi, n) / pdf;
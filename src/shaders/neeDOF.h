@@ -17,31 +17,26 @@ public:
     NEEDOF(Vector3D bgColor_, int maxDepth_, float sensorWidth, const Vector3D& focusPointWS);
 
     Vector3D computeColor(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 
 private:
     int maxDepth;
     HemisphericalSampler sampler;
 
     Vector3D computeRadiance(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 
     Vector3D reflectedRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-        const Material& material, int depth,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const MaterialRecord& material, int depth, double time,
+        const Scene& scene) const;
 
     Vector3D directRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-        const Material& material,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const MaterialRecord& material, double time,
+        const Scene& scene) const;
 
     Vector3D indirectRadiance(const Vector3D& x, const Vector3D& wo, const Vector3D& n,
-        const Material& material, int depth,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const MaterialRecord& material, int depth, double time,
+        const Scene& scene) const;
 
     // Si no hay punto de enfoque, se usa este foco fijo
     float focalLength = 0.0f;
@@ -13,11 +13,11 @@ NormalShader::NormalShader(Vector3D hitColor_, double maxDist_, Vector3D bgColor
 }
 
 
-Vector3D NormalShader::computeColor(const Ray& r, const std::vector<Shape*>& objList, const std::vector<LightSource*>& lsList) const
+Vector3D NormalShader::computeColor(const Ray& r, const Scene& scene) const
 {
 
     Intersection its;
-    if (Utils::getClosestIntersection(r, objList, its)) {
+    if (Utils::getClosestIntersection(r, scene, its)) {
 		Vector3D n = its.normal;
 
         return Vector3D((n+(1.0, 1.0, 1.0))/2);
@@ -12,8 +12,7 @@ public:
     NormalShader(Vector3D color_, double maxDist_, Vector3D bgColor_);
 
     Vector3D computeColor(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
 
 private:
     double maxDist;
@@ -0,0 +1,174 @@
+#include "photonmapper.h"
+#include "../core/photontracer.h"
+#include "../core/utils.h"
+
+#include <iostream>
+
+#define PI 3.14159265358979323846
+
+// Cone filter of the density estimation: weight 1 - d / (k r)
+#define CONE_FILTER_K 1.1
+
+PhotonMapper::PhotonMapper()
+    : PhotonMapper(Vector3D(0.0), 4)
+{ }
+
+PhotonMapper::PhotonMapper(Vector3D bgColor_, int maxDepth_)
+    : Shader(bgColor_), numGlobalPhotons(200000), numCausticPhotons(1000000),
+      maxPhotonDepth(8), seed(0), numThreads(0),
+      globalNearest(100), globalRadius(0.5), causticNearest(100), causticRadius(0.2),
+      maxDepth(maxDepth_)
+{ }
+
+void PhotonMapper::emitPhotons(const Scene& scene)
+{
+    std::vector<Photon> photons;
+
+    tracePhotons(scene, numGlobalPhotons, false, photons);
+    globalMap.clear();
+    globalMap.add(photons);
+    globalMap.build();
+
+    tracePhotons(scene, numCausticPhotons, true, photons);
+    causticMap.clear();
+    causticMap.add(photons);
+    causticMap.build();
+
+    std::cout << "Photon maps: " << globalMap.size() << " global, "
+              << causticMap.size() << " caustic photons" << std::endl;
+}
+
+void PhotonMapper::tracePhotons(const Scene& scene, size_t count, bool causticOnly,
+    std::vector<Photon>& photons) const
+{
+    std::vector<std::vector<Photon>> blocks(photonBlockCount(count));
+
+    ::tracePhotons(scene, count, seed * 0x9e3779b9u + (causticOnly ? 1 : 0), maxPhotonDepth, numThreads,
+        [&](size_t block, int, const Photon& photon, bool throughSpecular) {
+            // The power of the lights is shared by the count photons.
+            // Caustic photons stop at the first diffuse surface
+            if (!causticOnly || throughSpecular)
+                blocks[block].push_back({ photon.position, photon.direction, photon.power / (double)count });
+            return !causticOnly;
+        });
+
+    photons.clear();
+    for (const std::vector<Photon>& block : blocks)
+        photons.insert(photons.end(), block.begin(), block.end());
+}
+
+Vector3D PhotonMapper::computeColor(const Ray& r,
+    const Scene& scene) const
+{
+    Intersection its;
+    if (!Utils::getClosestIntersection(r, scene, its))
+    {
+        return getBackground(r, scene);
+    }
+
+    return shadeHit(r, its, scene.getMaterial(its), scene);
+}
+
+Vector3D PhotonMapper::shadeHit(const Ray& r, const Intersection& its,
+    const MaterialRecord& material,
+    const Scene& scene) const
+{
+    Vector3D n = its.normal.normalized();
+    Vector3D wo = (-r.d).normalized();
+
+    Vector3D Lo(0.0);
+    if (material.isEmissive())
+    {
+        Lo = material.getEmissiveRadiance();
+    }
+
+    if (material.hasDiffuseOrGlossy())
+    {
+        Vector3D nf = dot(n, wo) < 0 ? -n : n;
+
+        // Direct light and caustics
+        Lo += Utils::sampleDirectLight(its.itsPoint, wo, nf, material, r.time, scene);
+        Lo += radianceEstimate(causticMap, causticNearest, causticRadius,
+                               its.itsPoint, wo, nf, material);
+
+        // Rest of the indirect light, with one cosine weighted gather ray:
+        // brdf * cos / pdf = brdf * pi
+        if (r.depth < (size_t)maxDepth)
+        {
+            Vector3D wi = Utils::sampleCosineHemisphere(nf, (double)rand() / RAND_MAX,
+                                                        (double)rand() / RAND_MAX);
+            Vector3D Li = gatherRadiance(its.itsPoint, wi, r.depth + 1, r.time, scene);
+            Lo += Li * material.getReflectance(nf, wo, wi) * PI;
+        }
+    }
+    else if (r.depth < (size_t)maxDepth)
+    {
+        Ray next;
+        if (Utils::scatterSpecular(material, its.itsPoint, n, r.d, r.depth + 1, r.time, next))
+        {
+            Lo += computeColor(next, scene);
+        }
+    }
+
+    return Lo;
+}
+
+Vector3D PhotonMapper::gatherRadiance(const Vector3D& x, const Vector3D& wi, size_t depth,
+    double time, const Scene& scene) const
+{
+    Ray ray(x, wi, depth, Epsilon, INFINITY, time);
+
+    // Through mirrors and glass up to a diffuse surface. The emitters and
+    // the background are left out: they are the direct light and the
+    // caustics, which are estimated separately
+    while (true)
+    {
+        Intersection its;
+        if (!Utils::getClosestIntersection(ray, scene, its))
+            return Vector3D(0.0);
+
+        const MaterialRecord& material = scene.getMaterial(its);
+        Vector3D n = its.normal.normalized();
+        Vector3D wo = (-ray.d).normalized();
+
+        if (material.hasDiffuseOrGlossy())
+            return radianceEstimate(globalMap, globalNearest, globalRadius, its.itsPoint, wo,
+                                    dot(n, wo) < 0 ? -n : n, material);
+
+        Ray next;
+        if (ray.depth >= (size_t)maxDepth || !Utils::scatterSpecular(material, its.itsPoint, n, ray.d,
+                                                                  ray.depth + 1, time, next))
+            return Vector3D(0.0);
+        ray = next;
+    }
+}
+
+Vector3D PhotonMapper::radianceEstimate(const PhotonMap& map, size_t nearest, double radius,
+    const Vector3D& x, const Vector3D& wo, const Vector3D& n,
+    const MaterialRecord& material) const
+{
+    if (map.size() == 0)
+        return Vector3D(0.0);
+
+    std::vector<const Photon*> photons;
+    double radius2;
+    map.findNearest(x, nearest, radius, photons, radius2);
+    if (photons.empty() || radius2 <= 0.0)
+        return Vector3D(0.0);
+
+    // Sum of flux * brdf over the disk of the photons, weighted by a cone
+    // filter (normalized by 1 - 2 / (3 k))
+    double r = std::sqrt(radius2);
+    Vector3D L(0.0);
+    for (const Photon* photon : photons)
+    {
+        Vector3D wi = -photon->direction;
+        if (dot(wi, n) <= 0.0)
+            continue;
+
+        double w = 1.0 - (photon->position - x).length() / (CONE_FILTER_K * r);
+        L += photon->power * material.getReflectance(n, wo, wi) * w;
+    }
+
+    return L / ((1.0 - 2.0 / (3.0 * CONE_FILTER_K)) * PI * radius2);
+}
@@ -0,0 +1,71 @@
+#ifndef PHOTONMAPPER_H
+#define PHOTONMAPPER_H
+
+#include <vector>
+
+#include "shader.h"
+#include "../core/photonmap.h"
+
+// Photon mapping (Jensen 1996). emitPhotons traces photons from the lights
+// into two maps: the caustic map, with the photons which reached a diffuse
+// surface through mirrors and glass only, and the global map, with every
+// photon stored on a diffuse surface. At the diffuse and glossy hits of the
+// camera paths, the direct light is sampled as NEE does, the caustics are
+// estimated from the density of the caustic map, and the rest of the
+// indirect light is gathered with one ray, shaded with the global map where
+// it reaches a diffuse surface. Mirrors and glass are followed as in the
+// other shaders.
+// This finds the caustics of point lights and small lights seen through
+// specular surfaces, which hemisphere sampling almost never reaches. The
+// environment light emits no photons, so only its direct light is there.
+class PhotonMapper : public Shader
+{
+public:
+    PhotonMapper();
+    PhotonMapper(Vector3D bgColor_, int maxDepth_);
+
+    // Trace the photons (on numThreads threads) and build the maps. Needed
+    // before rendering, and again when the scene changes
+    void emitPhotons(const Scene& scene);
+
+    Vector3D computeColor(const Ray& r,
+        const Scene& scene) const;
+
+    Vector3D shadeHit(const Ray& r, const Intersection& its,
+        const MaterialRecord& material,
+        const Scene& scene) const;
+
+    // Settings of emitPhotons
+    size_t numGlobalPhotons;    // Photons emitted for the global map
+    size_t numCausticPhotons;   // Photons emitted for the caustic map
+    int maxPhotonDepth;         // Bounces of a photon at most
+    unsigned int seed;
+    unsigned int numThreads;    // 0 = all the hardware threads
+
+    // Density estimation: nearest photons used, and largest search radius
+    size_t globalNearest;
+    double globalRadius;
+    size_t causticNearest;
+    double causticRadius;
+
+private:
+    int maxDepth;
+    PhotonMap globalMap;
+    PhotonMap causticMap;
+
+    // Emit count photons, in parallel, keeping all of them (global map) or
+    // only the caustic ones
+    void tracePhotons(const Scene& scene, size_t count, bool causticOnly,
+        std::vector<Photon>& photons) const;
+
+    // Radiance reflected towards wo at x by the photons of the map around it
+    Vector3D radianceEstimate(const PhotonMap& map, size_t nearest, double radius,
+        const Vector3D& x, const Vector3D& wo, const Vector3D& n,
+        const MaterialRecord& material) const;
+
+    // Indirect light arriving at x from wi, with the global map
+    Vector3D gatherRadiance(const Vector3D& x, const Vector3D& wi, size_t depth,
+        double time, const Scene& scene) const;
+};
+
+#endif // PHOTONMAPPER_H
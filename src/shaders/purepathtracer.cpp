@@ -5,25 +5,30 @@
 #define PI 3.14159265358979323846
 
 PurePathTracer::PurePathTracer()
-    : Shader(), maxDepth(4)
+    : Shader(), irradianceCache(nullptr), pathGuide(nullptr), maxDepth(4)
 { }
 
 PurePathTracer::PurePathTracer(Vector3D bgColor_, int maxDepth_)
-    : Shader(bgColor_), maxDepth(maxDepth_)
+    : Shader(bgColor_), irradianceCache(nullptr), pathGuide(nullptr), maxDepth(maxDepth_)
 { }
 
 Vector3D PurePathTracer::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {    
     // x = IntersectScene(r)
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its))
+    if (!Utils::getClosestIntersection(r, scene, its))
     {
-        return bgColor;
+        return getBackground(r, scene);
     }
 
-    const Material& material = its.shape->getMaterial();
+    return shadeHit(r, its, scene.getMaterial(its), scene);
+}
+
+Vector3D PurePathTracer::shadeHit(const Ray& r, const Intersection& its,
+    const MaterialRecord& material,
+    const Scene& scene) const
+{
     Vector3D n = its.normal.normalized();
     Vector3D wo = (-r.d).normalized(); // direction to camera
 
@@ -34,60 +39,94 @@ Vector3D PurePathTracer::computeColor(const Ray& r,
         Lo = material.getEmissiveRadiance();
     }
 
-    if (material.hasDiffuseOrGlossy())
+    if (material.hasDiffuseOrGlossy() && irradianceCache != nullptr &&
+        r.depth == 0 && maxDepth > 0 && material.isPurelyDiffuse())
+    {
+        // Lo += rho_d / pi * E, with E the irradiance from the light
+        // reflected by the surfaces seen from x, interpolated from the cache
+        Vector3D E = irradianceCache->getIrradiance(its.itsPoint, n,
+            [&](const Vector3D& wi, double& distance) {
+                Ray newR(its.itsPoint, wi, r.depth + 1, Epsilon, INFINITY, r.time);
+
+                Intersection hit;
+                if (!Utils::getClosestIntersection(newR, scene, hit))
+                    return Vector3D(0.0);
+
+                distance = (hit.itsPoint - its.itsPoint).length();
+                const MaterialRecord& hitMaterial = scene.getMaterial(hit);
+                Vector3D Lr = shadeHit(newR, hit, hitMaterial, scene);
+                if (hitMaterial.isEmissive())
+                    Lr -= hitMaterial.getEmissiveRadiance();
+                return Lr;
+            });
+        Lo += material.getDiffuseReflectance() / PI * E;
+
+        // and the emission seen from x (lights and background) is sampled
+        // with one direction, as without the cache
+        Vector3D wi = sampler.getSample(n);
+        double pdf = 1.0 / (2.0 * PI);
+        Ray newR(its.itsPoint, wi, r.depth + 1, Epsilon, INFINITY, r.time);
+
+        Vector3D Le(0.0);
+        Intersection hit;
+        if (!Utils::getClosestIntersection(newR, scene, hit))
+            Le = getBackground(newR, scene);
+        else if (scene.getMaterial(hit).isEmissive())
+            Le = scene.getMaterial(hit).getEmissiveRadiance();
+
+        Lo += Le * material.getReflectance(n, wo, wi) * dot(wi, n) / pdf;
+    }
+    else if (material.hasDiffuseOrGlossy())
     {
         // ωi, pdf = SampleHemisphere(x.normal)
-        Vector3D wi = sampler.getSample(n); //this calls hemisphericalSampler, which generates random directions on the hemisphere around the surface normal
-        double pdf = 1.0 / (2.0 * PI); 
+        Vector3D wi;
+        double pdf;
+        if (pathGuide != nullptr && pathGuide->isReady())
+        {
+            // or from the mixture of the hemisphere and the distribution
+            // learned by the path guide
+            double alpha = pathGuide->bsdfFraction;
+            double guidePdf;
+            if ((double)rand() / RAND_MAX < alpha)
+            {
+                wi = sampler.getSample(n);
+                guidePdf = pathGuide->getPdf(its.itsPoint, wi);
+            }
+            else
+            {
+                wi = pathGuide->sample(its.itsPoint, (double)rand() / RAND_MAX,
+                                       (double)rand() / RAND_MAX, guidePdf);
+            }
+            pdf = alpha * (dot(wi, n) > 0.0 ? 1.0 / (2.0 * PI) : 0.0) + (1.0 - alpha) * guidePdf;
+        }
+        else
+        {
+            wi = sampler.getSample(n); //this calls hemisphericalSampler, which generates random directions on the hemisphere around the surface normal
+            pdf = 1.0 / (2.0 * PI);
+        }
 
         // the ray bounces around the scene until a max number of bounces (maxDepth) is reached
-        if (r.depth < maxDepth)
+        if (r.depth < maxDepth && dot(wi, n) > 0.0)
         {
             // Ray newR = Ray(x, ωi, r.depth+1)
-            Ray newR(its.itsPoint, wi, r.depth + 1);
+            Ray newR(its.itsPoint, wi, r.depth + 1, Epsilon, INFINITY, r.time);
 
             // Lo += ComputeRadiance(newR, scene, MaxDepth) * x.BRDF(ωi, -ray.d) * (x.normal·ωi) / pdf
-            Vector3D Li = computeColor(newR, objList, lsList); // Recursive call
+            Vector3D Li = computeColor(newR, scene); // Recursive call
             Vector3D brdf = material.getReflectance(n, wo, wi);
 
             Lo += Li * brdf * dot(wi, n) / pdf;
-        }
-    }
 
-    // perfect specular reflection (Mirror)
-    if (material.hasSpecular())
-    {
-        Vector3D wr = (2 * dot(n, wo) * n - wo).normalized();
-        Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1);
-        Lo += computeColor(reflRay, objList, lsList);
+            if (pathGuide != nullptr)
+                pathGuide->record(its.itsPoint, wi, Li, pdf);
+        }
     }
 
-    // perfect transmission (Transmissive)
-    if (material.hasTransmission())
+    // perfect specular reflection (Mirror) or transmission (Transmissive)
+    Ray next;
+    if (Utils::scatterSpecular(material, its.itsPoint, n, r.d, r.depth + 1, r.time, next))
     {
-        float muT = material.getIndexOfRefraction();
-        Vector3D n1 = n;
-        
-        if (dot(n, wo) < 0) 
-        {
-            n1 = -n;
-            muT = 1.0 / muT;
-        }
-        
-        float radicand = 1 - muT * muT * (1 - dot(n1, wo) * dot(n1, wo));
-        
-        if (radicand >= 0)
-        {
-            Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized();
-            Ray refrRay(its.itsPoint - n1 * Epsilon, wt, r.depth + 1);
-            Lo += computeColor(refrRay, objList, lsList);
-        }
-        else
-        {
-            Vector3D wr = (2 * dot(n1, wo) * n1 - wo).normalized();
-            Ray reflRay(its.itsPoint + n1 * Epsilon, wr, r.depth + 1);
-            Lo += computeColor(reflRay, objList, lsList);
-        }
+        Lo += computeColor(next, scene);
     }
 
     // return Lo
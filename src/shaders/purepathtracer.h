@@ -3,6 +3,8 @@
 
 #include "shader.h"
 #include "../core/hemisphericalsampler.h"
+#include "../core/irradiancecache.h"
+#include "../core/pathguide.h"
 
 class PurePathTracer : public Shader
 {
@@ -11,8 +13,25 @@ public:
     PurePathTracer(Vector3D bgColor_, int maxDepth_);
 
     Vector3D computeColor(const Ray& r,
-        const std::vector<Shape*>& objList,
-        const std::vector<LightSource*>& lsList) const;
+        const Scene& scene) const;
+
+    Vector3D shadeHit(const Ray& r, const Intersection& its,
+        const MaterialRecord& material,
+        const Scene& scene) const;
+
+    // Optional irradiance cache for the diffuse interreflections: at the
+    // purely diffuse surfaces seen from the camera, the light which has
+    // been reflected at least once on its way there is interpolated from
+    // it instead of being traced. The emitters are still sampled as usual.
+    // It is filled as the image is rendered (nullptr = no cache)
+    IrradianceCache* irradianceCache;
+
+    // Optional path guide for the diffuse and glossy bounces, which are
+    // then sampled with probability pathGuide->bsdfFraction from the
+    // hemisphere and from what it learned otherwise, once it is ready.
+    // While it is learning, the radiance found by every bounce is recorded
+    // in it (nullptr = hemisphere sampling only)
+    PathGuide* pathGuide;
 
 private:
     int maxDepth;
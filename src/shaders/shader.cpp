@@ -5,3 +5,27 @@ Shader::Shader() : bgColor(Vector3D(0.0))
 
 Shader::Shader(Vector3D bgColor_) : bgColor(bgColor_)
 { }
+
+Vector3D Shader::shadeHit(const Ray &r, const Intersection &its,
+                          const MaterialRecord &material,
+                          const Scene& scene) const
+{
+    return computeColor(r, scene);
+}
+
+Vector3D Shader::shadeHitSplit(const Ray &r, const Intersection &its,
+                               const MaterialRecord &material,
+                               const Scene& scene,
+                               Vector3D &direct, Vector3D &indirect) const
+{
+    direct = shadeHit(r, its, material, scene);
+    indirect = Vector3D(0.0);
+    return direct;
+}
+
+Vector3D Shader::getBackground(const Ray &r, const Scene& scene) const
+{
+    if (scene.environmentLight != nullptr)
+        return scene.environmentLight->getRadiance(r.d);
+    return bgColor;
+}
@@ -7,6 +7,7 @@
 #include "../lightsources/pointlightsource.h"
 #include "../lightsources/arealightsource.h"
 #include "../shapes/shape.h"
+#include "../core/scene.h"
 
 class Shader
 {
@@ -15,8 +16,27 @@ public:
     Shader(Vector3D bgColor_);
 
     virtual Vector3D computeColor(const Ray &r,
-                             const std::vector<Shape*> &objList,
-                             const std::vector<LightSource*> &lsList) const = 0;
+                             const Scene& scene) const = 0;
+
+    // Color along r when its closest hit "its" (with material "material")
+    // is already known. Used by the material-sorted renderer; shaders which
+    // do not override it simply trace r again through computeColor
+    virtual Vector3D shadeHit(const Ray &r, const Intersection &its,
+                              const MaterialRecord &material,
+                              const Scene& scene) const;
+
+    // shadeHit split into the light which reaches the camera after at most
+    // one bounce (emission and direct lighting of the hit) and the rest
+    // (indirect lighting, and everything seen through mirrors and glass).
+    // Shaders which do not override it report all their light as direct
+    virtual Vector3D shadeHitSplit(const Ray &r, const Intersection &its,
+                                   const MaterialRecord &material,
+                                   const Scene& scene,
+                                   Vector3D &direct, Vector3D &indirect) const;
+
+    // Radiance along a ray which leaves the scene: the environment light
+    // if the scene has one, bgColor otherwise
+    Vector3D getBackground(const Ray &r, const Scene& scene) const;
 
     Vector3D bgColor;
 };
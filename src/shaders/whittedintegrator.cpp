@@ -18,16 +18,15 @@ WhittedIntegrator::WhittedIntegrator(Vector3D bgColor_)
     : Shader(bgColor_) {}
 
 Vector3D WhittedIntegrator::computeColor(const Ray& r,
-    const std::vector<Shape*>& objList,
-    const std::vector<LightSource*>& lsList) const
+    const Scene& scene) const
 {
     // intersección más cercana
     Intersection its;
-    if (!Utils::getClosestIntersection(r, objList, its)) {
-        return bgColor; // rayo no golpea nada --> fondo negro
+    if (!Utils::getClosestIntersection(r, scene, its)) {
+        return getBackground(r, scene); // rayo no golpea nada --> fondo negro
     }
 
-    const Material& mat = its.shape->getMaterial();
+    const MaterialRecord& mat = scene.getMaterial(its);
     Vector3D n = its.normal.normalized(); // normal en el punto
     Vector3D wo = (-r.d).normalized();    // dirección hacia la cámara
 
@@ -41,7 +40,7 @@ Vector3D WhittedIntegrator::computeColor(const Ray& r,
     
 
     if (mat.hasDiffuseOrGlossy()) {
-        for (const LightSource* ls : lsList) { // ls es cada fuente de luz
+        for (const LightSource* ls : *scene.LightSourceList) { // ls es cada fuente de luz
             Vector3D lightPos = ls->sampleLightPosition();
             Vector3D Li = ls->getIntensity();
 
@@ -51,8 +50,8 @@ Vector3D WhittedIntegrator::computeColor(const Ray& r,
             Vector3D wi = L / dist; // dirección de la luz (normalizada)
 
             // shadow ray: checkea si hay algún objeto entre la luz y el punto (sombra)
-            Ray shadowRay(its.itsPoint, wi, 0.0, Epsilon, dist - Epsilon);
-            bool isVisible = !Utils::hasIntersection(shadowRay, objList); // 1 si es visible, 0 si está bloqueado
+            Ray shadowRay(its.itsPoint, wi, 0.0, Epsilon, dist - Epsilon, r.time);
+            bool isVisible = !Utils::hasIntersection(shadowRay, scene); // 1 si es visible, 0 si está bloqueado
 
             double V_s;
             if (isVisible) {
@@ -71,8 +70,8 @@ Vector3D WhittedIntegrator::computeColor(const Ray& r,
     // reflexión perfecta (Task 4.5.3) 
     if (mat.hasSpecular()) {
         Vector3D wr = (2 * dot(n, -r.d) * n - (-r.d)).normalized(); // r.d apunta a la cámara, invertimos (-r.d)
-		Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1);
-        color += computeColor(reflRay, objList, lsList);
+		Ray reflRay(its.itsPoint + n * Epsilon, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+        color += computeColor(reflRay, scene);
     }
 
 	// transmisión perfecta (Task 4.5.4) 
@@ -90,13 +89,13 @@ Vector3D WhittedIntegrator::computeColor(const Ray& r,
         
         if (radicand >= 0) {
             Vector3D wt = (-muT * wo + n1 * (muT * dot(n1, wo) - sqrt(radicand))).normalized(); 
-            Ray refrRay(its.itsPoint, wt, r.depth + 1);
-            color += computeColor(refrRay, objList, lsList);
+            Ray refrRay(its.itsPoint, wt, r.depth + 1, Epsilon, INFINITY, r.time);
+            color += computeColor(refrRay, scene);
         } else {
             //en este caso reflexión total
             Vector3D wr = (2 * dot(n1, -r.d) * n1 - (-r.d)).normalized(); // r.d apunta a la cámara, invertimos (-r.d)
-            Ray reflRay(its.itsPoint, wr, r.depth + 1);
-            color += computeColor(reflRay, objList, lsList);
+            Ray reflRay(its.itsPoint, wr, r.depth + 1, Epsilon, INFINITY, r.time);
+            color += computeColor(reflRay, scene);
         }
     }
     return color;
@@ -7,7 +7,7 @@ class WhittedIntegrator : public Shader {
 public:
     WhittedIntegrator();
     WhittedIntegrator(Vector3D bgColor_);
-    Vector3D computeColor(const Ray &r, const std::vector<Shape*> &objList, const std::vector<LightSource*> &lsList) const override;
+    Vector3D computeColor(const Ray &r, const Scene& scene) const override;
 };
 
 #endif // WHITTEDINTEGRATOR_H
@@ -11,6 +11,11 @@ Vector3D InfinitePlan::getNormalWorld() const
     return nWorld;
 }
 
+Vector3D InfinitePlan::getPointWorld() const
+{
+    return p0World;
+}
+
 bool InfinitePlan::rayIntersect(const Ray &rayWorld, Intersection &its) const
 {
     // Compute the denominator of the tHit formula
@@ -12,6 +12,8 @@ public:
 
     // Get the normal at a surface point in world coordinates
     Vector3D getNormalWorld() const;
+    // Get the point p0 of the plan in world coordinates
+    Vector3D getPointWorld() const;
 
     // Ray/plan intersection methods
     bool rayIntersect(const Ray &ray, Intersection &its) const;
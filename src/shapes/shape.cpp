@@ -1,5 +1,7 @@
 #include "shape.h"
 
+#include <algorithm>
+
 Shape::Shape(const Matrix4x4 &t_, Material *material_)
 {
     objectToWorld = t_;
@@ -11,3 +13,129 @@ const Material& Shape::getMaterial() const
 {
     return *material;
 }
+
+BoundingBox Shape::getBounds() const
+{
+    return BoundingBox::unbounded();
+}
+
+// Bounds of the box b after the transform m
+static BoundingBox transformBounds(const BoundingBox &b, const Matrix4x4 &m)
+{
+    BoundingBox result;
+    for (int i = 0; i < 8; i++)
+    {
+        Vector3D corner((i & 1) ? b.pMax.x : b.pMin.x,
+                        (i & 2) ? b.pMax.y : b.pMin.y,
+                        (i & 4) ? b.pMax.z : b.pMin.z);
+        result.expand(m.transformPoint(corner));
+    }
+    return result;
+}
+
+void Shape::addKeyframe(double time, const Matrix4x4 &motion)
+{
+    Keyframe key = { time, motion };
+    auto pos = std::upper_bound(keyframes.begin(), keyframes.end(), key,
+        [](const Keyframe &a, const Keyframe &b) { return a.time < b.time; });
+    keyframes.insert(pos, key);
+}
+
+bool Shape::isAnimated() const
+{
+    return !keyframes.empty();
+}
+
+Matrix4x4 Shape::getMotion(double time) const
+{
+    if (keyframes.empty())
+        return Matrix4x4();
+    if (time <= keyframes.front().time)
+        return keyframes.front().motion;
+    if (time >= keyframes.back().time)
+        return keyframes.back().motion;
+
+    // Find the keyframes around "time"
+    size_t k = 1;
+    while (keyframes[k].time < time)
+        k++;
+    const Keyframe &k0 = keyframes[k - 1];
+    const Keyframe &k1 = keyframes[k];
+
+    double s = (time - k0.time) / (k1.time - k0.time);
+    return k0.motion * (1.0 - s) + k1.motion * s;
+}
+
+bool Shape::getMotionInterval(double &start, double &end) const
+{
+    if (keyframes.empty())
+        return false;
+
+    start = keyframes.front().time;
+    end = keyframes.back().time;
+    return true;
+}
+
+void Shape::getMotionBounds(double time0, double time1,
+                            BoundingBox &b0, BoundingBox &b1) const
+{
+    BoundingBox rest = getBounds();
+    if (keyframes.empty() || !rest.isBounded())
+    {
+        b0 = b1 = rest;
+        return;
+    }
+
+    // Each point of the shape moves linearly between two keyframes, so its
+    // bounds too
+    b0 = transformBounds(rest, getMotion(time0));
+    b1 = transformBounds(rest, getMotion(time1));
+
+    // With keyframes in between the motion is no longer linear: use the
+    // union of all the bounds at both ends
+    bool innerKeyframes = false;
+    for (const Keyframe &key : keyframes)
+    {
+        if (key.time > time0 && key.time < time1)
+        {
+            b0.expand(transformBounds(rest, key.motion));
+            innerKeyframes = true;
+        }
+    }
+    if (innerKeyframes)
+    {
+        b0.expand(b1);
+        b1 = b0;
+    }
+}
+
+bool Shape::rayIntersectMoving(const Ray &ray, Intersection &its) const
+{
+    // Intersect the shape at rest with the ray moved by the inverse motion.
+    // The ray parameter t is the same in both spaces
+    Matrix4x4 motion = getMotion(ray.time);
+    Matrix4x4 inverseMotion;
+    motion.inverse(inverseMotion);
+
+    Ray restRay = inverseMotion.transformRay(ray);
+    if (!rayIntersect(restRay, its))
+        return false;
+
+    ray.maxT = restRay.maxT;
+
+    // Move the intersection back to the instant of the ray
+    Matrix4x4 inverseTransposed;
+    inverseMotion.transpose(inverseTransposed);
+    its.itsPoint = motion.transformPoint(its.itsPoint);
+    its.normal = inverseTransposed.transformVector(its.normal).normalized();
+
+    return true;
+}
+
+bool Shape::rayIntersectPMoving(const Ray &ray) const
+{
+    Matrix4x4 inverseMotion;
+    getMotion(ray.time).inverse(inverseMotion);
+
+    return rayIntersectP(inverseMotion.transformRay(ray));
+}
@@ -6,6 +6,9 @@
 #include "../core/ray.h"
 #include "../materials/material.h"
 #include "../core/intersection.h"
+#include "../core/boundingbox.h"
+
+#include <vector>
 
 class Shape
 {
@@ -22,10 +25,45 @@ public:
     // Return the material associated with the shape
     const Material& getMaterial() const;
 
+    // Bounding box (in world coordinates) of the shape at rest. Shapes which
+    // do not override it are considered unbounded
+    virtual BoundingBox getBounds() const;
+
+    // Object motion. Each keyframe is a world space transform applied on
+    // top of objectToWorld at the given time. Between keyframes the transform
+    // is interpolated linearly (element by element, which is exact for
+    // translations and scales); before the first and after the last keyframe
+    // it stays constant. Keyframes must be added before the shape is added
+    // to the scene
+    void addKeyframe(double time, const Matrix4x4 &motion);
+    bool isAnimated() const;
+    Matrix4x4 getMotion(double time) const;
+
+    // Times of the first and last keyframes. Returns false if the shape
+    // does not move
+    bool getMotionInterval(double &start, double &end) const;
+
+    // Bounds of the shape at time0 (b0) and time1 (b1). The bounds at any
+    // time in between are contained in their linear interpolation
+    void getMotionBounds(double time0, double time1,
+                         BoundingBox &b0, BoundingBox &b1) const;
+
+    // Ray/shape intersection methods of an animated shape, at ray.time
+    bool rayIntersectMoving(const Ray &ray, Intersection &its) const;
+    bool rayIntersectPMoving(const Ray &ray) const;
+
 protected:
     Matrix4x4 objectToWorld;
     Matrix4x4 worldToObject;
     Material *material;
+
+    struct Keyframe
+    {
+        double time;
+        Matrix4x4 motion;
+    };
+    // Sorted by time
+    std::vector<Keyframe> keyframes;
     //float area;
 };
 
@@ -32,6 +32,50 @@ Vector3D Sphere::getNormalWorld(const Vector3D &pt_world) const
     return(nWorld.normalized());
 }
 
+void Sphere::setObjectToWorld(const Matrix4x4 &t)
+{
+    objectToWorld = t;
+    objectToWorld.inverse(worldToObject);
+}
+
+Vector3D Sphere::getCenterWorld() const
+{
+    return objectToWorld.transformPoint(Vector3D(0, 0, 0));
+}
+
+double Sphere::getRadiusWorld() const
+{
+    return radius * objectToWorld.transformVector(Vector3D(1, 0, 0)).length();
+}
+
+bool Sphere::hasUniformScale() const
+{
+    // The three transformed axes must be orthogonal and of equal length
+    Vector3D ex = objectToWorld.transformVector(Vector3D(1, 0, 0));
+    Vector3D ey = objectToWorld.transformVector(Vector3D(0, 1, 0));
+    Vector3D ez = objectToWorld.transformVector(Vector3D(0, 0, 1));
+
+    double lx = ex.lengthSq();
+    double tol = 1e-6 * lx;
+
+    return std::abs(ey.lengthSq() - lx) < tol && std::abs(ez.lengthSq() - lx) < tol &&
+           std::abs(dot(ex, ey)) < tol && std::abs(dot(ex, ez)) < tol && std::abs(dot(ey, ez)) < tol;
+}
+
+BoundingBox Sphere::getBounds() const
+{
+    // Transform the corners of the local box
+    BoundingBox bounds;
+    for (int i = 0; i < 8; i++)
+    {
+        Vector3D corner((i & 1) ? radius : -radius,
+                        (i & 2) ? radius : -radius,
+                        (i & 4) ? radius : -radius);
+        bounds.expand(objectToWorld.transformPoint(corner));
+    }
+    return bounds;
+}
+
 // Chapter 3 PBRT, page 117
 bool Sphere::rayIntersect(const Ray &ray, Intersection &its) const
 {
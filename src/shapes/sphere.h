@@ -15,6 +15,19 @@ public:
 
     Vector3D getNormalWorld(const Vector3D &pt_world) const;
 
+    // Center and radius in world coordinates. The world radius is only
+    // meaningful when the transform has a uniform scale
+    Vector3D getCenterWorld() const;
+    double getRadiusWorld() const;
+    bool hasUniformScale() const;
+
+    // Move the sphere, e.g., to the next frame of an Animation. A sphere
+    // with a uniform scale must keep one. Scene::refitBVH must be called
+    // before the next render
+    void setObjectToWorld(const Matrix4x4 &t);
+
+    BoundingBox getBounds() const;
+
     bool rayIntersect(const Ray &ray, Intersection &its) const;
     bool rayIntersectP(const Ray &ray) const;
     std::string toString() const;
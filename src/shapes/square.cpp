@@ -95,6 +95,15 @@ bool Square::rayIntersectP(const Ray &ray) const
     return true;
 }
 
+BoundingBox Square::getBounds() const
+{
+    BoundingBox bounds(corner);
+    bounds.expand(corner + v1);
+    bounds.expand(corner + v2);
+    bounds.expand(corner + v1 + v2);
+    return bounds;
+}
+
 std::string Square::toString() const
 {
     std::stringstream s;
@@ -17,6 +17,7 @@ public:
 
     bool rayIntersect(const Ray &ray, Intersection &its) const;
     bool rayIntersectP(const Ray &ray) const;
+    BoundingBox getBounds() const;
     std::string toString() const;
 
 
@@ -0,0 +1,115 @@
+#include "triangle.h"
+
+#include <cmath>
+#include <sstream>
+
+Triangle::Triangle(const Vector3D &p0_, const Vector3D &p1_, const Vector3D &p2_, Material *material_)
+    : Shape(Matrix4x4(), material_), p0(p0_), p1(p1_), p2(p2_)
+{
+    normal = cross(p1 - p0, p2 - p0).normalized();
+}
+
+void Triangle::setVertices(const Vector3D &p0_, const Vector3D &p1_, const Vector3D &p2_)
+{
+    p0 = p0_;
+    p1 = p1_;
+    p2 = p2_;
+    normal = cross(p1 - p0, p2 - p0).normalized();
+}
+
+Vector3D Triangle::getNormalWorld(const Vector3D &pt_world) const
+{
+    return normal;
+}
+
+bool Triangle::hit(const Ray &ray, double &tHit) const
+{
+    Vector3D e1 = p1 - p0;
+    Vector3D e2 = p2 - p0;
+
+    Vector3D pvec = cross(ray.d, e2);
+    double det = dot(e1, pvec);
+    if (std::abs(det) < 1e-12)
+        return false;
+    double invDet = 1.0 / det;
+
+    // Barycentric coordinates of the hit point
+    Vector3D tvec = ray.o - p0;
+    double b1 = dot(tvec, pvec) * invDet;
+    if (b1 < 0.0 || b1 > 1.0)
+        return false;
+
+    Vector3D qvec = cross(tvec, e1);
+    double b2 = dot(ray.d, qvec) * invDet;
+    if (b2 < 0.0 || b1 + b2 > 1.0)
+        return false;
+
+    double t = dot(e2, qvec) * invDet;
+    if (t < ray.minT || t > ray.maxT)
+        return false;
+
+    tHit = t;
+    return true;
+}
+
+bool Triangle::rayIntersect(const Ray &ray, Intersection &its) const
+{
+    double tHit;
+    if (!hit(ray, tHit))
+        return false;
+
+    its.itsPoint = ray.o + ray.d * tHit;
+    its.normal = normal;
+    its.shape = this;
+
+    ray.maxT = tHit;
+    return true;
+}
+
+bool Triangle::rayIntersectP(const Ray &ray) const
+{
+    double tHit;
+    if (!hit(ray, tHit))
+        return false;
+
+    ray.maxT = tHit;
+    return true;
+}
+
+BoundingBox Triangle::getBounds() const
+{
+    BoundingBox bounds(p0);
+    bounds.expand(p1);
+    bounds.expand(p2);
+    return bounds;
+}
+
+double Triangle::getArea() const
+{
+    return 0.5 * cross(p1 - p0, p2 - p0).length();
+}
+
+Vector3D Triangle::samplePoint(double u1, double u2) const
+{
+    // Square-root warp of the unit square onto the triangle
+    double su1 = std::sqrt(u1);
+    double b0 = 1.0 - su1;
+    double b1 = u2 * su1;
+    return p0 * b0 + p1 * b1 + p2 * (1.0 - b0 - b1);
+}
+
+std::string Triangle::toString() const
+{
+    std::stringstream s;
+    s << "[ " << std::endl
+      << " P0 = " << p0 << ", P1 = " << p1 << ", P2 = " << p2 << std::endl
+      << "]" << std::endl;
+
+    return s.str();
+}
+
+std::ostream& operator<<(std::ostream &out, const Triangle &t)
+{
+    out << t.toString();
+    return out;
+}
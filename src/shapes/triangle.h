@@ -0,0 +1,46 @@
+#ifndef TRIANGLE_H
+#define TRIANGLE_H
+
+#include <iostream>
+#include <string>
+
+#include "shape.h"
+
+// Triangle given by its three vertices in world coordinates. The normal is
+// that of the vertices in counterclockwise order, cross(p1 - p0, p2 - p0),
+// and is the side towards which an emissive triangle emits
+class Triangle : public Shape
+{
+public:
+    Triangle() = delete;
+    Triangle(const Vector3D &p0_, const Vector3D &p1_, const Vector3D &p2_, Material *material_);
+
+    // Move the vertices (see TriangleMesh::setObjectToWorld)
+    void setVertices(const Vector3D &p0_, const Vector3D &p1_, const Vector3D &p2_);
+
+    Vector3D getNormalWorld(const Vector3D &pt_world) const;
+
+    bool rayIntersect(const Ray &ray, Intersection &its) const;
+    bool rayIntersectP(const Ray &ray) const;
+    BoundingBox getBounds() const;
+    std::string toString() const;
+
+    double getArea() const;
+
+    // Point of the triangle for the random numbers u1, u2 in [0,1],
+    // uniformly distributed over its area
+    Vector3D samplePoint(double u1, double u2) const;
+
+    Vector3D p0;
+    Vector3D p1;
+    Vector3D p2;
+    Vector3D normal;
+
+private:
+    // Moller-Trumbore test. Returns the hit distance in tHit
+    bool hit(const Ray &ray, double &tHit) const;
+};
+
+std::ostream& operator<<(std::ostream &out, const Triangle &t);
+
+#endif // TRIANGLE_H
@@ -0,0 +1,44 @@
+#include "trianglemesh.h"
+
+TriangleMesh::TriangleMesh(const std::vector<Vector3D> &vertices_, const std::vector<int> &indices_,
+                           const Matrix4x4 &objectToWorld_, Material *material_)
+    : vertices(vertices_), indices(indices_), material(material_)
+{
+    std::vector<Vector3D> worldVertices;
+    worldVertices.reserve(vertices_.size());
+    for (const Vector3D &v : vertices_)
+        worldVertices.push_back(objectToWorld_.transformPoint(v));
+
+    triangles.reserve(indices_.size() / 3);
+    for (size_t i = 0; i + 2 < indices_.size(); i += 3)
+    {
+        triangles.push_back(new Triangle(worldVertices[indices_[i]],
+                                         worldVertices[indices_[i + 1]],
+                                         worldVertices[indices_[i + 2]], material_));
+    }
+}
+
+void TriangleMesh::setObjectToWorld(const Matrix4x4 &objectToWorld_)
+{
+    std::vector<Vector3D> worldVertices;
+    worldVertices.reserve(vertices.size());
+    for (const Vector3D &v : vertices)
+        worldVertices.push_back(objectToWorld_.transformPoint(v));
+
+    for (size_t t = 0; t < triangles.size(); t++)
+    {
+        triangles[t]->setVertices(worldVertices[indices[3 * t]],
+                                  worldVertices[indices[3 * t + 1]],
+                                  worldVertices[indices[3 * t + 2]]);
+    }
+}
+
+const std::vector<Triangle*>& TriangleMesh::getTriangles() const
+{
+    return triangles;
+}
+
+const Material& TriangleMesh::getMaterial() const
+{
+    return *material;
+}
@@ -0,0 +1,35 @@
+#ifndef TRIANGLEMESH_H
+#define TRIANGLEMESH_H
+
+#include <vector>
+
+#include "triangle.h"
+
+// Indexed triangle mesh with a single material. The vertices are given in
+// object coordinates and transformed to world coordinates once; each face
+// becomes a Triangle so that the scene BVH can partition the mesh. Add it to
+// the scene with Scene::AddMesh. The mesh can be moved afterwards (e.g., by
+// an Animation) with setObjectToWorld, followed by Scene::refitBVH
+class TriangleMesh
+{
+public:
+    TriangleMesh() = delete;
+
+    // indices holds three vertex indices per triangle
+    TriangleMesh(const std::vector<Vector3D> &vertices_, const std::vector<int> &indices_,
+                 const Matrix4x4 &objectToWorld_, Material *material_);
+
+    const std::vector<Triangle*>& getTriangles() const;
+    const Material& getMaterial() const;
+
+    // Transform the vertices again, with a new object to world transform
+    void setObjectToWorld(const Matrix4x4 &objectToWorld_);
+
+private:
+    std::vector<Vector3D> vertices;     // Object coordinates
+    std::vector<int> indices;
+    std::vector<Triangle*> triangles;
+    Material *material;
+};
+
+#endif // TRIANGLEMESH_H